@@ -0,0 +1,89 @@
+#include "ActiveBlockIndex.h"
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ActiveBlockIndex::Build(vtkImageData* image, vtkDataArray* vectors, double speedThreshold,
+    vtkDataArray* scalars, double scalarThreshold, int blockSize)
+{
+    image->GetDimensions(this->Dimensions);
+    image->GetPoint(0, this->Origin);
+    image->GetSpacing(this->Spacing);
+    this->BlockSize = std::max(blockSize, 1);
+    this->SpeedThreshold = speedThreshold;
+    this->ScalarThreshold = scalarThreshold;
+
+    // Flat axes have no cells but still get one layer of blocks.
+    const int* dims = this->Dimensions;
+    for (int a = 0; a < 3; ++a)
+    {
+        this->BlockDimensions[a] = std::max(1, (dims[a] - 1 + this->BlockSize - 1) / this->BlockSize);
+    }
+    const int* blocks = this->BlockDimensions;
+    const vtkIdType numBlocks = static_cast<vtkIdType>(blocks[0]) * blocks[1] * blocks[2];
+    this->Active.assign(numBlocks, 0);
+
+    const double speedSquared = speedThreshold * speedThreshold;
+    vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType block = begin; block < end; ++block)
+        {
+            const int b[3] = { static_cast<int>(block % blocks[0]), static_cast<int>((block / blocks[0]) % blocks[1]),
+                static_cast<int>(block / (static_cast<vtkIdType>(blocks[0]) * blocks[1])) };
+            int lo[3];
+            int hi[3];
+            for (int a = 0; a < 3; ++a)
+            {
+                lo[a] = b[a] * this->BlockSize;
+                hi[a] = std::min(lo[a] + this->BlockSize, dims[a] - 1);
+            }
+
+            bool active = false;
+            for (int k = lo[2]; k <= hi[2] && !active; ++k)
+            {
+                for (int j = lo[1]; j <= hi[1] && !active; ++j)
+                {
+                    for (int i = lo[0]; i <= hi[0] && !active; ++i)
+                    {
+                        const vtkIdType p = i + dims[0] * (j + static_cast<vtkIdType>(dims[1]) * k);
+                        if (scalars && scalars->GetComponent(p, 0) >= scalarThreshold)
+                        {
+                            active = true;
+                        }
+                        else if (vectors)
+                        {
+                            double v[3];
+                            vectors->GetTuple(p, v);
+                            active = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] >= speedSquared;
+                        }
+                    }
+                }
+            }
+            this->Active[block] = active ? 1 : 0;
+        }
+    });
+
+    this->NumberOfActiveBlocks = std::count(this->Active.begin(), this->Active.end(), 1);
+}
+
+bool ActiveBlockIndex::IsActive(const double x[3]) const
+{
+    if (this->Active.empty())
+    {
+        return false;
+    }
+    int cell[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        double t = (x[a] - this->Origin[a]) / this->Spacing[a];
+        if (t < -1e-6 || t > this->Dimensions[a] - 1 + 1e-6)
+        {
+            return false;
+        }
+        cell[a] = std::min(std::max(static_cast<int>(std::floor(t)), 0), std::max(this->Dimensions[a] - 2, 0));
+    }
+    return this->IsCellActive(cell[0], cell[1], cell[2]);
+}
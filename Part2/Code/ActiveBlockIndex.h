@@ -0,0 +1,60 @@
+#ifndef ActiveBlockIndex_h
+#define ActiveBlockIndex_h
+
+#include "vtkType.h"
+
+#include <vector>
+
+class vtkDataArray;
+class vtkImageData;
+
+// Coarse occupancy of a structured grid, for skipping empty space.
+//
+// The cells of the grid are grouped into blocks of BlockSize^3 cells. A block
+// is active when any of its points (corners included) has a vector magnitude
+// of at least SpeedThreshold or a scalar of at least ScalarThreshold.
+// Because trilinear interpolation stays within the range of the corners, an
+// inactive block can hold no point faster than SpeedThreshold and no crossing
+// of a contour value at or above ScalarThreshold. With the tracer's terminal
+// speed and the contour value as thresholds, skipping inactive blocks gives
+// the same streamlines and contours as processing the whole grid.
+class ActiveBlockIndex
+{
+public:
+    // Either array may be null. Blocks are classified in parallel.
+    void Build(vtkImageData* image, vtkDataArray* vectors, double speedThreshold, vtkDataArray* scalars,
+        double scalarThreshold, int blockSize = 8);
+
+    // Cell (i, j, k) of the grid lies in an active block.
+    bool IsCellActive(int i, int j, int k) const
+    {
+        const int b = this->BlockSize;
+        return this->Active[i / b + this->BlockDimensions[0] * (j / b + this->BlockDimensions[1] * (k / b))] != 0;
+    }
+
+    // The cell containing world position x is active; false outside the grid.
+    bool IsActive(const double x[3]) const;
+
+    const int* GetDimensions() const { return this->Dimensions; }
+    const int* GetBlockDimensions() const { return this->BlockDimensions; }
+    int GetBlockSize() const { return this->BlockSize; }
+    double GetSpeedThreshold() const { return this->SpeedThreshold; }
+    double GetScalarThreshold() const { return this->ScalarThreshold; }
+
+    vtkIdType GetNumberOfBlocks() const { return static_cast<vtkIdType>(this->Active.size()); }
+    vtkIdType GetNumberOfActiveBlocks() const { return this->NumberOfActiveBlocks; }
+
+private:
+    int Dimensions[3] = { 0, 0, 0 };
+    double Origin[3] = { 0.0, 0.0, 0.0 };
+    double Spacing[3] = { 1.0, 1.0, 1.0 };
+    int BlockSize = 8;
+    int BlockDimensions[3] = { 0, 0, 0 };
+    double SpeedThreshold = 0.0;
+    double ScalarThreshold = 0.0;
+
+    std::vector<unsigned char> Active;
+    vtkIdType NumberOfActiveBlocks = 0;
+};
+
+#endif
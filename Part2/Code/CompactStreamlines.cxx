@@ -0,0 +1,357 @@
+#include "CompactStreamlines.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+
+const char FileMagic[4] = { 'F', 'V', 'S', 'L' };
+const std::uint32_t FileVersion = 2;
+const double QuantizationLevels = 65535.0;
+
+std::uint16_t Quantize(double value, double origin, double step)
+{
+    if (step <= 0.0)
+    {
+        return 0;
+    }
+    double q = std::floor((value - origin) / step + 0.5);
+    return static_cast<std::uint16_t>(std::min(std::max(q, 0.0), QuantizationLevels));
+}
+
+// Component 0 of single-component arrays, the magnitude of the others.
+// Uses only the thread-safe accessors.
+double GetAttributeValue(vtkDataArray* array, vtkIdType id)
+{
+    int numComponents = array->GetNumberOfComponents();
+    if (numComponents == 1)
+    {
+        return array->GetComponent(id, 0);
+    }
+    double sum = 0.0;
+    for (int c = 0; c < numComponents; ++c)
+    {
+        double v = array->GetComponent(id, c);
+        sum += v * v;
+    }
+    return std::sqrt(sum);
+}
+
+template <typename T>
+void WriteValue(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteVector(std::ofstream& out, const std::vector<T>& values)
+{
+    if (!values.empty())
+    {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+}
+
+template <typename T>
+bool ReadValue(std::ifstream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template <typename T>
+bool ReadVector(std::ifstream& in, std::vector<T>& values, std::size_t count)
+{
+    values.resize(count);
+    return count == 0 || static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+}
+
+} // namespace
+
+void CompactStreamlines::Encode(vtkPolyData* lines, const std::vector<vtkDataArray*>& attributes)
+{
+    this->Clear();
+
+    vtkPoints* points = lines ? lines->GetPoints() : nullptr;
+    vtkCellArray* cells = lines ? lines->GetLines() : nullptr;
+    if (!points || !cells)
+    {
+        return;
+    }
+
+    // Flatten the connectivity so that every line can be encoded on its own.
+    std::vector<vtkIdType> pointIds;
+    vtkIdType npts;
+    const vtkIdType* pts;
+    for (cells->InitTraversal(); cells->GetNextCell(npts, pts);)
+    {
+        if (npts > 0)
+        {
+            pointIds.insert(pointIds.end(), pts, pts + npts);
+            this->Offsets.push_back(static_cast<std::uint32_t>(pointIds.size()));
+        }
+    }
+
+    const vtkIdType numLines = static_cast<vtkIdType>(this->Offsets.size()) - 1;
+    this->Lines.resize(numLines);
+    this->Positions.resize(3 * pointIds.size());
+
+    // Attribute ranges are global so that values stay comparable across lines.
+    std::vector<vtkDataArray*> sources;
+    for (vtkDataArray* array : attributes)
+    {
+        if (!array)
+        {
+            continue;
+        }
+        Attribute attribute;
+        attribute.Name = array->GetName() ? array->GetName() : "";
+        double range[2];
+        array->GetRange(range, array->GetNumberOfComponents() == 1 ? 0 : -1);
+        attribute.Range[0] = static_cast<float>(range[0]);
+        attribute.Range[1] = static_cast<float>(range[1]);
+        attribute.Values.resize(pointIds.size());
+        this->Attributes.push_back(std::move(attribute));
+        sources.push_back(array);
+    }
+
+    vtkSMPTools::For(0, numLines, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType line = begin; line < end; ++line)
+        {
+            const std::uint32_t first = this->Offsets[line];
+            const std::uint32_t last = this->Offsets[line + 1];
+
+            double lo[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+            double hi[3] = { VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN };
+            double x[3];
+            for (std::uint32_t p = first; p < last; ++p)
+            {
+                points->GetPoint(pointIds[p], x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    lo[c] = std::min(lo[c], x[c]);
+                    hi[c] = std::max(hi[c], x[c]);
+                }
+            }
+
+            // Anchor and step are stored as float and quantization uses those
+            // exact values, so decoding reproduces the same grid.
+            LineHeader& header = this->Lines[line];
+            for (int c = 0; c < 3; ++c)
+            {
+                header.Anchor[c] = static_cast<float>(lo[c]);
+                header.Step[c] = static_cast<float>((hi[c] - header.Anchor[c]) / QuantizationLevels);
+            }
+
+            for (std::uint32_t p = first; p < last; ++p)
+            {
+                points->GetPoint(pointIds[p], x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    this->Positions[3 * p + c] = Quantize(x[c], header.Anchor[c], header.Step[c]);
+                }
+            }
+
+            for (std::size_t a = 0; a < sources.size(); ++a)
+            {
+                Attribute& attribute = this->Attributes[a];
+                double step = (attribute.Range[1] - attribute.Range[0]) / QuantizationLevels;
+                for (std::uint32_t p = first; p < last; ++p)
+                {
+                    attribute.Values[p] =
+                        Quantize(GetAttributeValue(sources[a], pointIds[p]), attribute.Range[0], step);
+                }
+            }
+        }
+    });
+}
+
+vtkSmartPointer<vtkPolyData> CompactStreamlines::Decode() const
+{
+    const vtkIdType numLines = static_cast<vtkIdType>(this->GetNumberOfLines());
+    const vtkIdType numPoints = static_cast<vtkIdType>(this->GetNumberOfPoints());
+
+    vtkSmartPointer<vtkFloatArray> coords = vtkSmartPointer<vtkFloatArray>::New();
+    coords->SetNumberOfComponents(3);
+    coords->SetNumberOfTuples(numPoints);
+    float* xyz = coords->GetPointer(0);
+
+    vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(numLines + 1);
+    vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(numPoints);
+    offsets->SetValue(numLines, numPoints);
+
+    std::vector<vtkSmartPointer<vtkFloatArray>> arrays;
+    for (const Attribute& attribute : this->Attributes)
+    {
+        vtkSmartPointer<vtkFloatArray> array = vtkSmartPointer<vtkFloatArray>::New();
+        array->SetName(attribute.Name.c_str());
+        array->SetNumberOfValues(numPoints);
+        arrays.push_back(array);
+    }
+
+    vtkSMPTools::For(0, numLines, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType line = begin; line < end; ++line)
+        {
+            const std::uint32_t first = this->Offsets[line];
+            const std::uint32_t last = this->Offsets[line + 1];
+            const LineHeader& header = this->Lines[line];
+            offsets->SetValue(line, first);
+
+            for (std::uint32_t p = first; p < last; ++p)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    xyz[3 * p + c] = header.Anchor[c] + this->Positions[3 * p + c] * header.Step[c];
+                }
+                connectivity->SetValue(p, p);
+            }
+
+            for (std::size_t a = 0; a < arrays.size(); ++a)
+            {
+                const Attribute& attribute = this->Attributes[a];
+                float step = static_cast<float>((attribute.Range[1] - attribute.Range[0]) / QuantizationLevels);
+                float* values = arrays[a]->GetPointer(0);
+                for (std::uint32_t p = first; p < last; ++p)
+                {
+                    values[p] = attribute.Range[0] + attribute.Values[p] * step;
+                }
+            }
+        }
+    });
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coords);
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->SetData(offsets.GetPointer(), connectivity.GetPointer());
+
+    vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+    output->SetPoints(points);
+    output->SetLines(cells);
+    for (std::size_t a = 0; a < arrays.size(); ++a)
+    {
+        if (a == 0)
+        {
+            output->GetPointData()->SetScalars(arrays[a]);
+        }
+        else
+        {
+            output->GetPointData()->AddArray(arrays[a]);
+        }
+    }
+    return output;
+}
+
+// Layout: magic, version, line / point / attribute counts, then the vectors
+// as they are held in memory, in host byte order (little-endian on every
+// platform flowVis is built for).
+bool CompactStreamlines::Write(const std::string& fileName) const
+{
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out)
+    {
+        return false;
+    }
+
+    out.write(FileMagic, sizeof(FileMagic));
+    WriteValue(out, FileVersion);
+    WriteValue(out, static_cast<std::uint32_t>(this->GetNumberOfLines()));
+    WriteValue(out, static_cast<std::uint32_t>(this->GetNumberOfPoints()));
+    WriteValue(out, static_cast<std::uint32_t>(this->Attributes.size()));
+    WriteVector(out, this->Lines);
+    WriteVector(out, this->Offsets);
+    WriteVector(out, this->Positions);
+    for (const Attribute& attribute : this->Attributes)
+    {
+        WriteValue(out, static_cast<std::uint32_t>(attribute.Name.size()));
+        out.write(attribute.Name.data(), attribute.Name.size());
+        WriteValue(out, attribute.Range[0]);
+        WriteValue(out, attribute.Range[1]);
+        WriteVector(out, attribute.Values);
+    }
+    return static_cast<bool>(out);
+}
+
+bool CompactStreamlines::Read(const std::string& fileName)
+{
+    this->Clear();
+
+    std::ifstream in(fileName, std::ios::binary);
+    char magic[sizeof(FileMagic)];
+    std::uint32_t version = 0;
+    std::uint32_t numLines = 0;
+    std::uint32_t numPoints = 0;
+    std::uint32_t numAttributes = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, FileMagic, sizeof(magic)) != 0 ||
+        !ReadValue(in, version) || version != FileVersion || !ReadValue(in, numLines) ||
+        !ReadValue(in, numPoints) || !ReadValue(in, numAttributes))
+    {
+        return false;
+    }
+
+    std::vector<LineHeader> lines;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint16_t> positions;
+    bool ok = ReadVector(in, lines, numLines) && ReadVector(in, offsets, std::size_t(numLines) + 1) &&
+        ReadVector(in, positions, 3 * std::size_t(numPoints));
+
+    // Decode indexes straight into the arrays, so the index must be sound.
+    ok = ok && offsets.front() == 0 && offsets.back() == numPoints &&
+        std::is_sorted(offsets.begin(), offsets.end());
+
+    std::vector<Attribute> attributes(ok ? numAttributes : 0);
+    for (Attribute& attribute : attributes)
+    {
+        std::uint32_t nameLength = 0;
+        ok = ok && ReadValue(in, nameLength);
+        if (ok)
+        {
+            attribute.Name.resize(nameLength);
+            ok = nameLength == 0 || static_cast<bool>(in.read(&attribute.Name[0], nameLength));
+        }
+        ok = ok && ReadValue(in, attribute.Range[0]) && ReadValue(in, attribute.Range[1]) &&
+            ReadVector(in, attribute.Values, numPoints);
+    }
+    if (!ok)
+    {
+        return false;
+    }
+
+    this->Lines = std::move(lines);
+    this->Offsets = std::move(offsets);
+    this->Positions = std::move(positions);
+    this->Attributes = std::move(attributes);
+    return true;
+}
+
+void CompactStreamlines::Clear()
+{
+    this->Lines.clear();
+    this->Offsets.assign(1, 0);
+    this->Positions.clear();
+    this->Attributes.clear();
+}
+
+std::size_t CompactStreamlines::GetMemorySize() const
+{
+    std::size_t bytes = this->Lines.size() * sizeof(LineHeader) + this->Offsets.size() * sizeof(std::uint32_t) +
+        this->Positions.size() * sizeof(std::uint16_t);
+    for (const Attribute& attribute : this->Attributes)
+    {
+        bytes += attribute.Name.size() + sizeof(attribute.Range) + attribute.Values.size() * sizeof(std::uint16_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,69 @@
+#ifndef CompactStreamlines_h
+#define CompactStreamlines_h
+
+#include "vtkSmartPointer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkPolyData;
+
+// Compact storage for the polylines of a vtkStreamTracer output.
+//
+// Only positions and a few selected point attributes are kept:
+//  - each line has an anchor (the minimum corner of its bounding box) and a
+//    per-axis step; its points are quantized to 16 bits relative to the
+//    anchor, so the position error is at most step / 2 per axis; the
+//    quantized values are stored as they are, so any point decodes on its own;
+//  - attributes are reduced to one value per point (the component for
+//    scalars, the magnitude for vectors) quantized to 16 bits over their range;
+//  - Offsets[i] is the index of the first point of line i.
+// That is 6 bytes per point plus 2 per attribute, against 24 bytes per point
+// for double positions alone in the tracer output.
+class CompactStreamlines
+{
+public:
+    CompactStreamlines() { this->Clear(); }
+
+    // Replaces the contents with the polylines of `lines`.
+    void Encode(vtkPolyData* lines, const std::vector<vtkDataArray*>& attributes = std::vector<vtkDataArray*>());
+
+    // Rebuilds float points, one polyline per line and one float array per
+    // attribute (the first one becomes the active scalars). Lines are
+    // decoded in parallel.
+    vtkSmartPointer<vtkPolyData> Decode() const;
+
+    bool Write(const std::string& fileName) const;
+    bool Read(const std::string& fileName);
+
+    void Clear();
+
+    std::size_t GetNumberOfLines() const { return this->Lines.size(); }
+    std::size_t GetNumberOfPoints() const { return this->Positions.size() / 3; }
+
+    // Bytes held by the encoded data.
+    std::size_t GetMemorySize() const;
+
+private:
+    struct LineHeader
+    {
+        float Anchor[3];
+        float Step[3];
+    };
+
+    struct Attribute
+    {
+        std::string Name;
+        float Range[2];
+        std::vector<std::uint16_t> Values;
+    };
+
+    std::vector<LineHeader> Lines;
+    std::vector<std::uint32_t> Offsets;   // GetNumberOfLines() + 1 entries
+    std::vector<std::uint16_t> Positions; // 3 per point
+    std::vector<Attribute> Attributes;
+};
+
+#endif
@@ -0,0 +1,1097 @@
+#include "DistributedTracer.h"
+
+#include "FlowDatasetPool.h"
+#include "FlowField.h"
+#include "FlowPipelines.h"
+
+#include "vtkByteSwap.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkDataObject.h"
+#include "vtkExtentTranslator.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkLoopbackServerSocket.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkServerSocket.h"
+#include "vtkSocketCommunicator.h"
+#include "vtkSocketController.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTimerLog.h"
+
+#include <vtksys/Process.h>
+#include <vtksys/SystemInformation.hxx>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+// First value of every message.
+enum MessageKind
+{
+    SetupMessage = 1,
+    ReadyMessage,
+    TraceMessage,
+    ResultMessage,
+    QuitMessage
+};
+
+const int MessageTag = 38001;
+
+// Seed, segment, x, y, z, arc length, steps.
+const int StateSize = 7;
+
+// A message is a length followed by that many doubles.
+bool SendBuffer(vtkCommunicator* communicator, const std::vector<double>& buffer)
+{
+    vtkIdType length = static_cast<vtkIdType>(buffer.size());
+    return communicator->Send(&length, 1, 1, MessageTag) &&
+        (length == 0 || communicator->Send(buffer.data(), length, 1, MessageTag));
+}
+
+bool ReceiveBuffer(vtkCommunicator* communicator, std::vector<double>& buffer)
+{
+    vtkIdType length = 0;
+    if (!communicator->Receive(&length, 1, 1, MessageTag) || length < 0)
+    {
+        return false;
+    }
+    buffer.resize(length);
+    return length == 0 || communicator->Receive(buffer.data(), length, 1, MessageTag);
+}
+
+// vtkSocketController sets up the socket library (WSAStartup on Windows)
+// once per process.
+void InitializeSockets()
+{
+    static vtkSmartPointer<vtkSocketController> controller;
+    if (!controller)
+    {
+        controller = vtkSmartPointer<vtkSocketController>::New();
+        controller->Initialize(nullptr, nullptr);
+    }
+}
+
+// Length of the diagonal of one cell, over the axes with more than one point,
+// which vtkStreamTracer uses as its cell length unit on image data.
+double GetCellLength(const int wholeExtent[6], const double spacing[3])
+{
+    double length2 = 0.0;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (wholeExtent[2 * c + 1] > wholeExtent[2 * c])
+        {
+            length2 += spacing[c] * spacing[c];
+        }
+    }
+    return std::sqrt(length2);
+}
+
+// Size in bytes of a legacy file data type, or 0 if it is not supported.
+int GetLegacyTypeSize(const std::string& type)
+{
+    if (type == "unsigned_char" || type == "char")
+    {
+        return 1;
+    }
+    if (type == "unsigned_short" || type == "short")
+    {
+        return 2;
+    }
+    if (type == "unsigned_int" || type == "int" || type == "float")
+    {
+        return 4;
+    }
+    if (type == "double")
+    {
+        return 8;
+    }
+    return 0;
+}
+
+// Skips `count` values of `typeSize` bytes (BINARY) or `count` numbers
+// (ASCII) of a data section.
+bool SkipLegacyValues(std::istream& in, bool binary, vtkIdType count, int typeSize)
+{
+    if (binary)
+    {
+        return typeSize > 0 && in.seekg(static_cast<std::streamoff>(count) * typeSize, std::ios::cur);
+    }
+    std::string token;
+    for (vtkIdType n = 0; n < count && in >> token; ++n)
+    {
+    }
+    return static_cast<bool>(in);
+}
+
+// Reads the vectors of `extent` from a legacy structured points file without
+// loading the rest of the field, which vtkStructuredPointsReader always does.
+// BINARY files are read row by row at computed offsets; ASCII files are
+// scanned once and only the values inside the extent are kept. Returns false
+// for files this does not handle (other datasets, cell or field data, vectors
+// that are not float or double), which are left to the VTK reader.
+bool ReadLegacyVectorBlock(const std::string& fileName, const int extent[6], double origin[3], double spacing[3],
+    std::vector<float>& values)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, 22, "# vtk DataFile Version") != 0 || !std::getline(in, line) ||
+        !std::getline(in, line))
+    {
+        return false;
+    }
+    const bool binary = line.compare(0, 6, "BINARY") == 0;
+
+    int dims[3] = { 0, 0, 0 };
+    vtkIdType numPoints = -1;
+    std::string vectorType;
+    std::fill(origin, origin + 3, 0.0);
+    std::fill(spacing, spacing + 3, 1.0);
+    while (vectorType.empty() && std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string keyword;
+        std::string name;
+        std::string type;
+        if (!(fields >> keyword))
+        {
+            continue;
+        }
+        bool ok = true;
+        if (keyword == "DATASET")
+        {
+            ok = (fields >> type) && type == "STRUCTURED_POINTS";
+        }
+        else if (keyword == "DIMENSIONS")
+        {
+            ok = static_cast<bool>(fields >> dims[0] >> dims[1] >> dims[2]);
+        }
+        else if (keyword == "ORIGIN")
+        {
+            ok = static_cast<bool>(fields >> origin[0] >> origin[1] >> origin[2]);
+        }
+        else if (keyword == "SPACING" || keyword == "ASPECT_RATIO")
+        {
+            ok = static_cast<bool>(fields >> spacing[0] >> spacing[1] >> spacing[2]);
+        }
+        else if (keyword == "POINT_DATA")
+        {
+            ok = (fields >> numPoints) && numPoints == static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+        }
+        else if (numPoints < 0)
+        {
+            ok = false;
+        }
+        else if (keyword == "SCALARS")
+        {
+            int components = 1;
+            fields >> name >> type;
+            fields >> components;
+            // Followed by a LOOKUP_TABLE line, then the values.
+            std::string table;
+            ok = std::getline(in, table) && table.compare(0, 12, "LOOKUP_TABLE") == 0 &&
+                SkipLegacyValues(in, binary, numPoints * std::max(components, 1), GetLegacyTypeSize(type));
+        }
+        else if (keyword == "LOOKUP_TABLE")
+        {
+            vtkIdType size = 0;
+            ok = (fields >> name >> size) && SkipLegacyValues(in, binary, 4 * size, 1);
+        }
+        else if (keyword == "NORMALS" || keyword == "TENSORS")
+        {
+            const int components = (keyword == "NORMALS") ? 3 : 9;
+            ok = (fields >> name >> type) &&
+                SkipLegacyValues(in, binary, numPoints * components, GetLegacyTypeSize(type));
+        }
+        else if (keyword == "VECTORS")
+        {
+            ok = (fields >> name >> vectorType) && (vectorType == "float" || vectorType == "double");
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    if (vectorType.empty() || extent[0] < 0 || extent[2] < 0 || extent[4] < 0 || extent[1] >= dims[0] ||
+        extent[3] >= dims[1] || extent[5] >= dims[2])
+    {
+        return false;
+    }
+
+    const int rowLength = extent[1] - extent[0] + 1;
+    const int numRows = (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+    values.resize(3 * static_cast<std::size_t>(rowLength) * numRows);
+    if (binary)
+    {
+        // Big-endian values, starting right after the VECTORS line.
+        const int typeSize = GetLegacyTypeSize(vectorType);
+        const std::streamoff start = in.tellg();
+        std::vector<char> buffer(3 * static_cast<std::size_t>(rowLength) * typeSize);
+        for (int row = 0; row < numRows; ++row)
+        {
+            const vtkIdType j = extent[2] + row % (extent[3] - extent[2] + 1);
+            const vtkIdType k = extent[4] + row / (extent[3] - extent[2] + 1);
+            const vtkIdType first = extent[0] + dims[0] * (j + dims[1] * k);
+            if (!in.seekg(start + static_cast<std::streamoff>(3 * first) * typeSize) ||
+                !in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+            {
+                return false;
+            }
+            float* out = &values[3 * static_cast<std::size_t>(row) * rowLength];
+            if (typeSize == 4)
+            {
+                vtkByteSwap::Swap4BERange(buffer.data(), 3 * rowLength);
+                std::memcpy(out, buffer.data(), buffer.size());
+            }
+            else
+            {
+                vtkByteSwap::Swap8BERange(buffer.data(), 3 * rowLength);
+                for (int n = 0; n < 3 * rowLength; ++n)
+                {
+                    double v;
+                    std::memcpy(&v, &buffer[8 * n], sizeof(v));
+                    out[n] = static_cast<float>(v);
+                }
+            }
+        }
+        return true;
+    }
+
+    // ASCII: points in file order, x fastest.
+    std::size_t next = 0;
+    for (int k = 0; k <= extent[5]; ++k)
+    {
+        for (int j = 0; j < dims[1]; ++j)
+        {
+            const bool rowInside = k >= extent[4] && j >= extent[2] && j <= extent[3];
+            for (int i = 0; i < dims[0]; ++i)
+            {
+                double v[3];
+                if (!(in >> v[0] >> v[1] >> v[2]))
+                {
+                    return false;
+                }
+                if (rowInside && i >= extent[0] && i <= extent[1])
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        values[next++] = static_cast<float>(v[c]);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Reads the vectors of `extent` with the reader flowVis uses for the file.
+// Readers that honour the update extent read only the block, others the
+// whole field.
+bool ReadVectorBlock(const std::string& fileName, const int extent[6], double origin[3], double spacing[3],
+    std::vector<float>& values)
+{
+    vtkSmartPointer<vtkAlgorithm> reader = FlowDatasetPool::CreateReader(fileName);
+    reader->UpdateInformation();
+    reader->UpdateExtent(extent);
+    vtkImageData* image = vtkImageData::SafeDownCast(reader->GetOutputDataObject(0));
+    vtkDataArray* vectors = image ? image->GetPointData()->GetVectors() : nullptr;
+    if (!vectors)
+    {
+        return false;
+    }
+
+    const int* e = image->GetExtent();
+    const int dims[3] = { extent[1] - extent[0] + 1, extent[3] - extent[2] + 1, extent[5] - extent[4] + 1 };
+    values.resize(3 * static_cast<std::size_t>(dims[0]) * dims[1] * dims[2]);
+    vtkSMPTools::For(0, static_cast<vtkIdType>(dims[1]) * dims[2], [&](vtkIdType begin, vtkIdType end) {
+        double v[3];
+        for (vtkIdType row = begin; row < end; ++row)
+        {
+            const vtkIdType j = extent[2] + row % dims[1] - e[2];
+            const vtkIdType k = extent[4] + row / dims[1] - e[4];
+            const vtkIdType first = (extent[0] - e[0]) + (e[1] - e[0] + 1) * (j + (e[3] - e[2] + 1) * k);
+            for (int i = 0; i < dims[0]; ++i)
+            {
+                vectors->GetTuple(first + i, v);
+                for (int c = 0; c < 3; ++c)
+                {
+                    values[3 * (row * dims[0] + i) + c] = static_cast<float>(v[c]);
+                }
+            }
+        }
+    });
+    std::copy(image->GetOrigin(), image->GetOrigin() + 3, origin);
+    std::copy(image->GetSpacing(), image->GetSpacing() + 3, spacing);
+    return true;
+}
+
+// One block of the grid with its ghost layers, traced on all of the
+// process's threads.
+class TraceWorker
+{
+public:
+    // Reads the block the setup message assigns. Returns false if the file
+    // has no vectors.
+    bool Setup(const std::vector<double>& message)
+    {
+        const double* p = message.data() + 1;
+        this->Index = static_cast<int>(*p++);
+        const int threads = static_cast<int>(*p++);
+        const int ghostLayers = static_cast<int>(*p++);
+        this->StepLength = *p++;
+        this->MaximumPropagation = *p++;
+        this->TerminalSpeed = *p++;
+        this->MaximumNumberOfSteps = static_cast<int>(*p++);
+        this->Layout = static_cast<FieldLayout>(static_cast<int>(*p++));
+        p = this->Blocks.Unpack(p);
+        const int nameLength = static_cast<int>(*p++);
+        std::string fileName;
+        for (int c = 0; c < nameLength; ++c)
+        {
+            fileName += static_cast<char>(*p++);
+        }
+
+        if (threads > 0)
+        {
+            vtkSMPTools::Initialize(threads);
+        }
+
+        // Legacy .vtk files, which vtkStructuredPointsReader always reads
+        // whole, are read directly; everything else through the VTK reader.
+        int extent[6];
+        this->Blocks.GetGhostExtent(this->Index, ghostLayers, extent);
+        std::vector<float> values;
+        double origin[3];
+        double spacing[3];
+        if (!ReadLegacyVectorBlock(fileName, extent, origin, spacing, values) &&
+            !ReadVectorBlock(fileName, extent, origin, spacing, values))
+        {
+            std::cerr << "trace-worker " << this->Index << ": no vectors in " << fileName << std::endl;
+            return false;
+        }
+
+        const int dims[3] = { extent[1] - extent[0] + 1, extent[3] - extent[2] + 1, extent[5] - extent[4] + 1 };
+        for (int c = 0; c < 3; ++c)
+        {
+            origin[c] += extent[2 * c] * spacing[c];
+        }
+        if (this->Layout == FieldLayout::Bricked)
+        {
+            this->BrickedField.SetGeometry(dims, origin, spacing);
+            this->BrickedField.GetStorage().Assign(values.data(), dims);
+        }
+        else
+        {
+            this->Field.SetGeometry(dims, origin, spacing);
+            this->Field.GetStorage().Assign(std::move(values), dims);
+        }
+        return true;
+    }
+
+    std::size_t GetMemorySize() const
+    {
+        return this->Field.GetStorage().GetMemorySize() + this->BrickedField.GetStorage().GetMemorySize();
+    }
+
+    // Advances every line of a trace message and returns a result message:
+    // the number of segments, then per segment its seed, segment number,
+    // point count and points, then the number of lines that left the block
+    // and their states.
+    void Trace(const std::vector<double>& message, std::vector<double>& result)
+    {
+        const vtkIdType numLines = static_cast<vtkIdType>((message.size() - 1) / StateSize);
+        std::vector<std::vector<double>> points(numLines);
+        std::vector<std::array<double, StateSize>> states(numLines);
+        std::vector<unsigned char> left(numLines, 0);
+        auto trace = [&](const auto& field) {
+            vtkSMPTools::For(0, numLines, [&](vtkIdType begin, vtkIdType end) {
+                for (vtkIdType l = begin; l < end; ++l)
+                {
+                    left[l] = this->TraceLine(field, &message[1 + StateSize * l], points[l], states[l].data());
+                }
+            });
+        };
+        if (this->Layout == FieldLayout::Bricked)
+        {
+            trace(this->BrickedField);
+        }
+        else
+        {
+            trace(this->Field);
+        }
+
+        result.assign(1, ResultMessage);
+        result.push_back(static_cast<double>(numLines));
+        for (vtkIdType l = 0; l < numLines; ++l)
+        {
+            const double* state = &message[1 + StateSize * l];
+            result.push_back(state[0]);
+            result.push_back(state[1]);
+            result.push_back(static_cast<double>(points[l].size() / 3));
+            result.insert(result.end(), points[l].begin(), points[l].end());
+        }
+        result.push_back(static_cast<double>(std::count(left.begin(), left.end(), 1)));
+        for (vtkIdType l = 0; l < numLines; ++l)
+        {
+            if (left[l])
+            {
+                result.insert(result.end(), states[l].begin(), states[l].end());
+            }
+        }
+    }
+
+private:
+    // Unit vector along the flow at x. False outside the block's data or
+    // below the terminal speed.
+    template <typename Storage>
+    bool GetDirection(const FlowField<Storage>& field, const double x[3], double d[3]) const
+    {
+        if (!field.Sample(x, d))
+        {
+            return false;
+        }
+        const double speed = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        if (!(speed >= this->TerminalSpeed) || speed == 0.0)
+        {
+            return false;
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            d[c] /= speed;
+        }
+        return true;
+    }
+
+    // Traces one line from its state until it terminates (false) or steps
+    // out of the block (true, with the state to continue from in `next`).
+    // The point where it left is the last point of this segment and the
+    // first of the next one.
+    template <typename Storage>
+    bool TraceLine(
+        const FlowField<Storage>& field, const double* state, std::vector<double>& points, double next[StateSize]) const
+    {
+        double x[3] = { state[2], state[3], state[4] };
+        double length = state[5];
+        int steps = static_cast<int>(state[6]);
+        points.assign(x, x + 3);
+
+        double k1[3];
+        double k2[3];
+        double k3[3];
+        double k4[3];
+        double y[3];
+        while (steps < this->MaximumNumberOfSteps && length < this->MaximumPropagation)
+        {
+            const double h = std::min(this->StepLength, this->MaximumPropagation - length);
+            if (!this->GetDirection(field, x, k1))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + 0.5 * h * k1[c];
+            }
+            if (!this->GetDirection(field, y, k2))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + 0.5 * h * k2[c];
+            }
+            if (!this->GetDirection(field, y, k3))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + h * k3[c];
+            }
+            if (!this->GetDirection(field, y, k4))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + h / 6.0 * (k1[c] + 2.0 * k2[c] + 2.0 * k3[c] + k4[c]);
+            }
+            if (this->Blocks.FindBlock(y) < 0)
+            {
+                return false;
+            }
+
+            std::copy(y, y + 3, x);
+            points.insert(points.end(), x, x + 3);
+            length += h;
+            ++steps;
+            if (!this->Blocks.Owns(this->Index, x))
+            {
+                next[0] = state[0];
+                next[1] = state[1] + 1;
+                std::copy(x, x + 3, next + 2);
+                next[5] = length;
+                next[6] = steps;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int Index = 0;
+    BlockDecomposition Blocks;
+    FieldLayout Layout = FieldLayout::Linear;
+    FlowField<> Field; // one of the two holds the block
+    FlowField<BrickedFloatStorage<>> BrickedField;
+    double StepLength = 0.0;
+    double MaximumPropagation = 0.0;
+    double TerminalSpeed = 0.0;
+    int MaximumNumberOfSteps = 0;
+};
+
+} // namespace
+
+int BlockDecomposition::Build(
+    const int wholeExtent[6], const double origin[3], const double spacing[3], int numberOfBlocks)
+{
+    std::copy(wholeExtent, wholeExtent + 6, this->WholeExtent);
+    std::copy(origin, origin + 3, this->Origin);
+    std::copy(spacing, spacing + 3, this->Spacing);
+    this->Extents.clear();
+
+    vtkSmartPointer<vtkExtentTranslator> translator = vtkSmartPointer<vtkExtentTranslator>::New();
+    int extent[6];
+    for (int piece = 0; piece < std::max(numberOfBlocks, 1); ++piece)
+    {
+        if (translator->PieceToExtentThreadSafe(piece, std::max(numberOfBlocks, 1), 0, this->WholeExtent, extent,
+                vtkExtentTranslator::BLOCK_MODE, 0) &&
+            extent[0] <= extent[1] && extent[2] <= extent[3] && extent[4] <= extent[5])
+        {
+            this->Extents.insert(this->Extents.end(), extent, extent + 6);
+        }
+    }
+    return this->GetNumberOfBlocks();
+}
+
+void BlockDecomposition::GetBounds(double bounds[6]) const
+{
+    for (int c = 0; c < 3; ++c)
+    {
+        bounds[2 * c] = this->Origin[c] + this->WholeExtent[2 * c] * this->Spacing[c];
+        bounds[2 * c + 1] = this->Origin[c] + this->WholeExtent[2 * c + 1] * this->Spacing[c];
+    }
+}
+
+void BlockDecomposition::GetGhostExtent(int block, int layers, int extent[6]) const
+{
+    const int* e = this->GetExtent(block);
+    for (int c = 0; c < 3; ++c)
+    {
+        extent[2 * c] = std::max(e[2 * c] - layers, this->WholeExtent[2 * c]);
+        extent[2 * c + 1] = std::min(e[2 * c + 1] + layers, this->WholeExtent[2 * c + 1]);
+    }
+}
+
+bool BlockDecomposition::Owns(int block, const double x[3]) const
+{
+    const int* e = this->GetExtent(block);
+    for (int c = 0; c < 3; ++c)
+    {
+        const int* w = this->WholeExtent + 2 * c;
+        if (w[0] == w[1])
+        {
+            continue;
+        }
+        const double t = (x[c] - this->Origin[c]) / this->Spacing[c];
+        const bool last = (e[2 * c + 1] == w[1]);
+        if (!(t >= e[2 * c] && (t < e[2 * c + 1] || (last && t <= e[2 * c + 1]))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int BlockDecomposition::FindBlock(const double x[3]) const
+{
+    for (int block = 0; block < this->GetNumberOfBlocks(); ++block)
+    {
+        if (this->Owns(block, x))
+        {
+            return block;
+        }
+    }
+    return -1;
+}
+
+void BlockDecomposition::Pack(std::vector<double>& buffer) const
+{
+    buffer.insert(buffer.end(), this->WholeExtent, this->WholeExtent + 6);
+    buffer.insert(buffer.end(), this->Origin, this->Origin + 3);
+    buffer.insert(buffer.end(), this->Spacing, this->Spacing + 3);
+    buffer.push_back(static_cast<double>(this->GetNumberOfBlocks()));
+    buffer.insert(buffer.end(), this->Extents.begin(), this->Extents.end());
+}
+
+const double* BlockDecomposition::Unpack(const double* buffer)
+{
+    std::copy(buffer, buffer + 6, this->WholeExtent);
+    std::copy(buffer + 6, buffer + 9, this->Origin);
+    std::copy(buffer + 9, buffer + 12, this->Spacing);
+    const int numBlocks = static_cast<int>(buffer[12]);
+    this->Extents.assign(buffer + 13, buffer + 13 + 6 * numBlocks);
+    return buffer + 13 + 6 * numBlocks;
+}
+
+// The worker connections of one Run(). Workers that are still connected are
+// told to quit, and spawned processes are waited for, when it goes away.
+struct DistributedTracer::Connections
+{
+    vtkSmartPointer<vtkServerSocket> Server;
+    std::vector<vtkSmartPointer<vtkSocketCommunicator>> Workers;
+    std::vector<vtksysProcess*> Processes;
+
+    ~Connections()
+    {
+        const std::vector<double> quit(1, QuitMessage);
+        for (vtkSocketCommunicator* worker : this->Workers)
+        {
+            if (worker)
+            {
+                SendBuffer(worker, quit);
+                worker->CloseConnection();
+            }
+        }
+        for (vtksysProcess* process : this->Processes)
+        {
+            double timeout = 10.0;
+            if (!vtksysProcess_WaitForExit(process, &timeout))
+            {
+                vtksysProcess_Kill(process);
+                vtksysProcess_WaitForExit(process, nullptr);
+            }
+            vtksysProcess_Delete(process);
+        }
+    }
+};
+
+DistributedTracer::DistributedTracer() = default;
+
+DistributedTracer::~DistributedTracer() = default;
+
+void DistributedTracer::SetSeeds(vtkPoints* seeds)
+{
+    this->Seeds.resize(3 * seeds->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < seeds->GetNumberOfPoints(); ++i)
+    {
+        seeds->GetPoint(i, &this->Seeds[3 * i]);
+    }
+}
+
+bool DistributedTracer::SetSeedGrid(int spacing)
+{
+    if (!this->UpdateInformation())
+    {
+        return false;
+    }
+    FlowDataset grid;
+    this->Blocks.GetBounds(grid.Bounds);
+    const int* wholeExtent = this->Blocks.GetWholeExtent();
+    for (int c = 0; c < 3; ++c)
+    {
+        grid.Dimensions[c] = wholeExtent[2 * c + 1] - wholeExtent[2 * c] + 1;
+    }
+    vtkSmartPointer<vtkPolyData> seeds = vtkSmartPointer<vtkPolyData>::New();
+    SetStartingPoints(seeds, grid, spacing);
+    this->SetSeeds(seeds->GetPoints());
+    return true;
+}
+
+bool DistributedTracer::UpdateInformation()
+{
+    vtkSmartPointer<vtkAlgorithm> reader = FlowDatasetPool::CreateReader(this->FileName);
+    reader->UpdateInformation();
+    vtkInformation* info = reader->GetOutputInformation(0);
+    int wholeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    if (info->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+    {
+        info->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+    }
+    if (info->Has(vtkDataObject::ORIGIN()))
+    {
+        info->Get(vtkDataObject::ORIGIN(), origin);
+    }
+    if (info->Has(vtkDataObject::SPACING()))
+    {
+        info->Get(vtkDataObject::SPACING(), spacing);
+    }
+    if (wholeExtent[0] > wholeExtent[1] || wholeExtent[2] > wholeExtent[3] || wholeExtent[4] > wholeExtent[5])
+    {
+        std::cerr << "DistributedTracer: unable to read " << this->FileName << std::endl;
+        return false;
+    }
+    this->Blocks.Build(wholeExtent, origin, spacing, this->NumberOfWorkers);
+    return true;
+}
+
+bool DistributedTracer::Run()
+{
+    const double start = vtkTimerLog::GetUniversalTime();
+    this->Output = nullptr;
+    this->NumberOfRounds = 0;
+    this->NumberOfHandoffs = 0;
+    if (!this->UpdateInformation())
+    {
+        return false;
+    }
+
+    Connections connections;
+    if (!this->Connect(connections))
+    {
+        return false;
+    }
+    this->StartupTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+
+    const double traceStart = vtkTimerLog::GetUniversalTime();
+    if (!this->Trace(connections))
+    {
+        return false;
+    }
+    this->TraceTime = (vtkTimerLog::GetUniversalTime() - traceStart) * 1000.0;
+    this->BuildOutput();
+    return true;
+}
+
+bool DistributedTracer::Connect(Connections& connections)
+{
+    const int numBlocks = this->Blocks.GetNumberOfBlocks();
+    InitializeSockets();
+    // Spawned workers run on this machine, so nothing else may connect.
+    // Workers started by hand can be on any host.
+    int status;
+    if (this->SpawnWorkers)
+    {
+        vtkSmartPointer<vtkLoopbackServerSocket> server = vtkSmartPointer<vtkLoopbackServerSocket>::New();
+        status = server->CreateLoopbackServer(this->Port);
+        connections.Server = server;
+    }
+    else
+    {
+        connections.Server = vtkSmartPointer<vtkServerSocket>::New();
+        status = connections.Server->CreateServer(this->Port);
+    }
+    if (status != 0)
+    {
+        std::cerr << "DistributedTracer: unable to listen on port " << this->Port << std::endl;
+        return false;
+    }
+    const std::string port = std::to_string(connections.Server->GetServerPort());
+
+    if (this->SpawnWorkers)
+    {
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            const std::string index = std::to_string(i);
+            const char* command[] = { this->Executable.c_str(), "trace-worker", "127.0.0.1", port.c_str(),
+                index.c_str(), nullptr };
+            vtksysProcess* process = vtksysProcess_New();
+            vtksysProcess_SetCommand(process, command);
+            vtksysProcess_SetPipeShared(process, vtksysProcess_Pipe_STDOUT, 1);
+            vtksysProcess_SetPipeShared(process, vtksysProcess_Pipe_STDERR, 1);
+            vtksysProcess_Execute(process);
+            connections.Processes.push_back(process);
+            if (vtksysProcess_GetState(process) != vtksysProcess_State_Executing)
+            {
+                std::cerr << "DistributedTracer: unable to start " << this->Executable << std::endl;
+                return false;
+            }
+        }
+    }
+    else
+    {
+        std::cout << "waiting for " << numBlocks << " workers: flowVis trace-worker <host> " << port
+                  << " <0.." << numBlocks - 1 << ">" << std::endl;
+    }
+
+    // Workers connect in any order and introduce themselves by index.
+    connections.Workers.resize(numBlocks);
+    for (int n = 0; n < numBlocks; ++n)
+    {
+        vtkSmartPointer<vtkSocketCommunicator> worker = vtkSmartPointer<vtkSocketCommunicator>::New();
+        std::vector<double> hello;
+        if (!worker->WaitForConnection(connections.Server, this->SpawnWorkers ? 60000 : 0) ||
+            !ReceiveBuffer(worker, hello) || hello.size() != 1)
+        {
+            std::cerr << "DistributedTracer: a worker did not connect" << std::endl;
+            return false;
+        }
+        const int index = static_cast<int>(hello[0]);
+        if (index < 0 || index >= numBlocks || connections.Workers[index])
+        {
+            std::cerr << "DistributedTracer: unexpected worker " << index << std::endl;
+            return false;
+        }
+        connections.Workers[index] = worker;
+    }
+
+    // Ghost layers for the RK4 stages, which reach up to one step from a
+    // point of the block, plus one for the interpolation.
+    const double* spacing = this->Blocks.GetSpacing();
+    const double stepLength = this->StepSize * GetCellLength(this->Blocks.GetWholeExtent(), spacing);
+    double minSpacing = VTK_DOUBLE_MAX;
+    for (int c = 0; c < 3; ++c)
+    {
+        minSpacing = std::min(minSpacing, std::abs(spacing[c]));
+    }
+    const int ghostLayers = static_cast<int>(std::ceil(stepLength / minSpacing)) + 1;
+
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        std::vector<double> setup = { SetupMessage, static_cast<double>(i), static_cast<double>(this->ThreadsPerWorker),
+            static_cast<double>(ghostLayers), stepLength, this->MaximumPropagation, this->TerminalSpeed,
+            static_cast<double>(this->MaximumNumberOfSteps), static_cast<double>(this->Layout) };
+        this->Blocks.Pack(setup);
+        setup.push_back(static_cast<double>(this->FileName.size()));
+        for (char c : this->FileName)
+        {
+            setup.push_back(static_cast<unsigned char>(c));
+        }
+        if (!SendBuffer(connections.Workers[i], setup))
+        {
+            return false;
+        }
+    }
+
+    // Ready: success, bytes of vector data, KiB of process memory.
+    this->WorkerFieldMemory.assign(numBlocks, 0.0);
+    this->WorkerProcessMemory.assign(numBlocks, 0.0);
+    bool ready = true;
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        std::vector<double> message;
+        if (!ReceiveBuffer(connections.Workers[i], message) || message.size() != 4 || message[0] != ReadyMessage ||
+            message[1] == 0.0)
+        {
+            std::cerr << "DistributedTracer: worker " << i << " failed to load its block" << std::endl;
+            ready = false;
+            continue;
+        }
+        this->WorkerFieldMemory[i] = message[2];
+        this->WorkerProcessMemory[i] = message[3];
+    }
+    return ready;
+}
+
+bool DistributedTracer::Trace(Connections& connections)
+{
+    const int numBlocks = this->Blocks.GetNumberOfBlocks();
+    const vtkIdType numSeeds = static_cast<vtkIdType>(this->Seeds.size() / 3);
+    this->Segments.assign(numSeeds, std::vector<std::vector<double>>());
+
+    std::vector<std::vector<double>> pending(numBlocks);
+    for (vtkIdType s = 0; s < numSeeds; ++s)
+    {
+        const double* x = &this->Seeds[3 * s];
+        const int block = this->Blocks.FindBlock(x);
+        if (block >= 0)
+        {
+            const double state[StateSize] = { static_cast<double>(s), 0.0, x[0], x[1], x[2], 0.0, 0.0 };
+            pending[block].insert(pending[block].end(), state, state + StateSize);
+        }
+    }
+
+    std::vector<double> message;
+    for (;;)
+    {
+        // Every worker with lines traces them at the same time; the results
+        // are collected in block order.
+        std::vector<int> active;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            if (pending[b].empty())
+            {
+                continue;
+            }
+            message.assign(1, TraceMessage);
+            message.insert(message.end(), pending[b].begin(), pending[b].end());
+            if (!SendBuffer(connections.Workers[b], message))
+            {
+                return false;
+            }
+            pending[b].clear();
+            active.push_back(b);
+        }
+        if (active.empty())
+        {
+            return true;
+        }
+        ++this->NumberOfRounds;
+
+        for (int b : active)
+        {
+            if (!ReceiveBuffer(connections.Workers[b], message) || message.empty() || message[0] != ResultMessage ||
+                !this->ReadResult(message, pending))
+            {
+                std::cerr << "DistributedTracer: lost worker " << b << std::endl;
+                return false;
+            }
+        }
+    }
+}
+
+// Workers are other processes, possibly on other hosts, so every count and
+// index is checked against the message and the tracing limits before use.
+bool DistributedTracer::ReadResult(const std::vector<double>& message, std::vector<std::vector<double>>& pending)
+{
+    const double numSeeds = static_cast<double>(this->Segments.size());
+    // Every segment but the first starts with a step, and a segment has at
+    // most one point per step plus its start.
+    const double maxSegment = static_cast<double>(this->MaximumNumberOfSteps);
+    const double maxPoints = static_cast<double>(this->MaximumNumberOfSteps) + 1.0;
+    auto remaining = [&](const double* p) { return static_cast<double>(message.data() + message.size() - p); };
+    // Seed and segment number of a segment or of a line state.
+    auto isValidLine = [&](const double* p) {
+        return p[0] >= 0.0 && p[0] < numSeeds && p[1] >= 0.0 && p[1] <= maxSegment;
+    };
+
+    const double* p = message.data() + 1;
+    if (!(remaining(p) >= 1.0 && p[0] >= 0.0 && p[0] <= remaining(p) / 3.0))
+    {
+        return false;
+    }
+    const vtkIdType numSegments = static_cast<vtkIdType>(*p++);
+    for (vtkIdType n = 0; n < numSegments; ++n)
+    {
+        if (!(remaining(p) >= 3.0 && isValidLine(p) && p[2] >= 0.0 && p[2] <= maxPoints &&
+                3.0 * p[2] <= remaining(p) - 3.0))
+        {
+            return false;
+        }
+        const vtkIdType seed = static_cast<vtkIdType>(p[0]);
+        const std::size_t segment = static_cast<std::size_t>(p[1]);
+        const std::size_t numValues = 3 * static_cast<std::size_t>(p[2]);
+        p += 3;
+        std::vector<std::vector<double>>& segments = this->Segments[seed];
+        segments.resize(std::max(segments.size(), segment + 1));
+        segments[segment].assign(p, p + numValues);
+        p += numValues;
+    }
+
+    if (!(remaining(p) >= 1.0 && p[0] >= 0.0 && p[0] * StateSize == remaining(p) - 1.0))
+    {
+        return false;
+    }
+    const vtkIdType numLeft = static_cast<vtkIdType>(*p++);
+    for (vtkIdType n = 0; n < numLeft; ++n, p += StateSize)
+    {
+        if (!isValidLine(p))
+        {
+            return false;
+        }
+        const int block = this->Blocks.FindBlock(p + 2);
+        if (block >= 0)
+        {
+            pending[block].insert(pending[block].end(), p, p + StateSize);
+            ++this->NumberOfHandoffs;
+        }
+    }
+    return true;
+}
+
+void DistributedTracer::BuildOutput()
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkIdTypeArray> seedIds = vtkSmartPointer<vtkIdTypeArray>::New();
+    seedIds->SetName("SeedIds");
+
+    // Consecutive segments share the point where the line changed blocks.
+    for (vtkIdType seed = 0; seed < static_cast<vtkIdType>(this->Segments.size()); ++seed)
+    {
+        std::vector<double> line;
+        for (const std::vector<double>& segment : this->Segments[seed])
+        {
+            line.insert(line.end(), segment.begin() + (line.empty() ? 0 : std::min<std::size_t>(3, segment.size())),
+                segment.end());
+        }
+        const vtkIdType numPoints = static_cast<vtkIdType>(line.size() / 3);
+        if (numPoints < 2)
+        {
+            continue;
+        }
+        lines->InsertNextCell(numPoints);
+        for (vtkIdType i = 0; i < numPoints; ++i)
+        {
+            lines->InsertCellPoint(points->InsertNextPoint(&line[3 * i]));
+        }
+        seedIds->InsertNextValue(seed);
+    }
+
+    this->Output = vtkSmartPointer<vtkPolyData>::New();
+    this->Output->SetPoints(points);
+    this->Output->SetLines(lines);
+    this->Output->GetCellData()->AddArray(seedIds);
+    this->Segments.clear();
+}
+
+vtkPolyData* DistributedTracer::GetOutput()
+{
+    return this->Output;
+}
+
+int RunTraceWorker(const std::string& host, int port, int index)
+{
+    InitializeSockets();
+    vtkSmartPointer<vtkSocketCommunicator> coordinator = vtkSmartPointer<vtkSocketCommunicator>::New();
+    if (!coordinator->ConnectTo(host.c_str(), port))
+    {
+        std::cerr << "trace-worker " << index << ": unable to connect to " << host << ":" << port << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<double> message(1, static_cast<double>(index));
+    if (!SendBuffer(coordinator, message) || !ReceiveBuffer(coordinator, message) || message.empty() ||
+        message[0] != SetupMessage)
+    {
+        return EXIT_FAILURE;
+    }
+    TraceWorker worker;
+    const bool loaded = worker.Setup(message);
+    vtksys::SystemInformation system;
+    const std::vector<double> ready = { ReadyMessage, loaded ? 1.0 : 0.0,
+        static_cast<double>(worker.GetMemorySize()), static_cast<double>(system.GetProcMemoryUsed()) };
+    if (!SendBuffer(coordinator, ready) || !loaded)
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<double> result;
+    while (ReceiveBuffer(coordinator, message) && !message.empty() && message[0] == TraceMessage)
+    {
+        worker.Trace(message, result);
+        if (!SendBuffer(coordinator, result))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    coordinator->CloseConnection();
+    return EXIT_SUCCESS;
+}
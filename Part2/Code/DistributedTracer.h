@@ -0,0 +1,184 @@
+#ifndef DistributedTracer_h
+#define DistributedTracer_h
+
+#include "FlowField.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkType.h"
+
+#include <string>
+#include <vector>
+
+class vtkPoints;
+class vtkPolyData;
+
+// A split of the points of a structured grid into blocks, one per worker.
+// Neighbouring blocks share the plane of points between them; a position on
+// that plane belongs to the block above it, except on the upper boundary of
+// the grid. Axes with a single point are ignored.
+class BlockDecomposition
+{
+public:
+    // vtkExtentTranslator's block split. Returns the number of blocks, which
+    // is lower than asked for when the grid has too few cells.
+    int Build(const int wholeExtent[6], const double origin[3], const double spacing[3], int numberOfBlocks);
+
+    int GetNumberOfBlocks() const { return static_cast<int>(this->Extents.size() / 6); }
+    const int* GetWholeExtent() const { return this->WholeExtent; }
+    const double* GetSpacing() const { return this->Spacing; }
+    void GetBounds(double bounds[6]) const;
+    const int* GetExtent(int block) const { return &this->Extents[6 * block]; }
+
+    // The block's extent grown by `layers` points on each side, clamped to
+    // the grid.
+    void GetGhostExtent(int block, int layers, int extent[6]) const;
+
+    bool Owns(int block, const double x[3]) const;
+
+    // Owning block, or -1 outside the grid.
+    int FindBlock(const double x[3]) const;
+
+    // Flat form sent to the workers.
+    void Pack(std::vector<double>& buffer) const;
+    const double* Unpack(const double* buffer);
+
+private:
+    int WholeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    double Origin[3] = { 0.0, 0.0, 0.0 };
+    double Spacing[3] = { 1.0, 1.0, 1.0 };
+    std::vector<int> Extents;
+};
+
+// Streamline tracing split across worker processes, for fields larger than
+// one process can hold.
+//
+// The grid is decomposed into one block per worker. Each worker reads only
+// its block plus enough ghost layers that every RK4 stage of a step that
+// starts in the block can be interpolated locally, so lines cross block
+// boundaries without gaps and give the same result for any number of
+// workers up to rounding. The workers are flowVis processes ("trace-worker")
+// that connect back to this coordinator over a vtkSocketCommunicator, so
+// they can run on this machine (spawned by Run() on the loopback interface)
+// or be started by hand on other hosts.
+//
+// Tracing runs in rounds. The coordinator sends every worker the lines that
+// are currently in its block; the worker advances them in parallel until
+// each one terminates or steps into another block, and returns the points it
+// traced as one segment per line together with the integration state (seed,
+// segment number, position, arc length, steps) of the lines that left. The
+// coordinator routes those to their new owners for the next round and stops
+// when no line is left. Segments are stored by seed and segment number, so
+// the output has one polyline per seed in seed order, however the lines were
+// scheduled.
+//
+// The integration follows Solution3_Carotid's vtkStreamTracer: RK4 along the
+// normalized field with steps of StepSize cell lengths, ending at the
+// boundary, below TerminalSpeed, after MaximumPropagation or after
+// MaximumNumberOfSteps steps.
+class DistributedTracer
+{
+public:
+    DistributedTracer();
+    ~DistributedTracer();
+
+    void SetFileName(const std::string& fileName) { this->FileName = fileName; }
+
+    // flowVis, started as `<executable> trace-worker <host> <port> <index>`.
+    void SetExecutable(const std::string& executable) { this->Executable = executable; }
+
+    void SetNumberOfWorkers(int workers) { this->NumberOfWorkers = workers; }
+
+    // vtkSMPTools threads of each worker; 0 leaves the worker's default.
+    void SetThreadsPerWorker(int threads) { this->ThreadsPerWorker = threads; }
+
+    // With SpawnWorkers off, Run() waits on Port for workers started
+    // elsewhere. Port 0 picks a free port when spawning.
+    void SetSpawnWorkers(bool spawn) { this->SpawnWorkers = spawn; }
+    void SetPort(int port) { this->Port = port; }
+
+    void SetStepSize(double cellLengths) { this->StepSize = cellLengths; }
+    void SetMaximumPropagation(double length) { this->MaximumPropagation = length; }
+    void SetTerminalSpeed(double speed) { this->TerminalSpeed = speed; }
+    void SetMaximumNumberOfSteps(int steps) { this->MaximumNumberOfSteps = steps; }
+
+    // Layout of each worker's copy of its block. Lines that move along y or
+    // z touch fewer cache lines and pages in the bricked one; the traced
+    // points are the same.
+    void SetLayout(FieldLayout layout) { this->Layout = layout; }
+    FieldLayout GetLayout() const { return this->Layout; }
+
+    // Reads the grid geometry from the file header, without the data, and
+    // decomposes the grid. Run() calls it; call it first to place seeds.
+    bool UpdateInformation();
+    const BlockDecomposition& GetBlocks() const { return this->Blocks; }
+
+    void SetSeeds(vtkPoints* seeds);
+
+    // Seeds on the streamline mode's grid (SetStartingPoints) with the given
+    // spacing. Returns false if the file header could not be read.
+    bool SetSeedGrid(int spacing);
+
+    // Starts and connects the workers, traces all seeds and shuts the
+    // workers down. Returns false if the file or a worker failed.
+    bool Run();
+
+    // Polylines with a "SeedIds" cell array, for seeds that moved.
+    vtkPolyData* GetOutput();
+
+    // Milliseconds to start, connect and load the workers, and to trace.
+    double GetStartupTime() const { return this->StartupTime; }
+    double GetTraceTime() const { return this->TraceTime; }
+
+    int GetNumberOfRounds() const { return this->NumberOfRounds; }
+    vtkIdType GetNumberOfHandoffs() const { return this->NumberOfHandoffs; }
+
+    // Per worker, as reported after loading: bytes of vector data held and
+    // KiB used by the whole process.
+    const std::vector<double>& GetWorkerFieldMemory() const { return this->WorkerFieldMemory; }
+    const std::vector<double>& GetWorkerProcessMemory() const { return this->WorkerProcessMemory; }
+
+private:
+    DistributedTracer(const DistributedTracer&) = delete;
+    void operator=(const DistributedTracer&) = delete;
+
+    struct Connections;
+
+    bool Connect(Connections& connections);
+    bool Trace(Connections& connections);
+    // Stores the segments of a worker's result message and queues the lines
+    // that left its block. False if the message is malformed.
+    bool ReadResult(const std::vector<double>& message, std::vector<std::vector<double>>& pending);
+    void BuildOutput();
+
+    std::string FileName;
+    std::string Executable;
+    int NumberOfWorkers = 2;
+    int ThreadsPerWorker = 0;
+    bool SpawnWorkers = true;
+    int Port = 0;
+
+    double StepSize = 0.2;
+    double MaximumPropagation = 100.0;
+    double TerminalSpeed = 0.01;
+    int MaximumNumberOfSteps = 2000;
+    FieldLayout Layout = FieldLayout::Linear;
+
+    std::vector<double> Seeds;
+    BlockDecomposition Blocks;
+    // Per seed, the points of each segment as x, y, z triples.
+    std::vector<std::vector<std::vector<double>>> Segments;
+    vtkSmartPointer<vtkPolyData> Output;
+
+    double StartupTime = 0.0;
+    double TraceTime = 0.0;
+    int NumberOfRounds = 0;
+    vtkIdType NumberOfHandoffs = 0;
+    std::vector<double> WorkerFieldMemory;
+    std::vector<double> WorkerProcessMemory;
+};
+
+// The worker side: connects to the coordinator at host:port, loads its block
+// and traces until told to stop. Returns a process exit code.
+int RunTraceWorker(const std::string& host, int port, int index);
+
+#endif
@@ -0,0 +1,1172 @@
+#include "FlowBenchmarks.h"
+
+#include "CompactStreamlines.h"
+#include "DistributedTracer.h"
+#include "FlowDatasetPool.h"
+#include "FlowPipelines.h"
+#include "ParticleSystem.h"
+#include "VolumeHistogram.h"
+
+#include "vtkCpuVolumeActor.h"
+#include "vtkInstancedGlyph3D.h"
+#include "vtkMultiIsoSurface.h"
+#include "vtkParallelGlyph3D.h"
+#include "vtkParallelHedgeHog.h"
+#include "vtkParallelPolyDataWriter.h"
+
+#include "vtkCamera.h"
+#include "vtkCellArray.h"
+#include "vtkColorTransferFunction.h"
+#include "vtkConeSource.h"
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "vtkFlyingEdges3D.h"
+#include "vtkGlyph3D.h"
+#include "vtkHedgeHog.h"
+#include "vtkImageData.h"
+#include "vtkMath.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkStreamTracer.h"
+#include "vtkStripper.h"
+#include "vtkSmartPointer.h"
+#include "vtkStructuredPoints.h"
+#include "vtkStructuredPointsReader.h"
+#include "vtkTimerLog.h"
+#include "vtkXMLPolyDataReader.h"
+#include "vtkXMLPolyDataWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// Best wall time in milliseconds over `repeats` forced re-executions.
+double TimeUpdate(vtkAlgorithm* algorithm, int repeats)
+{
+    double best = 0.0;
+    for (int r = 0; r < repeats; ++r)
+    {
+        algorithm->Modified();
+        double start = vtkTimerLog::GetUniversalTime();
+        algorithm->Update();
+        double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+        best = (r == 0) ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+bool SameArray(vtkDataArray* a, vtkDataArray* b)
+{
+    if (!a || !b)
+    {
+        return a == b;
+    }
+    if (a->GetDataType() != b->GetDataType() || a->GetNumberOfValues() != b->GetNumberOfValues())
+    {
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(a->GetNumberOfValues()) * a->GetDataTypeSize();
+    return bytes == 0 || memcmp(a->GetVoidPointer(0), b->GetVoidPointer(0), bytes) == 0;
+}
+
+bool SamePolyData(vtkPolyData* a, vtkPolyData* b)
+{
+    return SameArray(a->GetPoints()->GetData(), b->GetPoints()->GetData()) &&
+        SameArray(a->GetPointData()->GetNormals(), b->GetPointData()->GetNormals()) &&
+        SameArray(a->GetPointData()->GetScalars(), b->GetPointData()->GetScalars()) &&
+        SameArray(a->GetPolys()->GetConnectivityArray(), b->GetPolys()->GetConnectivityArray()) &&
+        SameArray(a->GetLines()->GetConnectivityArray(), b->GetLines()->GetConnectivityArray());
+}
+
+// Root mean square difference of two images of the same size, 0..255.
+double ImageRMSE(vtkImageData* a, vtkImageData* b)
+{
+    const unsigned char* pa = static_cast<const unsigned char*>(a->GetScalarPointer());
+    const unsigned char* pb = static_cast<const unsigned char*>(b->GetScalarPointer());
+    const vtkIdType count = a->GetNumberOfPoints() * a->GetNumberOfScalarComponents();
+    double sum = 0.0;
+    for (vtkIdType i = 0; i < count; ++i)
+    {
+        double d = static_cast<double>(pa[i]) - pb[i];
+        sum += d * d;
+    }
+    return count > 0 ? std::sqrt(sum / count) : 0.0;
+}
+
+// Triangles in the polygons and triangle strips of `surface`.
+vtkIdType CountTriangles(vtkPolyData* surface)
+{
+    vtkIdType count = 0;
+    vtkIdType npts;
+    const vtkIdType* pts;
+    vtkCellArray* strips = surface->GetStrips();
+    for (strips->InitTraversal(); strips->GetNextCell(npts, pts);)
+    {
+        count += npts - 2;
+    }
+    vtkCellArray* polys = surface->GetPolys();
+    for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+        count += npts - 2;
+    }
+    return count;
+}
+
+vtkTypeUInt64 GetFileSize(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return file ? static_cast<vtkTypeUInt64>(file.tellg()) : 0;
+}
+
+// Same tuples and values, whatever the storage type.
+bool SameValues(vtkDataArray* a, vtkDataArray* b)
+{
+    if (!a || !b)
+    {
+        return a == b;
+    }
+    if (a->GetNumberOfValues() != b->GetNumberOfValues())
+    {
+        return false;
+    }
+    const int components = a->GetNumberOfComponents();
+    for (vtkIdType i = 0; i < a->GetNumberOfValues(); ++i)
+    {
+        if (a->GetComponent(i / components, i % components) != b->GetComponent(i / components, i % components))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies the vectors of `image` into a FlowField<Storage> and samples it at
+// every position in parallel. Returns the best sampling time in ms.
+template <typename Storage>
+double SampleField(vtkImageData* image, const std::vector<double>& positions, std::vector<double>& vectors,
+    std::size_t& memorySize)
+{
+    FlowField<Storage> field;
+    field.Assign(image);
+    memorySize = field.GetStorage().GetMemorySize();
+
+    const vtkIdType numPositions = static_cast<vtkIdType>(positions.size() / 3);
+    vectors.resize(positions.size());
+    double best = 0.0;
+    for (int r = 0; r < 3; ++r)
+    {
+        double start = vtkTimerLog::GetUniversalTime();
+        vtkSMPTools::For(0, numPositions, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType i = begin; i < end; ++i)
+            {
+                field.Sample(&positions[3 * i], &vectors[3 * i]);
+            }
+        });
+        double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+        best = (r == 0) ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+// Samples `field` at every position in parallel. Returns the best time of
+// three runs in ms.
+template <typename Storage>
+double TimeSamples(const FlowField<Storage>& field, const std::vector<double>& positions, std::vector<double>& vectors)
+{
+    const vtkIdType numPositions = static_cast<vtkIdType>(positions.size() / 3);
+    vectors.assign(positions.size(), 0.0);
+    double best = 0.0;
+    for (int r = 0; r < 3; ++r)
+    {
+        double start = vtkTimerLog::GetUniversalTime();
+        vtkSMPTools::For(0, numPositions, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType i = begin; i < end; ++i)
+            {
+                field.Sample(&positions[3 * i], &vectors[3 * i]);
+            }
+        });
+        double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+        best = (r == 0) ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+// Cache lines (64 bytes) and pages (4 KiB) spanned by the vectors of the
+// eight corners of a sample, averaged over up to 100000 samples. The layout
+// alone decides them, so they stand in for hardware miss counters.
+template <typename Storage>
+void MeasureFootprint(const FlowField<Storage>& field, const std::vector<double>& positions, double& lines,
+    double& pages)
+{
+    const int* dims = field.GetDimensions();
+    const std::size_t numSamples = std::min<std::size_t>(positions.size() / 3, 100000);
+    std::size_t totalLines = 0;
+    std::size_t totalPages = 0;
+    for (std::size_t s = 0; s < numSamples; ++s)
+    {
+        int i0[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            i0[c] = std::min(static_cast<int>(positions[3 * s + c]), std::max(dims[c] - 2, 0));
+        }
+        std::vector<std::size_t> cacheLines;
+        std::vector<std::size_t> memoryPages;
+        for (int n = 0; n < 8; ++n)
+        {
+            const std::size_t first = sizeof(float) *
+                field.GetStorage().GetOffset(i0[0] + (n & 1), i0[1] + ((n >> 1) & 1), i0[2] + ((n >> 2) & 1));
+            const std::size_t last = first + 3 * sizeof(float) - 1;
+            for (std::size_t byte : { first, last })
+            {
+                cacheLines.push_back(byte / 64);
+                memoryPages.push_back(byte / 4096);
+            }
+        }
+        std::sort(cacheLines.begin(), cacheLines.end());
+        std::sort(memoryPages.begin(), memoryPages.end());
+        totalLines += std::unique(cacheLines.begin(), cacheLines.end()) - cacheLines.begin();
+        totalPages += std::unique(memoryPages.begin(), memoryPages.end()) - memoryPages.begin();
+    }
+    lines = numSamples ? static_cast<double>(totalLines) / numSamples : 0.0;
+    pages = numSamples ? static_cast<double>(totalPages) / numSamples : 0.0;
+}
+
+// 1, 2, 4, ... up to and including the number of threads vtkSMPTools uses.
+std::vector<int> GetThreadCounts()
+{
+    int maxThreads = std::max(1, vtkSMPTools::GetEstimatedNumberOfThreads());
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2)
+    {
+        counts.push_back(n);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+} // namespace
+
+int RunGlyphBenchmark(const std::string& fileName, int repeats)
+{
+    vtkSmartPointer<vtkStructuredPointsReader> reader = vtkSmartPointer<vtkStructuredPointsReader>::New();
+    reader->SetFileName(fileName.c_str());
+    reader->Update();
+    vtkStructuredPoints* data = reader->GetOutput();
+    if (!data || data->GetNumberOfPoints() == 0 || !data->GetPointData()->GetVectors())
+    {
+        std::cerr << "bench-glyph: " << fileName << " has no vectors" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkConeSource> coneSource = vtkSmartPointer<vtkConeSource>::New();
+    coneSource->SetRadius(0.1);
+    coneSource->SetHeight(0.5);
+    coneSource->SetResolution(10);
+    coneSource->Update();
+
+    // Serial VTK filters as the baseline.
+    vtkSmartPointer<vtkGlyph3D> glyph = vtkSmartPointer<vtkGlyph3D>::New();
+    glyph->SetInputData(data);
+    glyph->SetSourceConnection(coneSource->GetOutputPort());
+    glyph->SetScaleModeToScaleByVector();
+    glyph->OrientOn();
+    double glyphSerial = TimeUpdate(glyph, repeats);
+
+    vtkSmartPointer<vtkHedgeHog> hhog = vtkSmartPointer<vtkHedgeHog>::New();
+    hhog->SetInputData(data);
+    double hhogSerial = TimeUpdate(hhog, repeats);
+
+    vtkSmartPointer<vtkParallelGlyph3D> pglyph = vtkSmartPointer<vtkParallelGlyph3D>::New();
+    pglyph->SetInputData(data);
+    pglyph->SetSourceConnection(coneSource->GetOutputPort());
+    pglyph->SetScaleModeToScaleByVector();
+    pglyph->OrientOn();
+
+    vtkSmartPointer<vtkParallelHedgeHog> phhog = vtkSmartPointer<vtkParallelHedgeHog>::New();
+    phhog->SetInputData(data);
+
+    std::cout << fileName << ": " << data->GetNumberOfPoints() << " points, "
+              << coneSource->GetOutput()->GetNumberOfPoints() << " cone points, SMP backend "
+              << vtkSMPTools::GetBackend() << std::endl;
+    std::printf("%-22s %10s %8s %10s %8s %12s\n", "", "glyph ms", "speedup", "hedgehog", "speedup", "same as VTK");
+    std::printf("%-22s %10.2f %8.2f %10.2f %8.2f %12s\n", "vtkGlyph3D/vtkHedgeHog", glyphSerial, 1.0, hhogSerial,
+        1.0, "-");
+
+    bool allIdentical = true;
+    for (int threads : GetThreadCounts())
+    {
+        double glyphTime = 0.0;
+        double hhogTime = 0.0;
+        vtkSMPTools::LocalScope(vtkSMPTools::Config(threads), [&]() {
+            glyphTime = TimeUpdate(pglyph, repeats);
+            hhogTime = TimeUpdate(phhog, repeats);
+        });
+
+        // Every run must reproduce the VTK filters' output bit for bit.
+        const bool identical = SamePolyData(glyph->GetOutput(), pglyph->GetOutput()) &&
+            SamePolyData(hhog->GetOutput(), phhog->GetOutput());
+        allIdentical = allIdentical && identical;
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "parallel, %d thread%s", threads, threads == 1 ? "" : "s");
+        std::printf("%-22s %10.2f %8.2f %10.2f %8.2f %12s\n", label, glyphTime, glyphSerial / glyphTime, hhogTime,
+            hhogSerial / hhogTime, identical ? "yes" : "NO");
+    }
+
+    // Memory of explicit glyph geometry against one mesh plus instance table.
+    vtkSmartPointer<vtkInstancedGlyph3D> instanced = vtkSmartPointer<vtkInstancedGlyph3D>::New();
+    instanced->SetInputData(data);
+    instanced->SetSourceConnection(coneSource->GetOutputPort());
+    double instancedTime = TimeUpdate(instanced, repeats);
+
+    vtkSmartPointer<vtkPolyData> expanded = vtkSmartPointer<vtkPolyData>::New();
+    double start = vtkTimerLog::GetUniversalTime();
+    vtkInstancedGlyph3D::ExpandInstances(
+        instanced->GetOutput(0), vtkPolyData::SafeDownCast(instanced->GetOutputDataObject(1)), expanded);
+    double expandTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+
+    std::cout << std::endl;
+    std::cout << "explicit glyphs (vtkGlyph3D): " << glyph->GetOutput()->GetActualMemorySize() << " KiB" << std::endl;
+    std::cout << "instance table:               " << instanced->GetOutput(0)->GetActualMemorySize() << " KiB ("
+              << vtkInstancedGlyph3D::GetBytesPerInstance() << " bytes/instance, built in " << instancedTime
+              << " ms)" << std::endl;
+    std::cout << "shared cone mesh:             " << instanced->GetOutputDataObject(1)->GetActualMemorySize()
+              << " KiB" << std::endl;
+    std::cout << "CPU expansion of the table:   " << expandTime << " ms" << std::endl;
+    return allIdentical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunStreamlineBenchmark(const std::string& fileName, int spacing, int repeats)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset)
+    {
+        std::cerr << "bench-streamlines: cannot read " << fileName << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Same tracer settings as the streamline mode.
+    vtkSmartPointer<vtkPolyData> seeds = vtkSmartPointer<vtkPolyData>::New();
+    SetStartingPoints(seeds, *dataset, spacing);
+    vtkSmartPointer<vtkStreamTracer> tracer = vtkSmartPointer<vtkStreamTracer>::New();
+    tracer->SetInputConnection(dataset->GetOutputPort());
+    tracer->SetSourceData(seeds);
+    tracer->SetIntegrationDirectionToForward();
+    tracer->SetMaximumPropagation(100.0);
+    tracer->SetInitialIntegrationStep(0.1);
+    tracer->SetIntegratorTypeToRungeKutta4();
+    double traceTime = TimeUpdate(tracer, 1);
+    vtkPolyData* traced = tracer->GetOutput();
+
+    CompactStreamlines lines;
+    double encodeTime = 0.0;
+    double decodeTime = 0.0;
+    vtkSmartPointer<vtkPolyData> decoded;
+    for (int r = 0; r < repeats; ++r)
+    {
+        double start = vtkTimerLog::GetUniversalTime();
+        lines.Encode(traced, { traced->GetPointData()->GetScalars() });
+        double middle = vtkTimerLog::GetUniversalTime();
+        decoded = lines.Decode();
+        double end = vtkTimerLog::GetUniversalTime();
+        encodeTime = (r == 0) ? (middle - start) * 1000.0 : std::min(encodeTime, (middle - start) * 1000.0);
+        decodeTime = (r == 0) ? (end - middle) * 1000.0 : std::min(decodeTime, (end - middle) * 1000.0);
+    }
+
+    // Lines are encoded in cell order, so decoded point p matches the p-th
+    // point id of the traced connectivity.
+    double maxError = 0.0;
+    vtkIdType p = 0;
+    vtkIdType npts;
+    const vtkIdType* pts;
+    vtkCellArray* cells = traced->GetLines();
+    for (cells->InitTraversal(); cells->GetNextCell(npts, pts);)
+    {
+        for (vtkIdType i = 0; i < npts; ++i, ++p)
+        {
+            double a[3];
+            double b[3];
+            traced->GetPoint(pts[i], a);
+            decoded->GetPoint(p, b);
+            for (int c = 0; c < 3; ++c)
+            {
+                maxError = std::max(maxError, std::abs(a[c] - b[c]));
+            }
+        }
+    }
+
+    std::string cacheFile = dataset->Name + ".fvsl";
+    CompactStreamlines reloaded;
+    bool roundTrip = lines.Write(cacheFile) && reloaded.Read(cacheFile) &&
+        SamePolyData(decoded, reloaded.Decode());
+    std::remove(cacheFile.c_str());
+
+    std::cout << fileName << ": spacing " << spacing << ", " << lines.GetNumberOfLines() << " lines, "
+              << lines.GetNumberOfPoints() << " points, traced in " << traceTime << " ms" << std::endl;
+    std::cout << "vtkStreamTracer output: " << traced->GetActualMemorySize() << " KiB" << std::endl;
+    std::cout << "decoded polydata:       " << decoded->GetActualMemorySize() << " KiB" << std::endl;
+    std::cout << "compact streamlines:    " << (lines.GetMemorySize() + 1023) / 1024 << " KiB" << std::endl;
+    std::cout << "encode / decode:        " << encodeTime << " / " << decodeTime << " ms" << std::endl;
+    std::cout << "max position error:     " << maxError << std::endl;
+    std::cout << "file round trip:        " << (roundTrip ? "identical" : "FAILED") << std::endl;
+    return roundTrip ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunVolumeBenchmark(const std::string& fileName, int imageSize)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->Is3D() || !dataset->GetOutput()->GetPointData()->GetScalars())
+    {
+        std::cerr << "bench-volume: " << fileName << " is not a readable 3D scalar volume" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkColorTransferFunction> color = vtkSmartPointer<vtkColorTransferFunction>::New();
+    vtkSmartPointer<vtkPiecewiseFunction> opacity = vtkSmartPointer<vtkPiecewiseFunction>::New();
+    SetupVolumeTransferFunctions(color, opacity);
+
+    vtkSmartPointer<vtkCpuVolumeActor> volume = vtkSmartPointer<vtkCpuVolumeActor>::New();
+    volume->SetInputData(dataset->GetOutput());
+    volume->SetColor(color);
+    volume->SetScalarOpacity(opacity);
+
+    // Part1's view: from -y, head up along -z, turned 30 degrees twice.
+    const double* b = dataset->Bounds;
+    double center[3] = { (b[0] + b[1]) / 2, (b[2] + b[3]) / 2, (b[4] + b[5]) / 2 };
+    double diagonal = std::sqrt((b[1] - b[0]) * (b[1] - b[0]) + (b[3] - b[2]) * (b[3] - b[2]) +
+        (b[5] - b[4]) * (b[5] - b[4]));
+    vtkSmartPointer<vtkCamera> camera = vtkSmartPointer<vtkCamera>::New();
+    camera->SetFocalPoint(center);
+    camera->SetPosition(center[0], center[1] - 2.0 * diagonal, center[2]);
+    camera->SetViewUp(0, 0, -1);
+    camera->Azimuth(30.0);
+    camera->Elevation(30.0);
+    camera->OrthogonalizeViewUp();
+    camera->SetClippingRange(diagonal, 3.0 * diagonal);
+
+    double cell = std::min(dataset->GetOutput()->GetSpacing()[0],
+        std::min(dataset->GetOutput()->GetSpacing()[1], dataset->GetOutput()->GetSpacing()[2]));
+
+    // Fine post-classification is the reference both methods converge to.
+    vtkSmartPointer<vtkImageData> reference = vtkSmartPointer<vtkImageData>::New();
+    volume->PreintegratedOff();
+    volume->SetSampleDistance(cell / 8.0);
+    volume->RenderImage(camera, imageSize, imageSize, reference);
+
+    std::cout << fileName << ": " << imageSize << "x" << imageSize << " image, reference step " << cell / 8.0
+              << " rendered in " << volume->GetLastRenderTime() << " ms" << std::endl;
+    std::printf("%8s %-20s %10s %12s %10s\n", "step", "classification", "ms", "samples", "RMSE");
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    for (double factor : { 0.5, 1.0, 2.0, 4.0, 8.0 })
+    {
+        for (bool preintegrated : { false, true })
+        {
+            volume->SetPreintegrated(preintegrated);
+            volume->SetSampleDistance(factor * cell);
+            volume->RenderImage(camera, imageSize, imageSize, image);
+            std::printf("%8.3f %-20s %10.2f %12lld %10.3f\n", factor * cell,
+                preintegrated ? "preintegrated" : "post-classification", volume->GetLastRenderTime(),
+                static_cast<long long>(volume->GetLastNumberOfSamples()), ImageRMSE(reference, image));
+        }
+    }
+
+    // Table rebuilds: a new sample distance rebuilds everything, one moved
+    // opacity point (keys 1-4) only the entries spanning the changed bins.
+    volume->SetSampleDistance(2.0 * cell);
+    volume->RenderImage(camera, 1, 1, image);
+    double fullTime = volume->GetLastTableTime();
+    vtkIdType fullEntries = volume->GetLastTableEntries();
+    opacity->AddPoint(1150.0, opacity->GetValue(1150.0) + 0.1);
+    volume->RenderImage(camera, 1, 1, image);
+    std::cout << std::endl;
+    std::cout << "table rebuild, new step:        " << fullEntries << " entries in " << fullTime << " ms" << std::endl;
+    std::cout << "table rebuild, bone opacity +1: " << volume->GetLastTableEntries() << " entries in "
+              << volume->GetLastTableTime() << " ms" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int RunIsoSurfaceBenchmark(const std::string& fileName, int repeats)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->Is3D() || !dataset->GetOutput()->GetPointData()->GetScalars())
+    {
+        std::cerr << "bench-iso: " << fileName << " is not a readable 3D scalar volume" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const double values[2] = { 500.0, 1150.0 };
+    const char* names[2] = { "skin", "bone" };
+
+    // Part1.py: one vtkFlyingEdges3D and one vtkStripper per surface.
+    vtkSmartPointer<vtkStripper> strippers[2];
+    double separateTime = 0.0;
+    for (int r = 0; r < repeats; ++r)
+    {
+        double start = vtkTimerLog::GetUniversalTime();
+        for (int n = 0; n < 2; ++n)
+        {
+            vtkSmartPointer<vtkFlyingEdges3D> extractor = vtkSmartPointer<vtkFlyingEdges3D>::New();
+            extractor->SetInputData(dataset->GetOutput());
+            extractor->SetValue(0, values[n]);
+            strippers[n] = vtkSmartPointer<vtkStripper>::New();
+            strippers[n]->SetInputConnection(extractor->GetOutputPort());
+            strippers[n]->Update();
+        }
+        double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+        separateTime = (r == 0) ? elapsed : std::min(separateTime, elapsed);
+    }
+
+    vtkSmartPointer<vtkMultiIsoSurface> multi = vtkSmartPointer<vtkMultiIsoSurface>::New();
+    multi->SetInputData(dataset->GetOutput());
+    multi->SetValue(0, values[0]);
+    multi->SetValue(1, values[1]);
+    double multiTime = TimeUpdate(multi, repeats);
+
+    // The same pass reading a bricked copy of the scalars; the first update
+    // also makes the copy.
+    vtkSmartPointer<vtkMultiIsoSurface> bricked = vtkSmartPointer<vtkMultiIsoSurface>::New();
+    bricked->SetInputData(dataset->GetOutput());
+    bricked->SetValue(0, values[0]);
+    bricked->SetValue(1, values[1]);
+    bricked->BrickScalarsOn();
+    double start = vtkTimerLog::GetUniversalTime();
+    bricked->Update();
+    const double brickTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+    const double brickedTime = TimeUpdate(bricked, repeats);
+    const bool same = SamePolyData(multi->GetOutput(0), bricked->GetOutput(0)) &&
+        SamePolyData(multi->GetOutput(1), bricked->GetOutput(1));
+
+    const int* dims = dataset->Dimensions;
+    std::cout << fileName << ": " << dims[0] << "x" << dims[1] << "x" << dims[2] << ", "
+              << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads" << std::endl;
+    std::printf("%-6s %-28s %10s %12s %10s\n", "", "filter", "points", "triangles", "KiB");
+    for (int n = 0; n < 2; ++n)
+    {
+        vtkPolyData* separate = strippers[n]->GetOutput();
+        vtkPolyData* combined = multi->GetOutput(n);
+        std::printf("%-6s %-28s %10lld %12lld %10lu\n", names[n], "vtkFlyingEdges3D+vtkStripper",
+            static_cast<long long>(separate->GetNumberOfPoints()), static_cast<long long>(CountTriangles(separate)),
+            separate->GetActualMemorySize());
+        std::printf("%-6s %-28s %10lld %12lld %10lu\n", names[n], "vtkMultiIsoSurface",
+            static_cast<long long>(combined->GetNumberOfPoints()), static_cast<long long>(CountTriangles(combined)),
+            combined->GetActualMemorySize());
+    }
+    std::cout << "two extractors + strippers: " << separateTime << " ms" << std::endl;
+    std::cout << "one multi-value pass:       " << multiTime << " ms" << std::endl;
+    std::cout << "same, bricked scalars:      " << brickedTime << " ms, " << brickTime << " ms with the copy, "
+              << (same ? "same surfaces" : "DIFFERENT surfaces") << std::endl;
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunParticleBenchmark(const std::string& fileName, int count, int frames)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->GetOutput()->GetPointData()->GetVectors())
+    {
+        std::cerr << "bench-particles: " << fileName << " has no vectors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    count = std::max(count, 1);
+    frames = std::max(frames, 1);
+
+    // Half a cell per frame at the highest speed. Every frame refills the
+    // particles that left, so each one advects `count` particles.
+    const double* b = dataset->Bounds;
+    double cell = VTK_DOUBLE_MAX;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (dataset->Dimensions[c] > 1)
+        {
+            cell = std::min(cell, (b[2 * c + 1] - b[2 * c]) / (dataset->Dimensions[c] - 1));
+        }
+    }
+    double timeStep = 0.5 * cell / std::max(dataset->MaxVectorMagnitude, 1e-6);
+
+    ParticleSystem particles;
+    if (!particles.SetField(dataset->GetOutput()))
+    {
+        return EXIT_FAILURE;
+    }
+    particles.SetCapacity(count);
+    particles.SetEmissionRate(count);
+    particles.AddSeedRegion(b);
+    particles.SetTimeStep(timeStep);
+    particles.SetMaxAge(VTK_FLOAT_MAX);
+    particles.SetMinimumSpeed(0.0);
+
+    std::cout << fileName << ": " << count << " particles, " << frames << " frames, step " << timeStep
+              << std::endl;
+    std::printf("%-26s %12s %12s %12s\n", "", "ms/frame", "alive", "Mparticles/s");
+
+    for (int threads : GetThreadCounts())
+    {
+        double elapsed = 0.0;
+        vtkSMPTools::LocalScope(vtkSMPTools::Config(threads), [&]() {
+            particles.Reset();
+            particles.Step();
+            double start = vtkTimerLog::GetUniversalTime();
+            for (int f = 0; f < frames; ++f)
+            {
+                particles.Step();
+            }
+            elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0 / frames;
+        });
+        char label[32];
+        std::snprintf(label, sizeof(label), "ParticleSystem, %d thread%s", threads, threads == 1 ? "" : "s");
+        std::printf("%-26s %12.2f %12lld %12.2f\n", label, elapsed,
+            static_cast<long long>(particles.GetNumberOfParticles()), count / elapsed / 1000.0);
+    }
+
+    // The same positions advected one by one through FlowField::Advect.
+    vtkPoints* points = particles.GetOutput()->GetPoints();
+    const vtkIdType numPoints = points->GetNumberOfPoints();
+    std::vector<double> positions(3 * numPoints);
+    for (vtkIdType i = 0; i < numPoints; ++i)
+    {
+        points->GetPoint(i, &positions[3 * i]);
+    }
+    const FlowField<>& field = particles.GetField();
+    double start = vtkTimerLog::GetUniversalTime();
+    for (int f = 0; f < frames; ++f)
+    {
+        vtkSMPTools::For(0, numPoints, [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType i = begin; i < end; ++i)
+            {
+                field.Advect(&positions[3 * i], timeStep, timeStep);
+            }
+        });
+    }
+    double scalarTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0 / frames;
+    std::printf("%-26s %12.2f %12lld %12.2f\n", "FlowField::Advect, all", scalarTime,
+        static_cast<long long>(numPoints), numPoints / scalarTime / 1000.0);
+    return EXIT_SUCCESS;
+}
+
+int RunExportBenchmark(const std::string& fileName, int repeats)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->GetOutput()->GetPointData()->GetVectors())
+    {
+        std::cerr << "bench-export: " << fileName << " has no vectors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    repeats = std::max(repeats, 1);
+
+    // The glyph mode's cones, expanded as the export key does.
+    vtkSmartPointer<vtkConeSource> coneSource = vtkSmartPointer<vtkConeSource>::New();
+    coneSource->SetRadius(0.1);
+    coneSource->SetHeight(0.5);
+    coneSource->SetResolution(10);
+    vtkSmartPointer<vtkInstancedGlyph3D> instanced = vtkSmartPointer<vtkInstancedGlyph3D>::New();
+    instanced->SetInputData(dataset->GetOutput());
+    instanced->SetSourceConnection(coneSource->GetOutputPort());
+    instanced->SetScaleFactor(10.0 / std::max(dataset->MaxVectorMagnitude, 1e-6));
+    instanced->Update();
+    vtkSmartPointer<vtkPolyData> glyphs = vtkSmartPointer<vtkPolyData>::New();
+    vtkInstancedGlyph3D::ExpandInstances(
+        instanced->GetOutput(0), vtkPolyData::SafeDownCast(instanced->GetOutputDataObject(1)), glyphs);
+
+    const std::string xmlFile = dataset->Name + "-xml.vtp";
+    const std::string parallelFile = dataset->Name + "-parallel.vtp";
+    std::cout << fileName << ": " << glyphs->GetNumberOfPoints() << " points, " << CountTriangles(glyphs)
+              << " triangles, " << glyphs->GetActualMemorySize() << " KiB in memory" << std::endl;
+    std::printf("%-34s %10s %10s %10s\n", "", "ms", "MiB", "MiB/s");
+
+    // Best of `repeats` runs of `write`, which returns the file size.
+    auto report = [&](const char* label, const std::function<vtkTypeUInt64()>& write) {
+        double best = 0.0;
+        vtkTypeUInt64 size = 0;
+        for (int r = 0; r < repeats; ++r)
+        {
+            double start = vtkTimerLog::GetUniversalTime();
+            size = write();
+            double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+            best = (r == 0) ? elapsed : std::min(best, elapsed);
+        }
+        double mib = size / (1024.0 * 1024.0);
+        std::printf("%-34s %10.2f %10.2f %10.1f\n", label, best, mib, mib / (best / 1000.0));
+    };
+
+    vtkSmartPointer<vtkXMLPolyDataWriter> xmlWriter = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+    xmlWriter->SetInputData(glyphs);
+    xmlWriter->SetFileName(xmlFile.c_str());
+    report("vtkXMLPolyDataWriter, default", [&]() {
+        xmlWriter->Write();
+        return GetFileSize(xmlFile);
+    });
+    xmlWriter->SetDataModeToAppended();
+    xmlWriter->EncodeAppendedDataOff();
+    xmlWriter->SetCompressorTypeToNone();
+    xmlWriter->SetHeaderTypeToUInt64();
+    report("vtkXMLPolyDataWriter, raw", [&]() {
+        xmlWriter->Write();
+        return GetFileSize(xmlFile);
+    });
+
+    vtkSmartPointer<vtkParallelPolyDataWriter> writer = vtkSmartPointer<vtkParallelPolyDataWriter>::New();
+    writer->SetInputData(glyphs);
+    writer->SetFileName(parallelFile.c_str());
+    for (int threads : GetThreadCounts())
+    {
+        char label[40];
+        std::snprintf(label, sizeof(label), "vtkParallelPolyDataWriter, %d thr.", threads);
+        vtkSMPTools::LocalScope(vtkSMPTools::Config(threads), [&]() {
+            report(label, [&]() {
+                writer->Write();
+                return writer->GetFileSize();
+            });
+        });
+    }
+
+    // The file must read back as the same polydata.
+    vtkSmartPointer<vtkXMLPolyDataReader> reader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+    reader->SetFileName(parallelFile.c_str());
+    reader->Update();
+    vtkPolyData* read = reader->GetOutput();
+    bool identical = read->GetNumberOfPoints() == glyphs->GetNumberOfPoints() &&
+        SameValues(read->GetPoints()->GetData(), glyphs->GetPoints()->GetData()) &&
+        SameValues(read->GetPointData()->GetScalars(), glyphs->GetPointData()->GetScalars()) &&
+        SameValues(read->GetPolys()->GetConnectivityArray(), glyphs->GetPolys()->GetConnectivityArray()) &&
+        SameValues(read->GetPolys()->GetOffsetsArray(), glyphs->GetPolys()->GetOffsetsArray()) &&
+        SameValues(read->GetStrips()->GetConnectivityArray(), glyphs->GetStrips()->GetConnectivityArray());
+    std::cout << "read back by vtkXMLPolyDataReader: " << (identical ? "identical" : "DIFFERENT") << std::endl;
+
+    std::remove(xmlFile.c_str());
+    std::remove(parallelFile.c_str());
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunHistogramBenchmark(const std::string& fileName, int repeats)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->Is3D() || !dataset->GetOutput()->GetPointData()->GetScalars())
+    {
+        std::cerr << "bench-histogram: " << fileName << " is not a readable 3D scalar volume" << std::endl;
+        return EXIT_FAILURE;
+    }
+    repeats = std::max(repeats, 1);
+
+    const int* dims = dataset->Dimensions;
+    std::cout << fileName << ": " << dims[0] << "x" << dims[1] << "x" << dims[2] << ", best of " << repeats
+              << std::endl;
+    std::printf("%-8s %12s %14s %10s\n", "threads", "ms", "Mvoxels/s", "same");
+
+    const double voxels = static_cast<double>(dims[0]) * dims[1] * dims[2];
+    VolumeHistogram reference;
+    for (int threads : GetThreadCounts())
+    {
+        VolumeHistogram histogram;
+        double best = 0.0;
+        vtkSMPTools::LocalScope(vtkSMPTools::Config(threads), [&]() {
+            for (int r = 0; r < repeats; ++r)
+            {
+                histogram.Compute(dataset->GetOutput());
+                best = (r == 0) ? histogram.GetComputeTime() : std::min(best, histogram.GetComputeTime());
+            }
+        });
+        if (threads == 1)
+        {
+            reference = histogram;
+        }
+        bool same = histogram.GetValueHistogram() == reference.GetValueHistogram() &&
+            histogram.GetJointHistogram() == reference.GetJointHistogram();
+        std::printf("%-8d %12.2f %14.1f %10s\n", threads, best, voxels / (best * 1000.0), same ? "yes" : "NO");
+    }
+
+    std::cout << reference.GetNumberOfValueBins() << " x " << reference.GetNumberOfGradientBins()
+              << " bins, values " << reference.GetValueRange()[0] << " to " << reference.GetValueRange()[1]
+              << ", gradient up to " << reference.GetMaxGradient() << ", "
+              << reference.GetMemorySize() / 1024 << " KiB" << std::endl;
+    std::cout << "suggested boundaries:";
+    for (double value : reference.SuggestBoundaries())
+    {
+        std::cout << " " << value;
+    }
+    std::cout << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int RunDistributedBenchmark(
+    const std::string& executable, const std::string& fileName, int maxWorkers, int spacing, FieldLayout layout)
+{
+    maxWorkers = std::max(maxWorkers, 1);
+    std::cout << fileName << ": seed spacing " << spacing << ", one thread per worker, " << GetFieldLayoutName(layout)
+              << " blocks" << std::endl;
+    std::printf("%-8s %10s %10s %8s %10s %8s %9s %12s %12s %10s\n", "workers", "start ms", "trace ms", "lines",
+        "points", "rounds", "handoffs", "field MiB", "process MiB", "max diff");
+
+    vtkSmartPointer<vtkPolyData> reference;
+    std::vector<int> counts;
+    for (int n = 1; n < maxWorkers; n *= 2)
+    {
+        counts.push_back(n);
+    }
+    counts.push_back(maxWorkers);
+    for (int workers : counts)
+    {
+        DistributedTracer tracer;
+        tracer.SetFileName(fileName);
+        tracer.SetExecutable(executable);
+        tracer.SetNumberOfWorkers(workers);
+        tracer.SetThreadsPerWorker(1);
+        tracer.SetLayout(layout);
+        if (!tracer.SetSeedGrid(spacing) || !tracer.Run())
+        {
+            return EXIT_FAILURE;
+        }
+
+        // Largest per-worker share; it should drop as workers are added.
+        const std::vector<double>& field = tracer.GetWorkerFieldMemory();
+        const std::vector<double>& process = tracer.GetWorkerProcessMemory();
+        const double fieldMiB = *std::max_element(field.begin(), field.end()) / (1024.0 * 1024.0);
+        const double processMiB = *std::max_element(process.begin(), process.end()) / 1024.0;
+
+        // Lines are in seed order, so they pair up with the 1 worker run.
+        vtkPolyData* lines = tracer.GetOutput();
+        double maxDiff = 0.0;
+        if (!reference)
+        {
+            reference = lines;
+        }
+        else if (reference->GetNumberOfPoints() != lines->GetNumberOfPoints())
+        {
+            maxDiff = VTK_DOUBLE_MAX;
+        }
+        else
+        {
+            for (vtkIdType i = 0; i < lines->GetNumberOfPoints(); ++i)
+            {
+                double a[3];
+                double b[3];
+                reference->GetPoint(i, a);
+                lines->GetPoint(i, b);
+                maxDiff = std::max(maxDiff, std::sqrt(vtkMath::Distance2BetweenPoints(a, b)));
+            }
+        }
+
+        std::printf("%-8d %10.1f %10.1f %8lld %10lld %8d %9lld %12.2f %12.1f %10.3g\n",
+            tracer.GetBlocks().GetNumberOfBlocks(), tracer.GetStartupTime(), tracer.GetTraceTime(),
+            static_cast<long long>(lines->GetNumberOfLines()), static_cast<long long>(lines->GetNumberOfPoints()),
+            tracer.GetNumberOfRounds(),
+            static_cast<long long>(tracer.GetNumberOfHandoffs()), fieldMiB, processMiB, maxDiff);
+    }
+    return EXIT_SUCCESS;
+}
+
+int RunPrecisionBenchmark(const std::string& fileName, int count, int frames)
+{
+    FlowDatasetPool pool;
+    pool.Add(fileName);
+    FlowDataset* dataset = pool.Get(0);
+    if (!dataset || !dataset->GetOutput()->GetPointData()->GetVectors())
+    {
+        std::cerr << "bench-precision: " << fileName << " has no vectors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    count = std::max(count, 1);
+    frames = std::max(frames, 1);
+    vtkImageData* image = dataset->GetOutput();
+    const double* b = dataset->Bounds;
+    double cell = VTK_DOUBLE_MAX;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (dataset->Dimensions[c] > 1)
+        {
+            cell = std::min(cell, (b[2 * c + 1] - b[2 * c]) / (dataset->Dimensions[c] - 1));
+        }
+    }
+    const double maxSpeed = std::max(dataset->MaxVectorMagnitude, 1e-12);
+    const double timeStep = 0.5 * cell / maxSpeed;
+
+    // The same random positions for every precision.
+    std::vector<double> positions(3 * static_cast<std::size_t>(count));
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (double& x : positions)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        x = static_cast<double>((state * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            double& x = positions[3 * i + c];
+            x = (dataset->Dimensions[c] > 1) ? b[2 * c] + x * (b[2 * c + 1] - b[2 * c]) : b[2 * c];
+        }
+    }
+
+    std::cout << fileName << ": " << count << " samples and particles, " << frames << " frames, "
+              << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads" << std::endl;
+    std::cout << "decoding float16 with " << GetHalfFloatDecodePath() << ", int16 and int8 with "
+              << GetQuantizedDecodePath() << std::endl;
+    std::cout << "sample errors relative to the largest speed, drift of the particles in cells" << std::endl;
+    std::printf("%-13s %9s %7s %10s %10s %10s %10s %11s %10s %10s\n", "precision", "KiB", "ratio", "max err",
+        "rms err", "sample ms", "frame ms", "hedgehog ms", "max drift", "mean drift");
+
+    const VectorPrecision precisions[4] = { VectorPrecision::Float32, VectorPrecision::Float16, VectorPrecision::Int16,
+        VectorPrecision::Int8 };
+    std::vector<double> reference;
+    std::vector<float> referencePoints;
+    std::size_t referenceSize = 0;
+    for (VectorPrecision precision : precisions)
+    {
+        std::vector<double> vectors;
+        std::size_t memorySize = 0;
+        double sampleTime = 0.0;
+        switch (precision)
+        {
+            case VectorPrecision::Float16:
+                sampleTime = SampleField<HalfFloatStorage>(image, positions, vectors, memorySize);
+                break;
+            case VectorPrecision::Int16:
+                sampleTime = SampleField<BlockQuantizedStorage<std::int16_t>>(image, positions, vectors, memorySize);
+                break;
+            case VectorPrecision::Int8:
+                sampleTime = SampleField<BlockQuantizedStorage<std::int8_t>>(image, positions, vectors, memorySize);
+                break;
+            default:
+                sampleTime = SampleField<LinearFloatStorage>(image, positions, vectors, memorySize);
+                break;
+        }
+        if (reference.empty())
+        {
+            reference = vectors;
+            referenceSize = memorySize;
+        }
+        double maxError = 0.0;
+        double sumSquares = 0.0;
+        for (std::size_t i = 0; i < vectors.size(); i += 3)
+        {
+            const double e2 = vtkMath::Distance2BetweenPoints(&vectors[i], &reference[i]);
+            maxError = std::max(maxError, std::sqrt(e2));
+            sumSquares += e2;
+        }
+
+        // All particles injected in the first frame, then advected.
+        ParticleSystem particles;
+        particles.SetPrecision(precision);
+        particles.SetField(image);
+        particles.SetCapacity(count);
+        particles.SetEmissionRate(count);
+        particles.AddSeedRegion(b);
+        particles.SetTimeStep(timeStep);
+        particles.SetMaxAge(VTK_FLOAT_MAX);
+        particles.SetMinimumSpeed(0.0);
+        particles.Step();
+        particles.SetEmissionRate(0);
+        double start = vtkTimerLog::GetUniversalTime();
+        for (int f = 0; f < frames; ++f)
+        {
+            particles.Step();
+        }
+        const double frameTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0 / frames;
+
+        // The hedgehog of the whole grid, decoding the same storage point by
+        // point; float32 reads the dataset's array as in the hedgehog mode.
+        vtkSmartPointer<vtkParallelHedgeHog> hedgeHog = vtkSmartPointer<vtkParallelHedgeHog>::New();
+        hedgeHog->SetInputData(image);
+        if (precision != VectorPrecision::Float32)
+        {
+            hedgeHog->SetVectorSource(CreateFlowVectorSource(image, precision));
+        }
+        const double hedgeHogTime = TimeUpdate(hedgeHog, 3);
+
+        // Particles are packed in slot order, so the runs pair up as long as
+        // the same ones are alive.
+        vtkFloatArray* points = vtkFloatArray::SafeDownCast(particles.GetOutput()->GetPoints()->GetData());
+        std::vector<float> packed(points->GetPointer(0), points->GetPointer(0) + 3 * points->GetNumberOfTuples());
+        if (referencePoints.empty())
+        {
+            referencePoints = packed;
+        }
+        char maxDrift[32] = "-";
+        char meanDrift[32] = "-";
+        if (packed.size() == referencePoints.size() && !packed.empty())
+        {
+            double largest = 0.0;
+            double sum = 0.0;
+            for (std::size_t i = 0; i < packed.size(); i += 3)
+            {
+                double d2 = 0.0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    const double d = packed[i + c] - referencePoints[i + c];
+                    d2 += d * d;
+                }
+                largest = std::max(largest, std::sqrt(d2));
+                sum += std::sqrt(d2);
+            }
+            std::snprintf(maxDrift, sizeof(maxDrift), "%.3g", largest / cell);
+            std::snprintf(meanDrift, sizeof(meanDrift), "%.3g", sum / (packed.size() / 3) / cell);
+        }
+
+        std::printf("%-13s %9.0f %7.2f %10.2e %10.2e %10.2f %10.2f %11.2f %10s %10s\n",
+            GetVectorPrecisionName(precision), memorySize / 1024.0, static_cast<double>(referenceSize) / memorySize,
+            maxError / maxSpeed, std::sqrt(sumSquares / count) / maxSpeed, sampleTime, frameTime, hedgeHogTime,
+            maxDrift, meanDrift);
+    }
+    return EXIT_SUCCESS;
+}
+
+int RunLayoutBenchmark(int size, int count, int steps)
+{
+    size = std::max(size, 2);
+    count = std::max(count, 1);
+    steps = std::max(steps, 1);
+
+    // ABC flow with one period across the grid, in grid units.
+    const int dims[3] = { size, size, size };
+    const double origin[3] = { 0.0, 0.0, 0.0 };
+    const double spacing[3] = { 1.0, 1.0, 1.0 };
+    const std::size_t numPoints = static_cast<std::size_t>(size) * size * size;
+    std::vector<float> values(3 * numPoints);
+    const double w = 2.0 * vtkMath::Pi() / size;
+    vtkSMPTools::For(0, size, [&](vtkIdType begin, vtkIdType end) {
+        for (int k = static_cast<int>(begin); k < end; ++k)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                for (int i = 0; i < size; ++i)
+                {
+                    const std::size_t id = i + static_cast<std::size_t>(size) * (j + static_cast<std::size_t>(size) * k);
+                    float* v = &values[3 * id];
+                    v[0] = static_cast<float>(std::sin(w * k) + std::cos(w * j));
+                    v[1] = static_cast<float>(std::sin(w * i) + std::cos(w * k));
+                    v[2] = static_cast<float>(std::sin(w * j) + std::cos(w * i));
+                }
+            }
+        }
+    });
+
+    FlowField<BrickedFloatStorage<>> bricked;
+    bricked.SetGeometry(dims, origin, spacing);
+    double start = vtkTimerLog::GetUniversalTime();
+    bricked.GetStorage().Assign(values.data(), dims);
+    const double toBricked = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+    std::vector<float> roundTrip(values.size());
+    start = vtkTimerLog::GetUniversalTime();
+    bricked.GetStorage().CopyTo(roundTrip.data());
+    const double toLinear = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+    const bool exact = roundTrip == values;
+    std::vector<float>().swap(roundTrip);
+    FlowField<> linear;
+    linear.SetGeometry(dims, origin, spacing);
+    linear.GetStorage().Assign(std::move(values), dims);
+
+    std::cout << size << "^3 grid, " << count << " samples, " << vtkSMPTools::GetEstimatedNumberOfThreads()
+              << " threads" << std::endl;
+    std::printf("linear %.1f MiB, bricked %.1f MiB; to bricked %.1f ms, back to linear %.1f ms, round trip %s\n",
+        linear.GetStorage().GetMemorySize() / 1048576.0, bricked.GetStorage().GetMemorySize() / 1048576.0, toBricked,
+        toLinear, exact ? "exact" : "FAILED");
+    std::cout << "cache lines and pages touched per sample, linear / bricked" << std::endl;
+    std::printf("%-12s %10s %10s %8s %7s %7s %7s %7s %5s\n", "", "linear ms", "bricked ms", "speedup", "lines",
+        "lines", "pages", "pages", "same");
+
+    // Random positions, and the same number along rows in x (the order the
+    // glyph and isosurface filters sweep) and in z.
+    std::vector<double> randomPositions(3 * static_cast<std::size_t>(count));
+    std::vector<double> rowsX(randomPositions.size());
+    std::vector<double> rowsZ(randomPositions.size());
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    const int cells = size - 1;
+    for (int n = 0; n < count; ++n)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            const double r = static_cast<double>((state * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+            randomPositions[3 * n + c] = r * cells;
+        }
+        const int along = n % cells;
+        const int first = (n / cells) % cells;
+        const int second = (n / cells / cells) % cells;
+        rowsX[3 * n] = along + 0.5;
+        rowsX[3 * n + 1] = first + 0.5;
+        rowsX[3 * n + 2] = second + 0.5;
+        rowsZ[3 * n] = first + 0.5;
+        rowsZ[3 * n + 1] = second + 0.5;
+        rowsZ[3 * n + 2] = along + 0.5;
+    }
+
+    bool same = exact;
+    const std::pair<const char*, const std::vector<double>*> workloads[3] = { { "random", &randomPositions },
+        { "rows in x", &rowsX }, { "rows in z", &rowsZ } };
+    for (const auto& workload : workloads)
+    {
+        std::vector<double> linearVectors;
+        std::vector<double> brickedVectors;
+        const double linearTime = TimeSamples(linear, *workload.second, linearVectors);
+        const double brickedTime = TimeSamples(bricked, *workload.second, brickedVectors);
+        double footprint[4];
+        MeasureFootprint(linear, *workload.second, footprint[0], footprint[2]);
+        MeasureFootprint(bricked, *workload.second, footprint[1], footprint[3]);
+        const bool equal = linearVectors == brickedVectors;
+        same = same && equal;
+        std::printf("%-12s %10.1f %10.1f %8.2f %7.2f %7.2f %7.2f %7.2f %5s\n", workload.first, linearTime, brickedTime,
+            linearTime / brickedTime, footprint[0], footprint[1], footprint[2], footprint[3], equal ? "yes" : "NO");
+    }
+
+    // Streamlines from random seeds, RK4 with steps of at most 0.2 cells, as
+    // many samples in all as the other workloads.
+    const vtkIdType numLines = std::max(count / (4 * steps), 1);
+    const double step = 0.2 / (2.0 * std::sqrt(3.0));
+    std::vector<double> ends[2];
+    double times[2];
+    for (int layout = 0; layout < 2; ++layout)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            ends[layout].assign(randomPositions.begin(), randomPositions.begin() + 3 * numLines);
+            start = vtkTimerLog::GetUniversalTime();
+            vtkSMPTools::For(0, numLines, [&](vtkIdType begin, vtkIdType end) {
+                for (vtkIdType i = begin; i < end; ++i)
+                {
+                    if (layout == 0)
+                    {
+                        linear.Advect(&ends[layout][3 * i], steps * step, step);
+                    }
+                    else
+                    {
+                        bricked.Advect(&ends[layout][3 * i], steps * step, step);
+                    }
+                }
+            });
+            const double elapsed = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+            times[layout] = (r == 0) ? elapsed : std::min(times[layout], elapsed);
+        }
+    }
+    const bool equal = ends[0] == ends[1];
+    same = same && equal;
+    std::printf("%-12s %10.1f %10.1f %8.2f %7s %7s %7s %7s %5s\n", "streamlines", times[0], times[1],
+        times[0] / times[1], "-", "-", "-", "-", equal ? "yes" : "NO");
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+#ifndef FlowBenchmarks_h
+#define FlowBenchmarks_h
+
+#include <string>
+
+enum class FieldLayout;
+
+// Timing runs behind the bench-* subcommands of flowVis. Each prints a table
+// to stdout and returns a process exit code.
+
+// vtkGlyph3D / vtkHedgeHog against their parallel versions for 1..N threads.
+int RunGlyphBenchmark(const std::string& fileName, int repeats);
+
+// vtkStreamTracer output against CompactStreamlines: memory, encode / decode
+// time, quantization error and a round trip through a file.
+int RunStreamlineBenchmark(const std::string& fileName, int spacing, int repeats);
+
+// CPU ray casting with post-classification against preintegration for a
+// range of sample distances, compared to a finely sampled reference image,
+// plus full and incremental preintegration table rebuild times.
+int RunVolumeBenchmark(const std::string& fileName, int imageSize);
+
+// Part1.py's skin and bone surfaces from two vtkFlyingEdges3D + vtkStripper
+// pipelines against one vtkMultiIsoSurface pass: time, size and triangles,
+// and the pass again on a bricked copy of the scalars.
+int RunIsoSurfaceBenchmark(const std::string& fileName, int repeats);
+
+// ParticleSystem frames with `count` particles kept alive over the whole
+// domain, for 1..N threads, against advecting the same particles one at a
+// time with FlowField::Advect in double precision.
+int RunParticleBenchmark(const std::string& fileName, int count, int frames);
+
+// The vectors stored as float32, float16 and block-scaled int16 and int8:
+// memory, interpolation error at `count` random positions relative to the
+// largest speed, sampling time, and ParticleSystem frames with the drift of
+// the particles from the float32 run.
+int RunPrecisionBenchmark(const std::string& fileName, int count, int frames);
+
+// FlowField sampling from the linear and the bricked layout of a size^3 ABC
+// flow: conversion both ways, and time and cache lines and pages touched
+// per sample for random positions, rows in x and z and RK4 streamlines of
+// `steps` steps, checked to give the same vectors.
+int RunLayoutBenchmark(int size, int count, int steps);
+
+// The glyph mode's expanded cone field written by vtkXMLPolyDataWriter and by
+// vtkParallelPolyDataWriter for 1..N threads, checked by reading it back.
+int RunExportBenchmark(const std::string& fileName, int repeats);
+
+// VolumeHistogram's value and value x gradient magnitude histograms for 1..N
+// threads, checked to give the same counts, plus the suggested boundaries.
+int RunHistogramBenchmark(const std::string& fileName, int repeats);
+
+// DistributedTracer with 1..maxWorkers worker processes of one thread each:
+// startup and trace time, handoffs between blocks, memory per worker and
+// the largest distance to the points traced by a single worker. The workers
+// keep their blocks in the given layout.
+int RunDistributedBenchmark(
+    const std::string& executable, const std::string& fileName, int maxWorkers, int spacing, FieldLayout layout);
+
+#endif
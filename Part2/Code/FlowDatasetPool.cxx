@@ -0,0 +1,151 @@
+#include "FlowDatasetPool.h"
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkMetaImageReader.h"
+#include "vtkPointData.h"
+#include "vtkStructuredPointsReader.h"
+#include "vtkVolume16Reader.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+vtkImageData* FlowDataset::GetOutput() const
+{
+    return vtkImageData::SafeDownCast(this->Reader->GetOutputDataObject(0));
+}
+
+vtkAlgorithmOutput* FlowDataset::GetOutputPort() const
+{
+    return this->Reader->GetOutputPort();
+}
+
+void FlowDatasetPool::Add(const std::string& fileName)
+{
+    std::unique_ptr<FlowDataset> dataset(new FlowDataset);
+    dataset->FileName = fileName;
+
+    std::string::size_type slash = fileName.find_last_of("/\\");
+    std::string base = (slash == std::string::npos) ? fileName : fileName.substr(slash + 1);
+    std::string::size_type dot = base.find_last_of('.');
+    dataset->Name = (dot == std::string::npos) ? base : base.substr(0, dot);
+
+    this->Datasets.push_back(std::move(dataset));
+}
+
+int FlowDatasetPool::FindDataset(const std::string& name) const
+{
+    for (int i = 0; i < this->GetNumberOfDatasets(); ++i)
+    {
+        if (this->Datasets[i]->Name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+FlowDataset* FlowDatasetPool::Get(int index)
+{
+    if (index < 0 || index >= this->GetNumberOfDatasets())
+    {
+        return nullptr;
+    }
+
+    FlowDataset* dataset = this->Datasets[index].get();
+    if (dataset->LoadFailed)
+    {
+        return nullptr;
+    }
+    if (!dataset->Reader && !this->Load(*dataset))
+    {
+        dataset->LoadFailed = true;
+        return nullptr;
+    }
+    return dataset;
+}
+
+vtkSmartPointer<vtkAlgorithm> FlowDatasetPool::CreateReader(const std::string& fileName)
+{
+    vtkSmartPointer<vtkAlgorithm> reader;
+    std::string::size_type dot = fileName.find_last_of('.');
+    std::string extension = (dot == std::string::npos) ? "" : fileName.substr(dot);
+    std::ifstream firstSlice(fileName + ".1", std::ios::binary | std::ios::ate);
+    if (extension == ".mhd" || extension == ".mha")
+    {
+        vtkSmartPointer<vtkMetaImageReader> metaReader = vtkSmartPointer<vtkMetaImageReader>::New();
+        metaReader->SetFileName(fileName.c_str());
+        reader = metaReader;
+    }
+    else if (firstSlice)
+    {
+        // Part1's slice series (headsq/quarter, frog/frog2ci, ...): square
+        // little-endian 16-bit slices prefix.1 to prefix.N, unit spacing.
+        int side = static_cast<int>(std::lround(std::sqrt(static_cast<double>(firstSlice.tellg()) / 2.0)));
+        int numSlices = 1;
+        while (std::ifstream(fileName + "." + std::to_string(numSlices + 1)))
+        {
+            ++numSlices;
+        }
+        vtkSmartPointer<vtkVolume16Reader> sliceReader = vtkSmartPointer<vtkVolume16Reader>::New();
+        sliceReader->SetFilePrefix(fileName.c_str());
+        sliceReader->SetDataDimensions(side, side);
+        sliceReader->SetImageRange(1, numSlices);
+        sliceReader->SetDataByteOrderToLittleEndian();
+        sliceReader->SetDataSpacing(1.0, 1.0, 1.0);
+        reader = sliceReader;
+    }
+    else
+    {
+        vtkSmartPointer<vtkStructuredPointsReader> vtkReader = vtkSmartPointer<vtkStructuredPointsReader>::New();
+        vtkReader->SetFileName(fileName.c_str());
+        reader = vtkReader;
+    }
+    return reader;
+}
+
+bool FlowDatasetPool::Load(FlowDataset& dataset)
+{
+    vtkSmartPointer<vtkAlgorithm> reader = FlowDatasetPool::CreateReader(dataset.FileName);
+    reader->Update();
+
+    vtkImageData* output = vtkImageData::SafeDownCast(reader->GetOutputDataObject(0));
+    if (!output || output->GetNumberOfPoints() == 0)
+    {
+        std::cerr << "flowVis: unable to read " << dataset.FileName << std::endl;
+        return false;
+    }
+
+    output->GetBounds(dataset.Bounds);
+    output->GetDimensions(dataset.Dimensions);
+
+    vtkDataArray* scalars = output->GetPointData()->GetScalars();
+    if (scalars)
+    {
+        scalars->GetRange(dataset.ScalarRange);
+    }
+
+    // The solutions used to rescan the vectors on every slider move; do it
+    // once here instead.
+    vtkDataArray* vectors = output->GetPointData()->GetVectors();
+    if (vectors)
+    {
+        double maxMagnitude = 0.0;
+        for (vtkIdType i = 0; i < vectors->GetNumberOfTuples(); ++i)
+        {
+            double vec[3];
+            vectors->GetTuple(i, vec);
+            double magnitude = sqrt(vec[0] * vec[0] + vec[1] * vec[1] + vec[2] * vec[2]);
+            if (magnitude > maxMagnitude)
+            {
+                maxMagnitude = magnitude;
+            }
+        }
+        dataset.MaxVectorMagnitude = maxMagnitude;
+    }
+
+    dataset.Reader = reader;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef FlowDatasetPool_h
+#define FlowDatasetPool_h
+
+#include "vtkAlgorithm.h"
+#include "vtkSmartPointer.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ActiveBlockIndex;
+class CompactStreamlines;
+class VolumeHistogram;
+class vtkAlgorithmOutput;
+class vtkImageData;
+
+// One loaded data file plus everything flowVis derives from it. Entries stay
+// alive for the whole session, so switching back to a dataset only reconnects
+// pipeline inputs instead of re-reading the file and rescanning the vectors.
+struct FlowDataset
+{
+    std::string FileName;
+    std::string Name; // file name without directory and extension, e.g. "carotid"
+
+    // vtkStructuredPointsReader for .vtk files, vtkMetaImageReader for .mhd,
+    // vtkVolume16Reader for a slice series prefix (prefix.1, prefix.2, ...).
+    vtkSmartPointer<vtkAlgorithm> Reader;
+
+    // Set when the file could not be read, so it is not opened again.
+    bool LoadFailed = false;
+
+    // Cached once per dataset when it is first loaded.
+    double MaxVectorMagnitude = 0.0;
+    double ScalarRange[2] = { 0.0, 1.0 };
+    double Bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int Dimensions[3] = { 0, 0, 0 };
+
+    // Streamlines already traced for this dataset, keyed by seed spacing.
+    std::map<int, std::shared_ptr<CompactStreamlines>> Streamlines;
+
+    // Blocks with flow or high scalars, built by the carotid mode.
+    std::shared_ptr<ActiveBlockIndex> ActiveBlocks;
+
+    // Value and gradient histograms, built by the volume mode.
+    std::shared_ptr<VolumeHistogram> Histogram;
+
+    vtkImageData* GetOutput() const;
+    vtkAlgorithmOutput* GetOutputPort() const;
+
+    // True when the grid has more than one slice along z.
+    bool Is3D() const { return this->Dimensions[2] > 1; }
+};
+
+class FlowDatasetPool
+{
+public:
+    // Registers a file; nothing is read until the dataset is first requested.
+    void Add(const std::string& fileName);
+
+    int GetNumberOfDatasets() const { return static_cast<int>(this->Datasets.size()); }
+
+    // Index of the first dataset with the given name, or -1. Does not load.
+    int FindDataset(const std::string& name) const;
+
+    // Returns the dataset, reading it on first use. Returns nullptr if the
+    // file could not be read, then or on an earlier call.
+    FlowDataset* Get(int index);
+
+    // The reader Load() uses for a file, not yet updated.
+    static vtkSmartPointer<vtkAlgorithm> CreateReader(const std::string& fileName);
+
+private:
+    bool Load(FlowDataset& dataset);
+
+    std::vector<std::unique_ptr<FlowDataset>> Datasets;
+};
+
+#endif
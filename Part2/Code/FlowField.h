@@ -0,0 +1,827 @@
+#ifndef FlowField_h
+#define FlowField_h
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Fetch() of the reduced-precision storages decodes with SSE4.1 / F16C on
+// x86 CPUs that have them and with scalar code elsewhere. Only the decode
+// functions are compiled for those instruction sets (MSVC emits any
+// intrinsic without /arch), so the rest of the program runs on any x86 CPU.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FLOWFIELD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FLOWFIELD_TARGET(features)
+#else
+#include <cpuid.h>
+#define FLOWFIELD_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+// The instruction sets of this CPU that Fetch() can decode with, detected
+// once. F16C counts only when the OS saves the AVX registers, as its
+// instructions are VEX encoded.
+struct FlowFieldCpuFeatures
+{
+    bool SSE41 = false;
+    bool F16C = false;
+
+    static const FlowFieldCpuFeatures& Get()
+    {
+        static const FlowFieldCpuFeatures features = FlowFieldCpuFeatures::Detect();
+        return features;
+    }
+
+private:
+    static FlowFieldCpuFeatures Detect()
+    {
+        FlowFieldCpuFeatures features;
+#ifdef FLOWFIELD_X86
+        unsigned int leaf1[4] = { 0, 0, 0, 0 }; // eax, ebx, ecx, edx
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 1)
+        {
+            return features;
+        }
+        __cpuid(info, 1);
+        std::copy(info, info + 4, leaf1);
+#else
+        if (!__get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]))
+        {
+            return features;
+        }
+#endif
+        const bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+        const bool avx = (leaf1[2] & (1u << 28)) != 0;
+        features.SSE41 = (leaf1[2] & (1u << 19)) != 0;
+        if (osxsave && avx && (leaf1[2] & (1u << 29)))
+        {
+            // XCR0 bits 1 and 2: SSE and AVX state enabled.
+#ifdef _MSC_VER
+            const unsigned long long xcr0 = _xgetbv(0);
+#else
+            unsigned int eax = 0;
+            unsigned int edx = 0;
+            __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            const unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+            features.F16C = (xcr0 & 0x6) == 0x6;
+        }
+#endif
+        return features;
+    }
+};
+
+// The instructions Fetch() decodes with, for reports.
+inline const char* GetHalfFloatDecodePath()
+{
+    return FlowFieldCpuFeatures::Get().F16C ? "F16C" : "scalar code";
+}
+
+inline const char* GetQuantizedDecodePath()
+{
+    return FlowFieldCpuFeatures::Get().SSE41 ? "SSE4.1" : "scalar code";
+}
+
+// Vector storage: three floats per grid point in VTK point order
+// (x fastest). Fetch() is the only access the samplers use, so other
+// layouts can replace this class as the Storage of a FlowField.
+class LinearFloatStorage
+{
+public:
+    void Assign(vtkDataArray* vectors, const int dims[3])
+    {
+        std::copy(dims, dims + 3, this->Dims);
+        this->Values.resize(3 * static_cast<std::size_t>(vectors->GetNumberOfTuples()));
+        vtkSMPTools::For(0, vectors->GetNumberOfTuples(), [&](vtkIdType begin, vtkIdType end) {
+            double v[3] = { 0.0, 0.0, 0.0 };
+            for (vtkIdType id = begin; id < end; ++id)
+            {
+                vectors->GetTuple(id, v);
+                for (int c = 0; c < 3; ++c)
+                {
+                    this->Values[3 * id + c] = static_cast<float>(v[c]);
+                }
+            }
+        });
+    }
+
+    // Takes over 3 * dims[0] * dims[1] * dims[2] values.
+    void Assign(std::vector<float>&& values, const int dims[3])
+    {
+        std::copy(dims, dims + 3, this->Dims);
+        this->Values = std::move(values);
+    }
+
+    void Fetch(int i, int j, int k, float v[3]) const
+    {
+        const float* p = &this->Values[this->GetOffset(i, j, k)];
+        v[0] = p[0];
+        v[1] = p[1];
+        v[2] = p[2];
+    }
+
+    // Index of the first component of point (i, j, k) in GetValues().
+    std::size_t GetOffset(int i, int j, int k) const
+    {
+        return 3 * (i + static_cast<std::size_t>(this->Dims[0]) * (j + static_cast<std::size_t>(this->Dims[1]) * k));
+    }
+
+    const std::vector<float>& GetValues() const { return this->Values; }
+
+    std::size_t GetMemorySize() const { return this->Values.size() * sizeof(float); }
+
+private:
+    int Dims[3] = { 0, 0, 0 };
+    std::vector<float> Values;
+};
+
+// Storage choices for a tracer's copy of the vectors.
+enum class VectorPrecision
+{
+    Float32, // LinearFloatStorage
+    Float16, // HalfFloatStorage
+    Int16,   // BlockQuantizedStorage<std::int16_t>
+    Int8     // BlockQuantizedStorage<std::int8_t>
+};
+
+inline const char* GetVectorPrecisionName(VectorPrecision precision)
+{
+    switch (precision)
+    {
+        case VectorPrecision::Float16:
+            return "float16";
+        case VectorPrecision::Int16:
+            return "int16 blocks";
+        case VectorPrecision::Int8:
+            return "int8 blocks";
+        default:
+            return "float32";
+    }
+}
+
+// Memory layouts of a float32 copy of the vectors.
+enum class FieldLayout
+{
+    Linear, // LinearFloatStorage, VTK point order
+    Bricked // BrickedFloatStorage
+};
+
+inline const char* GetFieldLayoutName(FieldLayout layout)
+{
+    return (layout == FieldLayout::Bricked) ? "bricked" : "linear";
+}
+
+// Vector storage as IEEE half floats in VTK point order, 6 bytes per point
+// instead of 12. Each component keeps 11 significant bits: a relative error
+// of about 2^-11 down to 6.1e-5, an absolute error of at most 2^-25 below.
+// Magnitudes above 65504 are clamped to it.
+class HalfFloatStorage
+{
+public:
+    void Assign(vtkDataArray* vectors, const int dims[3])
+    {
+        std::copy(dims, dims + 3, this->Dims);
+        this->UseF16C = FlowFieldCpuFeatures::Get().F16C;
+        // One padding value so Fetch() can load four halves at the last point.
+        this->Values.assign(3 * static_cast<std::size_t>(vectors->GetNumberOfTuples()) + 1, 0);
+        vtkSMPTools::For(0, vectors->GetNumberOfTuples(), [&](vtkIdType begin, vtkIdType end) {
+            double v[3] = { 0.0, 0.0, 0.0 };
+            for (vtkIdType id = begin; id < end; ++id)
+            {
+                vectors->GetTuple(id, v);
+                for (int c = 0; c < 3; ++c)
+                {
+                    this->Values[3 * id + c] = HalfFloatStorage::FromFloat(static_cast<float>(v[c]));
+                }
+            }
+        });
+    }
+
+    void Fetch(int i, int j, int k, float v[3]) const
+    {
+        std::size_t id = i + static_cast<std::size_t>(this->Dims[0]) * (j + static_cast<std::size_t>(this->Dims[1]) * k);
+        const std::uint16_t* p = &this->Values[3 * id];
+#ifdef FLOWFIELD_X86
+        if (this->UseF16C)
+        {
+            HalfFloatStorage::ToFloatF16C(p, v);
+            return;
+        }
+#endif
+        v[0] = HalfFloatStorage::ToFloat(p[0]);
+        v[1] = HalfFloatStorage::ToFloat(p[1]);
+        v[2] = HalfFloatStorage::ToFloat(p[2]);
+    }
+
+    std::size_t GetMemorySize() const { return this->Values.size() * sizeof(std::uint16_t); }
+
+    // Round to nearest even, as F16C does.
+    static std::uint16_t FromFloat(float value)
+    {
+        value = std::min(std::max(value, -65504.0f), 65504.0f);
+        std::uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+        const std::uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+        std::uint32_t h;
+        if (f > 0x7F800000u)
+        {
+            h = 0x7E00u; // NaN
+        }
+        else if (f < 0x38800000u)
+        {
+            // Below the smallest normal half: adding 0.5 lets the FPU round
+            // the mantissa into the low bits.
+            const std::uint32_t magicBits = 126u << 23;
+            float magic;
+            float shifted;
+            std::memcpy(&magic, &magicBits, sizeof(magic));
+            std::memcpy(&shifted, &f, sizeof(shifted));
+            shifted += magic;
+            std::memcpy(&h, &shifted, sizeof(h));
+            h -= magicBits;
+        }
+        else
+        {
+            const std::uint32_t odd = (f >> 13) & 1u;
+            f += 0xC8000FFFu; // rebias the exponent from 127 to 15, plus half an ulp minus one
+            f += odd;
+            h = f >> 13;
+        }
+        return static_cast<std::uint16_t>(h | (sign >> 16));
+    }
+
+    static float ToFloat(std::uint16_t half)
+    {
+        const std::uint32_t shiftedExponent = 0x7C00u << 13;
+        std::uint32_t f = (half & 0x7FFFu) << 13;
+        const std::uint32_t exponent = f & shiftedExponent;
+        f += (127u - 15u) << 23;
+        float value;
+        if (exponent == shiftedExponent)
+        {
+            f += (128u - 16u) << 23; // Inf / NaN
+            std::memcpy(&value, &f, sizeof(value));
+        }
+        else if (exponent == 0)
+        {
+            // Subnormal: renormalize through the FPU.
+            f += 1u << 23;
+            const std::uint32_t magicBits = 113u << 23;
+            float magic;
+            std::memcpy(&value, &f, sizeof(value));
+            std::memcpy(&magic, &magicBits, sizeof(magic));
+            value -= magic;
+        }
+        else
+        {
+            std::memcpy(&value, &f, sizeof(value));
+        }
+        return (half & 0x8000u) ? -value : value;
+    }
+
+private:
+#ifdef FLOWFIELD_X86
+    // Reads four halves from p.
+    FLOWFIELD_TARGET("f16c") static void ToFloatF16C(const std::uint16_t* p, float v[3])
+    {
+        float decoded[4];
+        _mm_storeu_ps(decoded, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+        v[0] = decoded[0];
+        v[1] = decoded[1];
+        v[2] = decoded[2];
+    }
+#endif
+
+    bool UseF16C = false;
+    int Dims[3] = { 0, 0, 0 };
+    std::vector<std::uint16_t> Values;
+};
+
+// Vector storage as 8- or 16-bit integers in VTK point order with one float
+// scale per component and block of BlockSize^3 points: a component is
+// q * scale, where scale is the largest magnitude of that component in the
+// block divided by the largest q. The error of a component is at most half
+// its block's scale, so it is relative to the local flow speed rather than
+// to the fastest point of the field. 3 (int8) or 6 (int16) bytes per point
+// plus 16 bytes per block.
+template <typename T>
+class BlockQuantizedStorage
+{
+public:
+    static const int BlockShift = 3;
+    static const int BlockSize = 1 << BlockShift;
+
+    void Assign(vtkDataArray* vectors, const int dims[3])
+    {
+        std::copy(dims, dims + 3, this->Dims);
+        this->UseSSE41 = FlowFieldCpuFeatures::Get().SSE41;
+        for (int a = 0; a < 3; ++a)
+        {
+            this->BlockDims[a] = (dims[a] + BlockSize - 1) / BlockSize;
+        }
+        const int* blocks = this->BlockDims;
+        const vtkIdType numBlocks = static_cast<vtkIdType>(blocks[0]) * blocks[1] * blocks[2];
+        const vtkIdType numRows = static_cast<vtkIdType>(dims[1]) * dims[2];
+        // Four scales per block and padding after the last point, so Fetch()
+        // can load whole vector registers.
+        this->Scales.assign(4 * static_cast<std::size_t>(numBlocks), 0.0f);
+        this->Values.assign(3 * static_cast<std::size_t>(numRows) * dims[0] + 4, 0);
+
+        // Pass 1: block scales from the largest magnitude per component.
+        const float maxCode = static_cast<float>(std::numeric_limits<T>::max());
+        vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+            double v[3];
+            for (vtkIdType block = begin; block < end; ++block)
+            {
+                const vtkIdType slab = static_cast<vtkIdType>(blocks[0]) * blocks[1];
+                const int b[3] = { static_cast<int>(block % blocks[0]), static_cast<int>((block % slab) / blocks[0]),
+                    static_cast<int>(block / slab) };
+                double largest[3] = { 0.0, 0.0, 0.0 };
+                for (int k = b[2] * BlockSize; k < std::min((b[2] + 1) * BlockSize, dims[2]); ++k)
+                {
+                    for (int j = b[1] * BlockSize; j < std::min((b[1] + 1) * BlockSize, dims[1]); ++j)
+                    {
+                        const vtkIdType row = j + static_cast<vtkIdType>(dims[1]) * k;
+                        for (int i = b[0] * BlockSize; i < std::min((b[0] + 1) * BlockSize, dims[0]); ++i)
+                        {
+                            vectors->GetTuple(i + row * dims[0], v);
+                            for (int c = 0; c < 3; ++c)
+                            {
+                                largest[c] = std::max(largest[c], std::abs(v[c]));
+                            }
+                        }
+                    }
+                }
+                for (int c = 0; c < 3; ++c)
+                {
+                    this->Scales[4 * block + c] = static_cast<float>(largest[c] / maxCode);
+                }
+            }
+        });
+
+        // Pass 2: the codes, rounded to nearest.
+        vtkSMPTools::For(0, numRows, [&](vtkIdType begin, vtkIdType end) {
+            double v[3];
+            for (vtkIdType row = begin; row < end; ++row)
+            {
+                const int j = static_cast<int>(row % dims[1]);
+                const int k = static_cast<int>(row / dims[1]);
+                for (int i = 0; i < dims[0]; ++i)
+                {
+                    const vtkIdType id = i + row * dims[0];
+                    const float* scale = &this->Scales[4 * this->GetBlock(i, j, k)];
+                    vectors->GetTuple(id, v);
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        const double q = (scale[c] > 0.0f) ? std::round(v[c] / scale[c]) : 0.0;
+                        this->Values[3 * id + c] = static_cast<T>(std::min(std::max(q, -1.0 * maxCode), 1.0 * maxCode));
+                    }
+                }
+            }
+        });
+    }
+
+    void Fetch(int i, int j, int k, float v[3]) const
+    {
+        std::size_t id = i + static_cast<std::size_t>(this->Dims[0]) * (j + static_cast<std::size_t>(this->Dims[1]) * k);
+        const float* scale = &this->Scales[4 * this->GetBlock(i, j, k)];
+        const T* q = &this->Values[3 * id];
+#ifdef FLOWFIELD_X86
+        if (this->UseSSE41)
+        {
+            BlockQuantizedStorage::DecodeSSE41(q, scale, v);
+            return;
+        }
+#endif
+        v[0] = q[0] * scale[0];
+        v[1] = q[1] * scale[1];
+        v[2] = q[2] * scale[2];
+    }
+
+    std::size_t GetMemorySize() const
+    {
+        return this->Values.size() * sizeof(T) + this->Scales.size() * sizeof(float);
+    }
+
+private:
+    std::size_t GetBlock(int i, int j, int k) const
+    {
+        return (i >> BlockShift) +
+            static_cast<std::size_t>(this->BlockDims[0]) *
+            ((j >> BlockShift) + static_cast<std::size_t>(this->BlockDims[1]) * (k >> BlockShift));
+    }
+
+#ifdef FLOWFIELD_X86
+    // Reads four codes and four scales; the padding keeps that in bounds.
+    FLOWFIELD_TARGET("sse4.1") static void DecodeSSE41(const T* q, const float* scale, float v[3])
+    {
+        float decoded[4];
+        _mm_storeu_ps(decoded, _mm_mul_ps(_mm_cvtepi32_ps(BlockQuantizedStorage::Widen(q)), _mm_loadu_ps(scale)));
+        v[0] = decoded[0];
+        v[1] = decoded[1];
+        v[2] = decoded[2];
+    }
+
+    // Four codes sign-extended to 32-bit lanes.
+    FLOWFIELD_TARGET("sse4.1") static __m128i Widen(const std::int16_t* q)
+    {
+        return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q)));
+    }
+    FLOWFIELD_TARGET("sse4.1") static __m128i Widen(const std::int8_t* q)
+    {
+        int packed;
+        std::memcpy(&packed, q, sizeof(packed));
+        return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed));
+    }
+#endif
+
+    bool UseSSE41 = false;
+    int Dims[3] = { 0, 0, 0 };
+    int BlockDims[3] = { 0, 0, 0 };
+    std::vector<float> Scales;
+    std::vector<T> Values;
+};
+
+// Float storage in bricks of BrickSize^3 points, for samplers that jump
+// around the grid. Inside a brick the points are in Morton (Z) order, so the
+// eight corners of a cell usually lie within 96 bytes of each other and
+// neighbours along y and z are at most one brick (6 KiB for vectors) away,
+// where the linear layout puts them a row or a slice apart. Bricks follow
+// each other x fastest. The grid is padded with zeros to whole bricks.
+// Components is 3 for a FlowField's vectors and 1 for scalars.
+template <int Components = 3>
+class BrickedFloatStorage
+{
+public:
+    static const int BrickShift = 3;
+    static const int BrickSize = 1 << BrickShift;
+    static const int BrickPoints = BrickSize * BrickSize * BrickSize;
+
+    // Converts from VTK point order in parallel; components past the array's
+    // are 0.
+    void Assign(vtkDataArray* values, const int dims[3])
+    {
+        this->Allocate(dims);
+        const int n = std::min(values->GetNumberOfComponents(), Components);
+        this->ForEachPoint([&](vtkIdType id, std::size_t offset, std::vector<double>& tuple) {
+            tuple.resize(values->GetNumberOfComponents());
+            values->GetTuple(id, tuple.data());
+            for (int c = 0; c < n; ++c)
+            {
+                this->Values[offset + c] = static_cast<float>(tuple[c]);
+            }
+        });
+    }
+
+    // Converts Components * dims[0] * dims[1] * dims[2] values in VTK point
+    // order.
+    void Assign(const float* values, const int dims[3])
+    {
+        this->Allocate(dims);
+        this->ForEachPoint([&](vtkIdType id, std::size_t offset, std::vector<double>&) {
+            std::copy(values + Components * id, values + Components * (id + 1), &this->Values[offset]);
+        });
+    }
+
+    // Writes the values back in VTK point order.
+    void CopyTo(float* values) const
+    {
+        this->ForEachPoint([&](vtkIdType id, std::size_t offset, std::vector<double>&) {
+            std::copy(&this->Values[offset], &this->Values[offset] + Components, values + Components * id);
+        });
+    }
+
+    void Fetch(int i, int j, int k, float v[Components]) const
+    {
+        const float* p = &this->Values[this->GetOffset(i, j, k)];
+        for (int c = 0; c < Components; ++c)
+        {
+            v[c] = p[c];
+        }
+    }
+
+    // Index of the first component of point (i, j, k) in GetValues().
+    std::size_t GetOffset(int i, int j, int k) const
+    {
+        return this->AxisOffsets[0][i] + this->AxisOffsets[1][j] + this->AxisOffsets[2][k];
+    }
+
+    const std::vector<float>& GetValues() const { return this->Values; }
+
+    std::size_t GetMemorySize() const { return this->Values.size() * sizeof(float); }
+
+private:
+    // The bits of a 3-bit brick coordinate two places apart.
+    static int Spread(int b) { return (b & 1) | ((b & 2) << 2) | ((b & 4) << 4); }
+
+    void Allocate(const int dims[3])
+    {
+        std::copy(dims, dims + 3, this->Dims);
+        for (int a = 0; a < 3; ++a)
+        {
+            this->BrickDims[a] = (dims[a] + BrickSize - 1) / BrickSize;
+        }
+        const std::size_t numBricks =
+            static_cast<std::size_t>(this->BrickDims[0]) * this->BrickDims[1] * this->BrickDims[2];
+        this->Values.assign(Components * BrickPoints * numBricks, 0.0f);
+
+        // The offset of a point is a sum of one term per axis: its brick
+        // times the brick stride along the axis plus its bits of the Morton
+        // index.
+        std::size_t brickStride = Components * BrickPoints;
+        for (int a = 0; a < 3; ++a)
+        {
+            this->AxisOffsets[a].resize(std::max(dims[a], 1));
+            for (int i = 0; i < dims[a]; ++i)
+            {
+                this->AxisOffsets[a][i] =
+                    (i >> BrickShift) * brickStride + Components * (Spread(i & (BrickSize - 1)) << a);
+            }
+            brickStride *= this->BrickDims[a];
+        }
+    }
+
+    // Calls f(point id, GetOffset() of the point, scratch tuple) for every
+    // grid point, in parallel over bricks so that each task has its own.
+    template <typename F>
+    void ForEachPoint(F&& f) const
+    {
+        const int* dims = this->Dims;
+        const int* bricks = this->BrickDims;
+        const vtkIdType slab = static_cast<vtkIdType>(bricks[0]) * bricks[1];
+        vtkSMPTools::For(0, slab * bricks[2], [&](vtkIdType begin, vtkIdType end) {
+            std::vector<double> tuple;
+            for (vtkIdType brick = begin; brick < end; ++brick)
+            {
+                const int b[3] = { static_cast<int>(brick % bricks[0]), static_cast<int>((brick % slab) / bricks[0]),
+                    static_cast<int>(brick / slab) };
+                for (int k = b[2] * BrickSize; k < std::min((b[2] + 1) * BrickSize, dims[2]); ++k)
+                {
+                    for (int j = b[1] * BrickSize; j < std::min((b[1] + 1) * BrickSize, dims[1]); ++j)
+                    {
+                        const vtkIdType row = j + static_cast<vtkIdType>(dims[1]) * k;
+                        for (int i = b[0] * BrickSize; i < std::min((b[0] + 1) * BrickSize, dims[0]); ++i)
+                        {
+                            f(i + row * dims[0], this->GetOffset(i, j, k), tuple);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    int Dims[3] = { 0, 0, 0 };
+    int BrickDims[3] = { 0, 0, 0 };
+    std::vector<std::size_t> AxisOffsets[3];
+    std::vector<float> Values;
+};
+
+// A vector field on a uniform grid with trilinear sampling and a fixed-step
+// RK4 integrator. Axes with a single sample (the z axis of the 2D test data)
+// are not interpolated and ignore that coordinate. All const members are safe
+// to call from vtkSMPTools workers.
+template <typename Storage = LinearFloatStorage>
+class FlowField
+{
+public:
+    // Copies the geometry and the active vectors of `image`. Returns false if
+    // it has no vectors.
+    bool Assign(vtkImageData* image)
+    {
+        vtkDataArray* vectors = image->GetPointData()->GetVectors();
+        if (!vectors)
+        {
+            return false;
+        }
+        this->SetGeometry(image->GetDimensions(), image->GetOrigin(), image->GetSpacing());
+        this->Data.Assign(vectors, this->Dimensions);
+        return true;
+    }
+
+    void SetGeometry(const int dims[3], const double origin[3], const double spacing[3])
+    {
+        std::copy(dims, dims + 3, this->Dimensions);
+        std::copy(origin, origin + 3, this->Origin);
+        std::copy(spacing, spacing + 3, this->Spacing);
+    }
+
+    const int* GetDimensions() const { return this->Dimensions; }
+    const double* GetOrigin() const { return this->Origin; }
+    const double* GetSpacing() const { return this->Spacing; }
+
+    Storage& GetStorage() { return this->Data; }
+    const Storage& GetStorage() const { return this->Data; }
+
+    bool Contains(const double x[3]) const
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            double t = (x[c] - this->Origin[c]) / this->Spacing[c];
+            if (this->Dimensions[c] > 1 && !(t >= 0.0 && t <= this->Dimensions[c] - 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Trilinear interpolation at x. Returns false outside the grid.
+    bool Sample(const double x[3], double v[3]) const
+    {
+        int i0[3];
+        int i1[3];
+        double f[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            if (this->Dimensions[c] < 2)
+            {
+                i0[c] = i1[c] = 0;
+                f[c] = 0.0;
+                continue;
+            }
+            double t = (x[c] - this->Origin[c]) / this->Spacing[c];
+            if (!(t >= 0.0 && t <= this->Dimensions[c] - 1))
+            {
+                return false;
+            }
+            i0[c] = std::min(static_cast<int>(t), this->Dimensions[c] - 2);
+            i1[c] = i0[c] + 1;
+            f[c] = t - i0[c];
+        }
+
+        v[0] = v[1] = v[2] = 0.0;
+        float corner[3];
+        for (int n = 0; n < 8; ++n)
+        {
+            double w = ((n & 1) ? f[0] : 1.0 - f[0]) * ((n & 2) ? f[1] : 1.0 - f[1]) * ((n & 4) ? f[2] : 1.0 - f[2]);
+            if (w == 0.0)
+            {
+                continue;
+            }
+            this->Data.Fetch((n & 1) ? i1[0] : i0[0], (n & 2) ? i1[1] : i0[1], (n & 4) ? i1[2] : i0[2], corner);
+            for (int c = 0; c < 3; ++c)
+            {
+                v[c] += w * corner[c];
+            }
+        }
+        return true;
+    }
+
+    // Fourth-order Runge-Kutta over `duration` (negative integrates backward)
+    // with steps of at most `step`. If the particle leaves the grid, x stays
+    // at its last position inside and false is returned.
+    bool Advect(double x[3], double duration, double step) const
+    {
+        if (duration == 0.0 || step <= 0.0)
+        {
+            return true;
+        }
+        const int numSteps = static_cast<int>(std::ceil(std::abs(duration) / step));
+        const double h = duration / numSteps;
+        double k1[3];
+        double k2[3];
+        double k3[3];
+        double k4[3];
+        double y[3];
+        for (int s = 0; s < numSteps; ++s)
+        {
+            if (!this->Sample(x, k1))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + 0.5 * h * k1[c];
+            }
+            if (!this->Sample(y, k2))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + 0.5 * h * k2[c];
+            }
+            if (!this->Sample(y, k3))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + h * k3[c];
+            }
+            if (!this->Sample(y, k4))
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                y[c] = x[c] + h / 6.0 * (k1[c] + 2.0 * k2[c] + 2.0 * k3[c] + k4[c]);
+            }
+            if (!this->Contains(y))
+            {
+                return false;
+            }
+            std::copy(y, y + 3, x);
+        }
+        return true;
+    }
+
+private:
+    int Dimensions[3] = { 0, 0, 0 };
+    double Origin[3] = { 0.0, 0.0, 0.0 };
+    double Spacing[3] = { 1.0, 1.0, 1.0 };
+    Storage Data;
+};
+
+// Read access to one vector per point id, for filters that can take their
+// vectors from a FlowField's storage instead of the input's array. All
+// members are safe to call from vtkSMPTools workers.
+class FlowVectorSource
+{
+public:
+    virtual ~FlowVectorSource() = default;
+
+    virtual vtkIdType GetNumberOfPoints() const = 0;
+    virtual void GetVector(vtkIdType id, double v[3]) const = 0;
+    virtual std::size_t GetMemorySize() const = 0;
+};
+
+// The vectors of an image in a FlowField's Storage, decoded point by point,
+// so a reduced-precision copy is never expanded back to floats.
+template <typename Storage>
+class FlowFieldVectorSource : public FlowVectorSource
+{
+public:
+    // False if `image` has no vectors.
+    bool Assign(vtkImageData* image) { return this->Field.Assign(image); }
+
+    vtkIdType GetNumberOfPoints() const override
+    {
+        const int* dims = this->Field.GetDimensions();
+        return static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+    }
+
+    void GetVector(vtkIdType id, double v[3]) const override
+    {
+        const int* dims = this->Field.GetDimensions();
+        const vtkIdType row = id / dims[0];
+        float value[3];
+        this->Field.GetStorage().Fetch(static_cast<int>(id - row * dims[0]), static_cast<int>(row % dims[1]),
+            static_cast<int>(row / dims[1]), value);
+        v[0] = value[0];
+        v[1] = value[1];
+        v[2] = value[2];
+    }
+
+    std::size_t GetMemorySize() const override { return this->Field.GetStorage().GetMemorySize(); }
+
+private:
+    FlowField<Storage> Field;
+};
+
+template <typename Storage>
+std::shared_ptr<FlowVectorSource> CreateFlowVectorSource(vtkImageData* image)
+{
+    std::shared_ptr<FlowFieldVectorSource<Storage>> source = std::make_shared<FlowFieldVectorSource<Storage>>();
+    if (!source->Assign(image))
+    {
+        return nullptr;
+    }
+    return source;
+}
+
+// A copy of the vectors of `image` at `precision`; nullptr without vectors.
+inline std::shared_ptr<FlowVectorSource> CreateFlowVectorSource(vtkImageData* image, VectorPrecision precision)
+{
+    switch (precision)
+    {
+        case VectorPrecision::Float16:
+            return CreateFlowVectorSource<HalfFloatStorage>(image);
+        case VectorPrecision::Int16:
+            return CreateFlowVectorSource<BlockQuantizedStorage<std::int16_t>>(image);
+        case VectorPrecision::Int8:
+            return CreateFlowVectorSource<BlockQuantizedStorage<std::int8_t>>(image);
+        default:
+            return CreateFlowVectorSource<LinearFloatStorage>(image);
+    }
+}
+
+#endif
@@ -0,0 +1,1373 @@
+#include "FlowPipelines.h"
+
+#include "ActiveBlockIndex.h"
+#include "CompactStreamlines.h"
+#include "FlowDatasetPool.h"
+#include "FlowField.h"
+#include "ParticleSystem.h"
+#include "VolumeHistogram.h"
+
+#include "vtkActor.h"
+#include "vtkArrowSource.h"
+#include "vtkCamera.h"
+#include "vtkColorTransferFunction.h"
+#include "vtkCommand.h"
+#include "vtkConeSource.h"
+#include "vtkCpuVolumeActor.h"
+#include "vtkDataArray.h"
+#include "vtkDataSetMapper.h"
+#include "vtkExtractVOI.h"
+#include "vtkFTLEFilter.h"
+#include "vtkGlyph3DMapper.h"
+#include "vtkImageData.h"
+#include "vtkInstancedGlyph3D.h"
+#include "vtkLookupTable.h"
+#include "vtkMultiIsoSurface.h"
+#include "vtkNamedColors.h"
+#include "vtkOutlineFilter.h"
+#include "vtkParallelHedgeHog.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkPointData.h"
+#include "vtkPointSource.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataMapper.h"
+#include "vtkProperty.h"
+#include "vtkRenderWindowInteractor.h"
+#include "vtkRenderer.h"
+#include "vtkSliderRepresentation2D.h"
+#include "vtkSliderWidget.h"
+#include "vtkStreamTracer.h"
+#include "vtkStructuredPoints.h"
+#include "vtkTimerLog.h"
+#include "vtkTubeFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+class PipelineSliderCallback : public vtkCommand
+{
+public:
+    static PipelineSliderCallback* New()
+    {
+        return new PipelineSliderCallback;
+    }
+
+    void Execute(vtkObject* caller, unsigned long, void*) override
+    {
+        vtkSliderWidget* sliderWidget = reinterpret_cast<vtkSliderWidget*>(caller);
+        double value = static_cast<vtkSliderRepresentation*>(sliderWidget->GetRepresentation())->GetValue();
+        double start = vtkTimerLog::GetUniversalTime();
+        this->Pipeline->SliderChanged(this->Slider, value);
+        this->Pipeline->AddUpdateTime((vtkTimerLog::GetUniversalTime() - start) * 1000.0);
+    }
+
+    FlowPipeline* Pipeline = nullptr;
+    int Slider = 0;
+};
+
+void FlowPipeline::SetupCamera(vtkRenderer* renderer)
+{
+    renderer->ResetCamera();
+}
+
+void FlowPipeline::Show(vtkRenderer* renderer)
+{
+    for (vtkProp* prop : this->Props)
+    {
+        renderer->AddViewProp(prop);
+    }
+    for (vtkSliderWidget* slider : this->Sliders)
+    {
+        slider->EnabledOn();
+    }
+}
+
+double FlowPipeline::TakeUpdateTime()
+{
+    double ms = this->UpdateTime;
+    this->UpdateTime = 0.0;
+    return ms;
+}
+
+void FlowPipeline::Hide(vtkRenderer* renderer)
+{
+    for (vtkProp* prop : this->Props)
+    {
+        renderer->RemoveViewProp(prop);
+    }
+    for (vtkSliderWidget* slider : this->Sliders)
+    {
+        slider->EnabledOff();
+    }
+}
+
+vtkSliderWidget* FlowPipeline::AddSlider(vtkRenderWindowInteractor* iren, const char* title, double minimum,
+    double maximum, double value, double x1, double x2, double y)
+{
+    vtkSmartPointer<vtkSliderRepresentation2D> sliderRep = vtkSmartPointer<vtkSliderRepresentation2D>::New();
+    sliderRep->SetMinimumValue(minimum);
+    sliderRep->SetMaximumValue(maximum);
+    sliderRep->SetValue(value);
+    sliderRep->SetTitleText(title);
+    sliderRep->GetPoint1Coordinate()->SetCoordinateSystemToNormalizedDisplay();
+    sliderRep->GetPoint1Coordinate()->SetValue(x1, y);
+    sliderRep->GetPoint2Coordinate()->SetCoordinateSystemToNormalizedDisplay();
+    sliderRep->GetPoint2Coordinate()->SetValue(x2, y);
+    sliderRep->SetSliderLength(0.02);
+    sliderRep->SetSliderWidth(0.03);
+    sliderRep->SetEndCapLength(0.02);
+
+    vtkSmartPointer<vtkSliderWidget> sliderWidget = vtkSmartPointer<vtkSliderWidget>::New();
+    sliderWidget->SetInteractor(iren);
+    sliderWidget->SetRepresentation(sliderRep);
+    sliderWidget->SetAnimationModeToAnimate();
+
+    vtkSmartPointer<PipelineSliderCallback> callback = vtkSmartPointer<PipelineSliderCallback>::New();
+    callback->Pipeline = this;
+    callback->Slider = static_cast<int>(this->Sliders.size());
+    sliderWidget->AddObserver(vtkCommand::InteractionEvent, callback);
+
+    this->Sliders.push_back(sliderWidget);
+    return sliderWidget;
+}
+
+void SetStartingPoints(vtkPolyData* polyData, const FlowDataset& dataset, int spacing)
+{
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    const double* b = dataset.Bounds;
+    double step = std::max(spacing, 1);
+
+    if (dataset.Is3D())
+    {
+        for (double x = b[0]; x <= b[1]; x += step)
+        {
+            for (double y = b[2]; y <= b[3]; y += step)
+            {
+                for (double z = b[4]; z <= b[5]; z += step)
+                {
+                    points->InsertNextPoint(x, y, z);
+                }
+            }
+        }
+    }
+    else
+    {
+        for (double x = b[0]; x <= b[1]; x += step)
+        {
+            for (double y = b[2]; y <= b[3]; y += step)
+            {
+                points->InsertNextPoint(x, y, b[4]);
+            }
+        }
+    }
+
+    polyData->SetPoints(points);
+}
+
+namespace
+{
+
+// Scale that maps the longest vector of the dataset to length 1.
+double GetUnitVectorScale(const FlowDataset* dataset)
+{
+    if (!dataset || dataset->MaxVectorMagnitude <= 0.0)
+    {
+        return 1.0;
+    }
+    return 1.0 / dataset->MaxVectorMagnitude;
+}
+
+// p in the hedgehog and glyph modes cycles the precision the filters read the
+// vectors at: float32 (the dataset's own array), float16, int16 and int8
+// blocks, decoded point by point.
+VectorPrecision GetNextVectorPrecision(VectorPrecision precision)
+{
+    return static_cast<VectorPrecision>((static_cast<int>(precision) + 1) % 4);
+}
+
+std::shared_ptr<const FlowVectorSource> CreateVectorSource(const FlowDataset* dataset, VectorPrecision precision)
+{
+    if (!dataset || precision == VectorPrecision::Float32)
+    {
+        return nullptr;
+    }
+    return CreateFlowVectorSource(dataset->GetOutput(), precision);
+}
+
+void PrintVectorSource(const char* mode, VectorPrecision precision, const FlowVectorSource* source,
+    const FlowDataset* dataset)
+{
+    std::size_t size = source ? source->GetMemorySize() : 0;
+    vtkDataArray* vectors = dataset->GetOutput()->GetPointData()->GetVectors();
+    if (!source && vectors)
+    {
+        size = static_cast<std::size_t>(vectors->GetActualMemorySize()) * 1024;
+    }
+    std::cout << mode << ": " << GetVectorPrecisionName(precision) << " vectors, " << size / 1024 << " KiB"
+              << std::endl;
+}
+
+const double SkinIsoValue = 500.0;
+const double BoneIsoValue = 1150.0;
+
+// Speed contour of Solution3_Carotid.
+const double SpeedContourValue = 175.0;
+
+vtkSmartPointer<vtkPolyData> ExpandGlyphs(vtkInstancedGlyph3D* glyph)
+{
+    glyph->Update();
+    vtkSmartPointer<vtkPolyData> expanded = vtkSmartPointer<vtkPolyData>::New();
+    vtkInstancedGlyph3D::ExpandInstances(
+        glyph->GetOutput(0), vtkPolyData::SafeDownCast(glyph->GetOutputDataObject(1)), expanded);
+    return expanded;
+}
+
+vtkSmartPointer<vtkLookupTable> MakeBlueToRedLookupTable()
+{
+    vtkSmartPointer<vtkLookupTable> lut = vtkSmartPointer<vtkLookupTable>::New();
+    lut->SetHueRange(0.667, 0.0);
+    lut->Build();
+    return lut;
+}
+
+// Solution1: hedgehog lines scaled by a slider.
+class HedgeHogPipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "hedgehog"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->HedgeHog = vtkSmartPointer<vtkParallelHedgeHog>::New();
+
+        vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        mapper->SetInputConnection(this->HedgeHog->GetOutputPort());
+        mapper->SetScalarRange(0.0, 1.0);
+        mapper->SetLookupTable(MakeBlueToRedLookupTable());
+
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->SetMapper(mapper);
+        this->Props.push_back(actor);
+
+        this->AddSlider(iren, "Scale Factor", 1.0, 50.0, this->ScaleFactor, 0.3, 0.7, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->HedgeHog->SetInputConnection(dataset->GetOutputPort());
+        this->HedgeHog->SetScaleFactor(this->ScaleFactor * GetUnitVectorScale(dataset));
+        this->HedgeHog->SetVectorSource(CreateVectorSource(dataset, this->Precision));
+    }
+
+    void SliderChanged(int, double value) override
+    {
+        this->ScaleFactor = value;
+        this->HedgeHog->SetScaleFactor(this->ScaleFactor * GetUnitVectorScale(this->Dataset));
+    }
+
+    bool KeyPressed(const std::string& key) override
+    {
+        if (key != "p" || !this->Dataset)
+        {
+            return false;
+        }
+        this->Precision = GetNextVectorPrecision(this->Precision);
+        this->HedgeHog->SetVectorSource(CreateVectorSource(this->Dataset, this->Precision));
+        PrintVectorSource(this->GetName(), this->Precision, this->HedgeHog->GetVectorSource().get(), this->Dataset);
+        return true;
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        this->HedgeHog->Update();
+        geometry.emplace_back("lines", this->HedgeHog->GetOutput());
+    }
+
+private:
+    vtkSmartPointer<vtkParallelHedgeHog> HedgeHog;
+    double ScaleFactor = 3.0;
+    VectorPrecision Precision = VectorPrecision::Float32;
+};
+
+// Solution2: oriented cones whose radius and height follow two sliders.
+class ConeGlyphPipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "glyph"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->ConeSource = vtkSmartPointer<vtkConeSource>::New();
+        this->ConeSource->SetRadius(0.1);
+        this->ConeSource->SetHeight(0.5);
+        this->ConeSource->SetResolution(10);
+
+        // The cones are drawn as instances of one mesh, so the sliders only
+        // regenerate the cone and never the per-point table.
+        this->Glyph = vtkSmartPointer<vtkInstancedGlyph3D>::New();
+        this->Glyph->SetSourceConnection(this->ConeSource->GetOutputPort());
+        this->Glyph->SetColorModeToColorByScale();
+        this->Glyph->SetScalarRange(0.0, 1.0);
+        this->Glyph->SetLookupTable(MakeBlueToRedLookupTable());
+
+        vtkSmartPointer<vtkGlyph3DMapper> mapper = vtkSmartPointer<vtkGlyph3DMapper>::New();
+        this->Glyph->ConfigureMapper(mapper);
+
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->SetMapper(mapper);
+        this->Props.push_back(actor);
+
+        this->AddSlider(iren, "Radius", 0.05, 0.5, this->ConeSource->GetRadius(), 0.18, 0.48, 0.1);
+        this->AddSlider(iren, "Height", 0.1, 2.0, this->ConeSource->GetHeight(), 0.52, 0.82, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->Glyph->SetInputConnection(dataset->GetOutputPort());
+        this->Glyph->SetScaleFactor(10.0 * GetUnitVectorScale(dataset));
+        this->Glyph->SetVectorSource(CreateVectorSource(dataset, this->Precision));
+    }
+
+    void SliderChanged(int slider, double value) override
+    {
+        if (slider == 0)
+        {
+            this->ConeSource->SetRadius(value);
+        }
+        else
+        {
+            this->ConeSource->SetHeight(value);
+        }
+    }
+
+    void SetDetailLevel(double level) override
+    {
+        this->Glyph->SetStride(1 + static_cast<int>(std::round(7.0 * level)));
+    }
+
+    bool KeyPressed(const std::string& key) override
+    {
+        if (key != "p" || !this->Dataset)
+        {
+            return false;
+        }
+        this->Precision = GetNextVectorPrecision(this->Precision);
+        this->Glyph->SetVectorSource(CreateVectorSource(this->Dataset, this->Precision));
+        PrintVectorSource(this->GetName(), this->Precision, this->Glyph->GetVectorSource().get(), this->Dataset);
+        return true;
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        geometry.emplace_back("cones", ExpandGlyphs(this->Glyph));
+    }
+
+private:
+    vtkSmartPointer<vtkConeSource> ConeSource;
+    vtkSmartPointer<vtkInstancedGlyph3D> Glyph;
+    VectorPrecision Precision = VectorPrecision::Float32;
+};
+
+// Solution3: streamlines from a seed grid whose spacing follows a slider.
+// Traced lines are kept per dataset and spacing in compact form, so moving the
+// slider back to a spacing seen before only decodes instead of re-tracing.
+class StreamlinePipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "streamline"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->Seeds = vtkSmartPointer<vtkPolyData>::New();
+
+        this->StreamTracer = vtkSmartPointer<vtkStreamTracer>::New();
+        this->StreamTracer->SetSourceData(this->Seeds);
+        this->StreamTracer->SetIntegrationDirectionToForward();
+        this->StreamTracer->SetMaximumPropagation(100.0);
+        this->StreamTracer->SetInitialIntegrationStep(0.1);
+        this->StreamTracer->SetIntegratorTypeToRungeKutta4();
+
+        this->StreamMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        this->StreamMapper->SetScalarRange(0.0, 1.0);
+
+        vtkSmartPointer<vtkActor> streamActor = vtkSmartPointer<vtkActor>::New();
+        streamActor->SetMapper(this->StreamMapper);
+        this->Props.push_back(streamActor);
+
+        this->AddSlider(iren, "Spacing", 1, 20, this->Spacing, 0.35, 0.65, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->StreamTracer->SetInputConnection(dataset->GetOutputPort());
+        this->UpdateLines();
+    }
+
+    void SliderChanged(int, double value) override
+    {
+        this->Spacing = static_cast<int>(value);
+        this->UpdateLines();
+    }
+
+    // Coarser levels trace from a sparser seed grid, up to 4x the spacing.
+    void SetDetailLevel(double level) override
+    {
+        this->DetailLevel = level;
+        if (this->Dataset)
+        {
+            this->UpdateLines();
+        }
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        geometry.emplace_back("lines", this->StreamMapper->GetInput());
+    }
+
+private:
+    void UpdateLines()
+    {
+        int spacing = static_cast<int>(std::round(this->Spacing * (1.0 + 3.0 * this->DetailLevel)));
+        std::shared_ptr<CompactStreamlines>& lines = this->Dataset->Streamlines[spacing];
+        if (!lines)
+        {
+            SetStartingPoints(this->Seeds, *this->Dataset, spacing);
+            this->StreamTracer->Update();
+
+            // Only the positions and the scalars the mapper colors by are kept.
+            vtkPolyData* traced = this->StreamTracer->GetOutput();
+            lines = std::make_shared<CompactStreamlines>();
+            lines->Encode(traced, { traced->GetPointData()->GetScalars() });
+        }
+        this->StreamMapper->SetInputData(lines->Decode());
+    }
+
+    vtkSmartPointer<vtkPolyData> Seeds;
+    vtkSmartPointer<vtkStreamTracer> StreamTracer;
+    vtkSmartPointer<vtkPolyDataMapper> StreamMapper;
+    int Spacing = 3;
+    double DetailLevel = 0.0;
+};
+
+// Solution4: arrows placed along the streamlines of a fixed seed grid.
+class StreamGlyphPipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "streamglyph"; }
+
+    void Build(vtkRenderWindowInteractor*) override
+    {
+        this->Seeds = vtkSmartPointer<vtkPolyData>::New();
+
+        this->StreamTracer = vtkSmartPointer<vtkStreamTracer>::New();
+        this->StreamTracer->SetSourceData(this->Seeds);
+        this->StreamTracer->SetIntegrationDirectionToForward();
+        this->StreamTracer->SetMaximumPropagation(100.0);
+        this->StreamTracer->SetInitialIntegrationStep(0.1);
+        this->StreamTracer->SetIntegratorTypeToRungeKutta4();
+
+        vtkSmartPointer<vtkArrowSource> arrowSource = vtkSmartPointer<vtkArrowSource>::New();
+
+        vtkSmartPointer<vtkLookupTable> lut = vtkSmartPointer<vtkLookupTable>::New();
+        lut->Build();
+
+        this->Glyph = vtkSmartPointer<vtkInstancedGlyph3D>::New();
+        this->Glyph->SetInputConnection(this->StreamTracer->GetOutputPort());
+        this->Glyph->SetSourceConnection(arrowSource->GetOutputPort());
+        this->Glyph->SetColorModeToColorByVector();
+        this->Glyph->SetLookupTable(lut);
+
+        vtkSmartPointer<vtkGlyph3DMapper> glyphMapper = vtkSmartPointer<vtkGlyph3DMapper>::New();
+        this->Glyph->ConfigureMapper(glyphMapper);
+
+        vtkSmartPointer<vtkActor> glyphActor = vtkSmartPointer<vtkActor>::New();
+        glyphActor->SetMapper(glyphMapper);
+        this->Props.push_back(glyphActor);
+
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->StreamTracer->SetInputConnection(dataset->GetOutputPort());
+
+        // Seed spacing and arrow size used to be picked per file name; derive
+        // them from the extent and vector range instead.
+        double extent = std::max(dataset->Bounds[1] - dataset->Bounds[0], dataset->Bounds[3] - dataset->Bounds[2]);
+        int spacing = dataset->Is3D() ? 10 : std::max(5, static_cast<int>(extent / 18.0 + 0.5));
+        SetStartingPoints(this->Seeds, *dataset, spacing);
+
+        double scaleFactor = 3.0;
+        if (dataset->MaxVectorMagnitude > 10.0)
+        {
+            scaleFactor = 3.0 / dataset->MaxVectorMagnitude;
+        }
+        this->Glyph->SetScaleFactor(scaleFactor);
+    }
+
+    void SliderChanged(int, double) override {}
+
+    void SetDetailLevel(double level) override
+    {
+        this->Glyph->SetStride(1 + static_cast<int>(std::round(7.0 * level)));
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        this->StreamTracer->Update();
+        geometry.emplace_back("lines", this->StreamTracer->GetOutput());
+        geometry.emplace_back("arrows", ExpandGlyphs(this->Glyph));
+    }
+
+private:
+    vtkSmartPointer<vtkPolyData> Seeds;
+    vtkSmartPointer<vtkStreamTracer> StreamTracer;
+    vtkSmartPointer<vtkInstancedGlyph3D> Glyph;
+};
+
+// Solution3_Carotid: tubes around streamlines from a point cloud seed, a
+// speed contour and the dataset outline. An ActiveBlockIndex over the
+// dataset, with the tracer's terminal speed and the contour value as
+// thresholds, drops seeds and stops lines in blocks without flow and limits
+// the contour to blocks that can contain it, without changing either result.
+// Most of the carotid bounding box lies outside the vessel.
+class CarotidPipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "carotid"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->PointSource = vtkSmartPointer<vtkPointSource>::New();
+        this->PointSource->SetNumberOfPoints(this->NumberOfPoints);
+        this->PointSource->SetRadius(2.0);
+
+        this->Seeds = vtkSmartPointer<vtkPolyData>::New();
+
+        this->Streamers = vtkSmartPointer<vtkStreamTracer>::New();
+        this->Streamers->SetSourceData(this->Seeds);
+        this->Streamers->SetMaximumPropagation(100.0);
+        this->Streamers->SetInitialIntegrationStep(0.2);
+        this->Streamers->SetTerminalSpeed(.01);
+        this->Streamers->AddCustomTerminationCallback(
+            CarotidPipeline::LeftActiveBlocks, this, vtkStreamTracer::FIXED_REASONS_FOR_TERMINATION_COUNT);
+
+        this->Tubes = vtkSmartPointer<vtkTubeFilter>::New();
+        this->Tubes->SetInputConnection(this->Streamers->GetOutputPort());
+        this->Tubes->SetRadius(0.3);
+        this->Tubes->SetNumberOfSides(6);
+        this->Tubes->SetVaryRadius(0);
+
+        this->StreamerMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        this->StreamerMapper->SetInputConnection(this->Tubes->GetOutputPort());
+        this->StreamerMapper->SetLookupTable(MakeBlueToRedLookupTable());
+
+        vtkSmartPointer<vtkActor> streamerActor = vtkSmartPointer<vtkActor>::New();
+        streamerActor->SetMapper(this->StreamerMapper);
+
+        // Contours of speed
+        this->Iso = vtkSmartPointer<vtkMultiIsoSurface>::New();
+        this->Iso->SetValue(0, SpeedContourValue);
+        this->Iso->ComputeNormalsOff();
+
+        vtkSmartPointer<vtkPolyDataMapper> isoMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        isoMapper->SetInputConnection(this->Iso->GetOutputPort());
+        isoMapper->ScalarVisibilityOff();
+
+        vtkSmartPointer<vtkActor> isoActor = vtkSmartPointer<vtkActor>::New();
+        isoActor->SetMapper(isoMapper);
+        isoActor->GetProperty()->SetRepresentationToWireframe();
+        isoActor->GetProperty()->SetOpacity(0.25);
+
+        // Outline
+        this->Outline = vtkSmartPointer<vtkOutlineFilter>::New();
+
+        vtkSmartPointer<vtkPolyDataMapper> outlineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        outlineMapper->SetInputConnection(this->Outline->GetOutputPort());
+
+        vtkSmartPointer<vtkActor> outlineActor = vtkSmartPointer<vtkActor>::New();
+        outlineActor->SetMapper(outlineMapper);
+        outlineActor->GetProperty()->SetColor(1.0, 1.0, 1.0);
+
+        this->Props.push_back(outlineActor);
+        this->Props.push_back(streamerActor);
+        this->Props.push_back(isoActor);
+
+        this->AddSlider(iren, "Tube Radius", 0.1, 1.0, 0.3, 0.1, 0.4, 0.1);
+        this->AddSlider(iren, "Number of Points", 10, 100, this->NumberOfPoints, 0.1, 0.4, 0.17);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->Streamers->SetInputConnection(dataset->GetOutputPort());
+        this->Iso->SetInputConnection(dataset->GetOutputPort());
+        this->Outline->SetInputConnection(dataset->GetOutputPort());
+
+        // The seed position was tuned for carotid.vtk; other datasets are
+        // seeded at their center.
+        if (dataset->Name == "carotid")
+        {
+            this->PointSource->SetCenter(133.1, 116.3, 5.0);
+        }
+        else
+        {
+            const double* b = dataset->Bounds;
+            this->PointSource->SetCenter((b[0] + b[1]) / 2, (b[2] + b[3]) / 2, (b[4] + b[5]) / 2);
+        }
+
+        const double terminalSpeed = this->Streamers->GetTerminalSpeed();
+        std::shared_ptr<ActiveBlockIndex>& blocks = dataset->ActiveBlocks;
+        if (!blocks || blocks->GetSpeedThreshold() != terminalSpeed ||
+            blocks->GetScalarThreshold() != SpeedContourValue)
+        {
+            vtkPointData* pd = dataset->GetOutput()->GetPointData();
+            blocks = std::make_shared<ActiveBlockIndex>();
+            blocks->Build(dataset->GetOutput(), pd->GetVectors(), terminalSpeed, pd->GetScalars(), SpeedContourValue);
+            std::cout << dataset->Name << ": " << blocks->GetNumberOfActiveBlocks() << " of "
+                      << blocks->GetNumberOfBlocks() << " blocks active" << std::endl;
+        }
+        this->Blocks = blocks;
+        this->Iso->SetActiveBlocks(blocks);
+        this->UpdateSeeds();
+
+        this->Streamers->Update();
+        vtkDataArray* scalars = this->Streamers->GetOutput()->GetPointData()->GetScalars();
+        if (scalars)
+        {
+            this->StreamerMapper->SetScalarRange(scalars->GetRange());
+        }
+    }
+
+    void SliderChanged(int slider, double value) override
+    {
+        if (slider == 0)
+        {
+            this->Tubes->SetRadius(value);
+        }
+        else
+        {
+            this->NumberOfPoints = static_cast<int>(value);
+        }
+        this->ApplyDetailLevel();
+    }
+
+    // Fewer seeds and coarser tubes: down to 20% of the seeds and 3 sides.
+    void SetDetailLevel(double level) override
+    {
+        this->DetailLevel = level;
+        this->ApplyDetailLevel();
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        this->Tubes->Update();
+        this->Iso->Update();
+        geometry.emplace_back("lines", this->Streamers->GetOutput());
+        geometry.emplace_back("tubes", this->Tubes->GetOutput());
+        geometry.emplace_back("contour", this->Iso->GetOutput());
+    }
+
+    void SetupCamera(vtkRenderer* renderer) override
+    {
+        if (!this->Dataset || this->Dataset->Name != "carotid")
+        {
+            FlowPipeline::SetupCamera(renderer);
+            return;
+        }
+
+        vtkCamera* cam1 = renderer->GetActiveCamera();
+        cam1->SetFocalPoint(136.71, 104.025, 23);
+        cam1->SetPosition(204.747, 258.939, 63.7925);
+        cam1->SetViewUp(-0.102647, -0.210897, 0.972104);
+        cam1->SetClippingRange(17.4043, 870.216);
+        cam1->Zoom(1.2);
+    }
+
+private:
+    void ApplyDetailLevel()
+    {
+        int numberOfPoints = static_cast<int>(std::round(this->NumberOfPoints * (1.0 - 0.8 * this->DetailLevel)));
+        this->PointSource->SetNumberOfPoints(std::max(numberOfPoints, 5));
+        this->Tubes->SetNumberOfSides(std::max(3, 6 - static_cast<int>(std::round(3.0 * this->DetailLevel))));
+        this->UpdateSeeds();
+    }
+
+    // Seeds are the point cloud minus the points in inactive blocks.
+    void UpdateSeeds()
+    {
+        if (!this->Blocks)
+        {
+            return;
+        }
+        this->PointSource->Update();
+        vtkPoints* cloud = this->PointSource->GetOutput()->GetPoints();
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        for (vtkIdType i = 0; i < cloud->GetNumberOfPoints(); ++i)
+        {
+            double x[3];
+            cloud->GetPoint(i, x);
+            if (this->Blocks->IsActive(x))
+            {
+                points->InsertNextPoint(x);
+            }
+        }
+        this->Seeds->SetPoints(points);
+    }
+
+    // Custom termination of the tracer: the newest point of the line is in an
+    // inactive block. Called from the tracer's worker threads.
+    static bool LeftActiveBlocks(void* clientData, vtkPoints* points, vtkDataArray*, int)
+    {
+        const ActiveBlockIndex* blocks = static_cast<CarotidPipeline*>(clientData)->Blocks.get();
+        if (!blocks || points->GetNumberOfPoints() == 0)
+        {
+            return false;
+        }
+        double x[3];
+        points->GetPoint(points->GetNumberOfPoints() - 1, x);
+        return !blocks->IsActive(x);
+    }
+
+    vtkSmartPointer<vtkPointSource> PointSource;
+    vtkSmartPointer<vtkPolyData> Seeds;
+    vtkSmartPointer<vtkStreamTracer> Streamers;
+    vtkSmartPointer<vtkTubeFilter> Tubes;
+    vtkSmartPointer<vtkPolyDataMapper> StreamerMapper;
+    vtkSmartPointer<vtkMultiIsoSurface> Iso;
+    vtkSmartPointer<vtkOutlineFilter> Outline;
+    std::shared_ptr<ActiveBlockIndex> Blocks;
+    int NumberOfPoints = 25;
+    double DetailLevel = 0.0;
+};
+
+// Finite-time Lyapunov exponent on a resampled grid. Time scales follow the
+// dataset: the slider reaches the time the fastest flow needs to cross half
+// the domain diagonal, and flow maps are cached in 1/64 of that, so dragging
+// the time slider mostly composes cached maps.
+class FTLEPipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "ftle"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->FTLE = vtkSmartPointer<vtkFTLEFilter>::New();
+
+        // 3D datasets show the middle z slice of the field.
+        this->Slice = vtkSmartPointer<vtkExtractVOI>::New();
+        this->Slice->SetInputConnection(this->FTLE->GetOutputPort());
+
+        this->Mapper = vtkSmartPointer<vtkDataSetMapper>::New();
+        this->Mapper->SetInputConnection(this->Slice->GetOutputPort());
+        this->Mapper->SetLookupTable(MakeBlueToRedLookupTable());
+
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->SetMapper(this->Mapper);
+        this->Props.push_back(actor);
+
+        this->AddSlider(iren, "Integration Time", 0.0, 1.0, 0.2, 0.18, 0.48, 0.1);
+        this->AddSlider(iren, "Resolution", 1, 4, this->Resolution, 0.52, 0.82, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->FTLE->SetInputConnection(dataset->GetOutputPort());
+
+        const double* b = dataset->Bounds;
+        double diagonal = std::sqrt((b[1] - b[0]) * (b[1] - b[0]) + (b[3] - b[2]) * (b[3] - b[2]) +
+            (b[5] - b[4]) * (b[5] - b[4]));
+        double cell = VTK_DOUBLE_MAX;
+        for (int c = 0; c < 3; ++c)
+        {
+            if (dataset->Dimensions[c] > 1)
+            {
+                cell = std::min(cell, (b[2 * c + 1] - b[2 * c]) / (dataset->Dimensions[c] - 1));
+            }
+        }
+        double speed = std::max(dataset->MaxVectorMagnitude, 1e-6);
+        double maximumTime = 0.5 * diagonal / speed;
+        this->FTLE->SetFlowMapInterval(maximumTime / 64.0);
+        this->FTLE->SetStepSize(std::min(maximumTime / 256.0, 0.5 * cell / speed));
+        this->FTLE->SetIntegrationTime(0.2 * maximumTime);
+
+        vtkSliderRepresentation* rep = static_cast<vtkSliderRepresentation*>(this->Sliders[0]->GetRepresentation());
+        rep->SetMaximumValue(maximumTime);
+        rep->SetMinimumValue(maximumTime / 64.0);
+        rep->SetValue(0.2 * maximumTime);
+
+        this->UpdateSampling();
+    }
+
+    void SliderChanged(int slider, double value) override
+    {
+        if (slider == 0)
+        {
+            this->FTLE->SetIntegrationTime(value);
+        }
+        else
+        {
+            this->Resolution = value;
+        }
+        this->UpdateSampling();
+    }
+
+private:
+    void UpdateSampling()
+    {
+        int dims[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            int d = this->Dataset->Dimensions[c];
+            dims[c] = (d > 1) ? static_cast<int>(std::lround((d - 1) * this->Resolution)) + 1 : 1;
+        }
+        this->FTLE->SetSampleDimensions(dims);
+        this->Slice->SetVOI(0, dims[0] - 1, 0, dims[1] - 1, dims[2] / 2, dims[2] / 2);
+        this->Slice->Update();
+        this->Mapper->SetScalarRange(this->Slice->GetOutput()->GetScalarRange());
+    }
+
+    vtkSmartPointer<vtkFTLEFilter> FTLE;
+    vtkSmartPointer<vtkExtractVOI> Slice;
+    vtkSmartPointer<vtkDataSetMapper> Mapper;
+    double Resolution = 1.0;
+};
+
+// Part1.py: skin and bone isosurfaces of a CT volume (FullHead.mhd), or the
+// volume itself through the CPU ray caster, with Part1's keys: v / i switch
+// to volume / isosurface view, Right / Left change the ray step by 0.1,
+// 1 / 2 and 3 / 4 raise / lower the opacity at the skin and bone values.
+// m toggles preintegration to compare it with post-classification. b
+// switches the skin and bone values between Part1's and the two lowest
+// boundaries the dataset's value x gradient histogram suggests.
+class VolumePipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "volume"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        vtkSmartPointer<vtkNamedColors> colors = vtkSmartPointer<vtkNamedColors>::New();
+        colors->SetColor("SkinColor", 240, 184, 160, 255);
+        colors->SetColor("BackfaceColor", 255, 229, 200, 255);
+
+        // Both surfaces come out of one pass over the volume, already in
+        // strips.
+        this->Extractor = vtkSmartPointer<vtkMultiIsoSurface>::New();
+        this->Extractor->SetValue(0, this->SkinValue);
+        this->Extractor->SetValue(1, this->BoneValue);
+
+        vtkSmartPointer<vtkPolyDataMapper> skinMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        skinMapper->SetInputConnection(this->Extractor->GetOutputPort(0));
+        skinMapper->ScalarVisibilityOff();
+
+        this->Skin = vtkSmartPointer<vtkActor>::New();
+        this->Skin->SetMapper(skinMapper);
+        this->Skin->GetProperty()->SetDiffuseColor(colors->GetColor3d("SkinColor").GetData());
+        this->Skin->GetProperty()->SetSpecular(0.3);
+        this->Skin->GetProperty()->SetSpecularPower(20);
+        this->Skin->GetProperty()->SetOpacity(0.5);
+        vtkSmartPointer<vtkProperty> backProp = vtkSmartPointer<vtkProperty>::New();
+        backProp->SetDiffuseColor(colors->GetColor3d("BackfaceColor").GetData());
+        this->Skin->SetBackfaceProperty(backProp);
+
+        vtkSmartPointer<vtkPolyDataMapper> boneMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        boneMapper->SetInputConnection(this->Extractor->GetOutputPort(1));
+        boneMapper->ScalarVisibilityOff();
+
+        this->Bone = vtkSmartPointer<vtkActor>::New();
+        this->Bone->SetMapper(boneMapper);
+        this->Bone->GetProperty()->SetDiffuseColor(colors->GetColor3d("Ivory").GetData());
+
+        this->Outline = vtkSmartPointer<vtkOutlineFilter>::New();
+        vtkSmartPointer<vtkPolyDataMapper> outlineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        outlineMapper->SetInputConnection(this->Outline->GetOutputPort());
+        vtkSmartPointer<vtkActor> outline = vtkSmartPointer<vtkActor>::New();
+        outline->SetMapper(outlineMapper);
+        outline->GetProperty()->SetColor(colors->GetColor3d("Black").GetData());
+
+        this->Color = vtkSmartPointer<vtkColorTransferFunction>::New();
+        this->Opacity = vtkSmartPointer<vtkPiecewiseFunction>::New();
+        SetupVolumeTransferFunctions(this->Color, this->Opacity, this->SkinValue, this->BoneValue);
+
+        this->Volume = vtkSmartPointer<vtkCpuVolumeActor>::New();
+        this->Volume->SetColor(this->Color);
+        this->Volume->SetScalarOpacity(this->Opacity);
+        this->ApplySampleDistance();
+
+        this->Props.push_back(outline);
+        this->Props.push_back(this->Skin);
+        this->Props.push_back(this->Bone);
+        this->Props.push_back(this->Volume);
+
+        this->AddSlider(iren, "Skin Opacity", 0.0, 1.0, this->Skin->GetProperty()->GetOpacity(), 0.1, 0.8, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->Extractor->SetInputConnection(dataset->GetOutputPort());
+        this->Outline->SetInputConnection(dataset->GetOutputPort());
+        this->Volume->SetInputData(dataset->GetOutput());
+
+        if (!dataset->Histogram)
+        {
+            std::shared_ptr<VolumeHistogram> histogram = std::make_shared<VolumeHistogram>();
+            if (histogram->Compute(dataset->GetOutput()))
+            {
+                dataset->Histogram = histogram;
+                std::cout << dataset->Name << ": histogram in " << histogram->GetComputeTime()
+                          << " ms, boundaries at";
+                for (double value : histogram->SuggestBoundaries())
+                {
+                    std::cout << " " << value;
+                }
+                std::cout << std::endl;
+            }
+        }
+        if (this->SuggestedValues)
+        {
+            this->ApplyBoundaryValues();
+        }
+    }
+
+    void SliderChanged(int, double value) override
+    {
+        this->Skin->GetProperty()->SetOpacity(value);
+    }
+
+    void Show(vtkRenderer* renderer) override
+    {
+        FlowPipeline::Show(renderer);
+        this->UpdateView();
+    }
+
+    void SetupCamera(vtkRenderer* renderer) override
+    {
+        vtkCamera* camera = renderer->GetActiveCamera();
+        camera->SetViewUp(0, 0, -1);
+        camera->SetPosition(0, -1, 0);
+        camera->SetFocalPoint(0, 0, 0);
+        camera->Azimuth(30.0);
+        camera->Elevation(30.0);
+        camera->Dolly(1.5);
+        renderer->ResetCamera();
+        renderer->ResetCameraClippingRange();
+    }
+
+    bool KeyPressed(const std::string& key) override
+    {
+        if (key == "Right")
+        {
+            this->RayStepSize += 0.1;
+        }
+        else if (key == "Left")
+        {
+            this->RayStepSize = std::max(0.1, this->RayStepSize - 0.1);
+        }
+        else if (key == "1" || key == "2")
+        {
+            this->AdjustOpacity(this->SkinValue, key == "1" ? 0.1 : -0.1);
+        }
+        else if (key == "3" || key == "4")
+        {
+            this->AdjustOpacity(this->BoneValue, key == "3" ? 0.1 : -0.1);
+        }
+        else if (key == "v" || key == "i")
+        {
+            this->VolumeView = (key == "v");
+            this->UpdateView();
+        }
+        else if (key == "m")
+        {
+            this->Volume->SetPreintegrated(!this->Volume->GetPreintegrated());
+            std::cout << (this->Volume->GetPreintegrated() ? "preintegrated" : "post-classification") << std::endl;
+        }
+        else if (key == "b")
+        {
+            this->SuggestedValues = !this->SuggestedValues;
+            this->ApplyBoundaryValues();
+        }
+        else
+        {
+            return false;
+        }
+        this->ApplySampleDistance();
+        return true;
+    }
+
+    // Rays take up to 4x longer steps; the preintegration table keeps the
+    // image free of slicing artifacts at those distances.
+    void SetDetailLevel(double level) override
+    {
+        this->DetailLevel = level;
+        this->ApplySampleDistance();
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        this->Extractor->Update();
+        geometry.emplace_back("skin", this->Extractor->GetOutput(0));
+        geometry.emplace_back("bone", this->Extractor->GetOutput(1));
+    }
+
+private:
+    void ApplySampleDistance()
+    {
+        this->Volume->SetSampleDistance(this->RayStepSize * (1.0 + 3.0 * this->DetailLevel));
+    }
+
+    void AdjustOpacity(double value, double delta)
+    {
+        double opacity = std::min(std::max(this->Opacity->GetValue(value) + delta, 0.0), 1.0);
+        this->Opacity->AddPoint(value, opacity);
+    }
+
+    // Part1's 500 / 1150, or the two lowest of the suggested boundaries in
+    // increasing order when the histogram found at least two.
+    void ApplyBoundaryValues()
+    {
+        double skin = SkinIsoValue;
+        double bone = BoneIsoValue;
+        if (this->SuggestedValues && this->Dataset && this->Dataset->Histogram)
+        {
+            std::vector<double> values = this->Dataset->Histogram->SuggestBoundaries();
+            std::sort(values.begin(), values.end());
+            if (values.size() >= 2)
+            {
+                skin = values[0];
+                bone = values[1];
+            }
+        }
+        this->SkinValue = skin;
+        this->BoneValue = bone;
+        this->Extractor->SetValue(0, skin);
+        this->Extractor->SetValue(1, bone);
+        SetupVolumeTransferFunctions(this->Color, this->Opacity, skin, bone);
+        std::cout << "skin " << skin << ", bone " << bone << std::endl;
+    }
+
+    void UpdateView()
+    {
+        this->Skin->SetVisibility(!this->VolumeView);
+        this->Bone->SetVisibility(!this->VolumeView);
+        this->Volume->SetVisibility(this->VolumeView);
+        this->Sliders[0]->SetEnabled(!this->VolumeView);
+    }
+
+    vtkSmartPointer<vtkMultiIsoSurface> Extractor;
+    vtkSmartPointer<vtkOutlineFilter> Outline;
+    vtkSmartPointer<vtkActor> Skin;
+    vtkSmartPointer<vtkActor> Bone;
+    vtkSmartPointer<vtkColorTransferFunction> Color;
+    vtkSmartPointer<vtkPiecewiseFunction> Opacity;
+    vtkSmartPointer<vtkCpuVolumeActor> Volume;
+    double RayStepSize = 0.5;
+    double DetailLevel = 0.0;
+    bool VolumeView = false;
+    double SkinValue = SkinIsoValue;
+    double BoneValue = BoneIsoValue;
+    bool SuggestedValues = false;
+};
+
+// Particles injected continuously from a seed region and advected on all
+// cores every frame by a ParticleSystem, driven by an interactor timer while
+// the mode is shown. Carotid is seeded where its streamlines start, 2D data
+// over the whole grid and other 3D data in a box at the center. p switches
+// the field the particles sample to reduced precision and back.
+class ParticlePipeline : public FlowPipeline
+{
+public:
+    const char* GetName() const override { return "particles"; }
+
+    void Build(vtkRenderWindowInteractor* iren) override
+    {
+        this->Interactor = iren;
+        this->Particles.SetCapacity(MaxParticles);
+        this->Particles.SetEmissionRate(this->EmissionRate);
+
+        this->Mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        this->Mapper->SetInputData(this->Particles.GetOutput());
+        this->Mapper->SetLookupTable(MakeBlueToRedLookupTable());
+
+        vtkSmartPointer<vtkActor> particles = vtkSmartPointer<vtkActor>::New();
+        particles->SetMapper(this->Mapper);
+        particles->GetProperty()->SetPointSize(2.0);
+
+        this->Outline = vtkSmartPointer<vtkOutlineFilter>::New();
+        vtkSmartPointer<vtkPolyDataMapper> outlineMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        outlineMapper->SetInputConnection(this->Outline->GetOutputPort());
+        vtkSmartPointer<vtkActor> outline = vtkSmartPointer<vtkActor>::New();
+        outline->SetMapper(outlineMapper);
+        outline->GetProperty()->SetColor(1.0, 1.0, 1.0);
+
+        this->Props.push_back(outline);
+        this->Props.push_back(particles);
+
+        vtkSmartPointer<ParticleTimerCallback> callback = vtkSmartPointer<ParticleTimerCallback>::New();
+        callback->Pipeline = this;
+        iren->AddObserver(vtkCommand::TimerEvent, callback);
+
+        this->AddSlider(iren, "Particles per Frame", 0, 50000, this->EmissionRate, 0.1, 0.4, 0.1);
+        this->AddSlider(iren, "Speed", 0.25, 4.0, this->SpeedScale, 0.6, 0.9, 0.1);
+        this->Built = true;
+    }
+
+    void SetDataset(FlowDataset* dataset) override
+    {
+        this->Dataset = dataset;
+        this->Outline->SetInputConnection(dataset->GetOutputPort());
+        this->Particles.ClearSeedRegions();
+        if (!this->Particles.SetField(dataset->GetOutput()))
+        {
+            std::cerr << dataset->Name << ": no vectors to advect particles in" << std::endl;
+            this->Particles.Reset();
+            return;
+        }
+
+        const double* b = dataset->Bounds;
+        if (dataset->Name == "carotid")
+        {
+            const double seeds[6] = { 131.1, 135.1, 114.3, 118.3, 3.0, 7.0 };
+            this->Particles.AddSeedRegion(seeds);
+        }
+        else if (!dataset->Is3D())
+        {
+            this->Particles.AddSeedRegion(b);
+        }
+        else
+        {
+            double seeds[6];
+            for (int c = 0; c < 3; ++c)
+            {
+                double center = (b[2 * c] + b[2 * c + 1]) / 2;
+                double half = 0.05 * (b[2 * c + 1] - b[2 * c]);
+                seeds[2 * c] = center - half;
+                seeds[2 * c + 1] = center + half;
+            }
+            this->Particles.AddSeedRegion(seeds);
+        }
+
+        // At speed 1 the fastest particle moves half a cell per frame and
+        // lives long enough to cross the domain twice.
+        double diagonal = std::sqrt((b[1] - b[0]) * (b[1] - b[0]) + (b[3] - b[2]) * (b[3] - b[2]) +
+            (b[5] - b[4]) * (b[5] - b[4]));
+        double cell = VTK_DOUBLE_MAX;
+        for (int c = 0; c < 3; ++c)
+        {
+            if (dataset->Dimensions[c] > 1)
+            {
+                cell = std::min(cell, (b[2 * c + 1] - b[2 * c]) / (dataset->Dimensions[c] - 1));
+            }
+        }
+        double speed = std::max(dataset->MaxVectorMagnitude, 1e-6);
+        this->BaseTimeStep = 0.5 * cell / speed;
+        this->Particles.SetMaxAge(2.0 * diagonal / speed);
+        this->Particles.SetMinimumSpeed(1e-3 * speed);
+        this->Particles.SetTimeStep(this->SpeedScale * this->BaseTimeStep);
+        this->Particles.Reset();
+        this->Mapper->SetScalarRange(0.0, speed);
+    }
+
+    void SliderChanged(int slider, double value) override
+    {
+        if (slider == 0)
+        {
+            this->EmissionRate = static_cast<vtkIdType>(value);
+            this->ApplyDetailLevel();
+        }
+        else
+        {
+            this->SpeedScale = value;
+            this->Particles.SetTimeStep(this->SpeedScale * this->BaseTimeStep);
+        }
+    }
+
+    // Fewer new particles per frame, down to a quarter; the ones in flight
+    // are kept.
+    void SetDetailLevel(double level) override
+    {
+        this->DetailLevel = level;
+        this->ApplyDetailLevel();
+    }
+
+    void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>& geometry) override
+    {
+        geometry.emplace_back("particles", this->Particles.GetOutput());
+    }
+
+    void Show(vtkRenderer* renderer) override
+    {
+        FlowPipeline::Show(renderer);
+        // Timers need the window, which exists once the interactor is
+        // initialized.
+        if (!this->Interactor->GetInitialized())
+        {
+            this->Interactor->Initialize();
+        }
+        if (this->TimerId == 0)
+        {
+            this->TimerId = this->Interactor->CreateRepeatingTimer(FrameInterval);
+        }
+    }
+
+    // p cycles the precision of the particles' copy of the field: float32,
+    // float16, int16 and int8 blocks. l switches a float32 copy between the
+    // linear and the bricked layout. Particles in flight are kept.
+    bool KeyPressed(const std::string& key) override
+    {
+        if ((key != "p" && key != "l") || !this->Dataset)
+        {
+            return false;
+        }
+        if (key == "p")
+        {
+            this->Particles.SetPrecision(GetNextVectorPrecision(this->Particles.GetPrecision()));
+        }
+        else
+        {
+            this->Particles.SetLayout(
+                this->Particles.GetLayout() == FieldLayout::Linear ? FieldLayout::Bricked : FieldLayout::Linear);
+        }
+        this->Particles.SetField(this->Dataset->GetOutput());
+        std::cout << "particles: " << GetVectorPrecisionName(this->Particles.GetPrecision()) << " field";
+        if (this->Particles.GetPrecision() == VectorPrecision::Float32)
+        {
+            std::cout << ", " << GetFieldLayoutName(this->Particles.GetLayout());
+        }
+        std::cout << ", " << this->Particles.GetFieldMemorySize() / 1024 << " KiB" << std::endl;
+        return true;
+    }
+
+    void Hide(vtkRenderer* renderer) override
+    {
+        FlowPipeline::Hide(renderer);
+        if (this->TimerId != 0)
+        {
+            this->Interactor->DestroyTimer(this->TimerId);
+            this->TimerId = 0;
+        }
+    }
+
+private:
+    // Advances the particles and renders on every tick of the pipeline's
+    // timer.
+    class ParticleTimerCallback : public vtkCommand
+    {
+    public:
+        static ParticleTimerCallback* New()
+        {
+            return new ParticleTimerCallback;
+        }
+
+        void Execute(vtkObject*, unsigned long, void* callData) override
+        {
+            ParticlePipeline* pipeline = this->Pipeline;
+            if (!callData || pipeline->TimerId == 0 || *static_cast<int*>(callData) != pipeline->TimerId)
+            {
+                return;
+            }
+            double start = vtkTimerLog::GetUniversalTime();
+            pipeline->Particles.Step();
+            pipeline->AddUpdateTime((vtkTimerLog::GetUniversalTime() - start) * 1000.0);
+            pipeline->Interactor->Render();
+        }
+
+        ParticlePipeline* Pipeline = nullptr;
+    };
+
+    void ApplyDetailLevel()
+    {
+        double rate = this->EmissionRate * (1.0 - 0.75 * this->DetailLevel);
+        this->Particles.SetEmissionRate(static_cast<vtkIdType>(std::round(rate)));
+    }
+
+    static const vtkIdType MaxParticles = 1000000;
+    static const unsigned long FrameInterval = 33; // ms
+
+    ParticleSystem Particles;
+    vtkRenderWindowInteractor* Interactor = nullptr;
+    int TimerId = 0;
+    vtkSmartPointer<vtkPolyDataMapper> Mapper;
+    vtkSmartPointer<vtkOutlineFilter> Outline;
+    vtkIdType EmissionRate = 10000;
+    double SpeedScale = 1.0;
+    double BaseTimeStep = 0.1;
+    double DetailLevel = 0.0;
+};
+
+} // namespace
+
+void SetupVolumeTransferFunctions(
+    vtkColorTransferFunction* color, vtkPiecewiseFunction* opacity, double skinValue, double boneValue)
+{
+    vtkSmartPointer<vtkNamedColors> colors = vtkSmartPointer<vtkNamedColors>::New();
+    vtkColor3d flesh = colors->GetColor3d("flesh");
+    vtkColor3d ivory = colors->GetColor3d("ivory");
+
+    color->RemoveAllPoints();
+    color->AddRGBPoint(skinValue, flesh[0], flesh[1], flesh[2]);
+    color->AddRGBPoint(boneValue, ivory[0], ivory[1], ivory[2]);
+
+    opacity->RemoveAllPoints();
+    opacity->AddPoint(skinValue - 0.1 * (boneValue - skinValue), 0.0);
+    opacity->AddPoint(skinValue, 0.3);
+    opacity->AddPoint(boneValue, 0.6);
+}
+
+const std::vector<std::string>& GetFlowPipelineNames()
+{
+    static const std::vector<std::string> names = { "hedgehog", "glyph", "streamline", "streamglyph", "carotid", "ftle",
+        "volume", "particles" };
+    return names;
+}
+
+std::unique_ptr<FlowPipeline> CreateFlowPipeline(const std::string& mode)
+{
+    if (mode == "hedgehog")
+    {
+        return std::unique_ptr<FlowPipeline>(new HedgeHogPipeline);
+    }
+    if (mode == "glyph")
+    {
+        return std::unique_ptr<FlowPipeline>(new ConeGlyphPipeline);
+    }
+    if (mode == "streamline")
+    {
+        return std::unique_ptr<FlowPipeline>(new StreamlinePipeline);
+    }
+    if (mode == "streamglyph")
+    {
+        return std::unique_ptr<FlowPipeline>(new StreamGlyphPipeline);
+    }
+    if (mode == "carotid")
+    {
+        return std::unique_ptr<FlowPipeline>(new CarotidPipeline);
+    }
+    if (mode == "ftle")
+    {
+        return std::unique_ptr<FlowPipeline>(new FTLEPipeline);
+    }
+    if (mode == "volume")
+    {
+        return std::unique_ptr<FlowPipeline>(new VolumePipeline);
+    }
+    if (mode == "particles")
+    {
+        return std::unique_ptr<FlowPipeline>(new ParticlePipeline);
+    }
+    return nullptr;
+}
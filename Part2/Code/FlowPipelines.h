@@ -0,0 +1,95 @@
+#ifndef FlowPipelines_h
+#define FlowPipelines_h
+
+#include "vtkSmartPointer.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct FlowDataset;
+class vtkColorTransferFunction;
+class vtkPiecewiseFunction;
+class vtkPolyData;
+class vtkProp;
+class vtkRenderer;
+class vtkRenderWindowInteractor;
+class vtkSliderWidget;
+
+// A visualization mode of flowVis (hedgehog, cone glyph, ...). Each pipeline
+// is built once per session and then only has its input reconnected when the
+// user switches datasets, so filters, props and widgets are reused.
+class FlowPipeline
+{
+public:
+    virtual ~FlowPipeline() = default;
+
+    virtual const char* GetName() const = 0;
+
+    // Creates the filters, props and slider widgets.
+    virtual void Build(vtkRenderWindowInteractor* iren) = 0;
+
+    // Points the pipeline at a pooled dataset.
+    virtual void SetDataset(FlowDataset* dataset) = 0;
+
+    // Called by the slider widgets created with AddSlider().
+    virtual void SliderChanged(int slider, double value) = 0;
+
+    virtual void SetupCamera(vtkRenderer* renderer);
+
+    // Keys not used by flowVis itself. Returns true if the key was handled
+    // and the window needs a render.
+    virtual bool KeyPressed(const std::string&) { return false; }
+
+    // Polydata the mode computed, by a short name ("lines", "tubes", ...),
+    // for export. Glyph instance tables are expanded into explicit meshes.
+    virtual void GetGeometry(std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>>&) {}
+
+    virtual void Show(vtkRenderer* renderer);
+    virtual void Hide(vtkRenderer* renderer);
+
+    // Level of detail between 0 (full quality) and 1 (cheapest), set by the
+    // FrameBudgetGovernor while the user interacts.
+    virtual void SetDetailLevel(double) {}
+
+    // Milliseconds spent updating filters outside of rendering (slider and
+    // key callbacks) since the last call.
+    void AddUpdateTime(double ms) { this->UpdateTime += ms; }
+    double TakeUpdateTime();
+
+    bool IsBuilt() const { return this->Built; }
+    FlowDataset* GetDataset() const { return this->Dataset; }
+
+protected:
+    // Creates a horizontal slider in normalized display coordinates and routes
+    // its InteractionEvent to SliderChanged() with the slider's index.
+    vtkSliderWidget* AddSlider(vtkRenderWindowInteractor* iren, const char* title, double minimum,
+        double maximum, double value, double x1, double x2, double y);
+
+    std::vector<vtkSmartPointer<vtkProp>> Props;
+    std::vector<vtkSmartPointer<vtkSliderWidget>> Sliders;
+    FlowDataset* Dataset = nullptr;
+    bool Built = false;
+    double UpdateTime = 0.0;
+};
+
+// Fills polyData with a regular grid of seed points over the dataset bounds,
+// one every `spacing` units. 2D datasets are seeded on their z plane.
+void SetStartingPoints(vtkPolyData* polyData, const FlowDataset& dataset, int spacing);
+
+// Part1.py's volume transfer functions: flesh at the skin value 500 and ivory
+// at the bone value 1150, opacity 0.3 and 0.6 there. Part1 used them in
+// isosurface blend mode; for emission-absorption rendering the opacity also
+// ramps down to 0 just below the skin value so that air stays transparent.
+// Other skin and bone values move the same points.
+void SetupVolumeTransferFunctions(vtkColorTransferFunction* color, vtkPiecewiseFunction* opacity,
+    double skinValue = 500.0, double boneValue = 1150.0);
+
+// Names accepted by CreateFlowPipeline(), in the order of the F1, F2, ... keys.
+const std::vector<std::string>& GetFlowPipelineNames();
+
+// Returns nullptr for an unknown mode name.
+std::unique_ptr<FlowPipeline> CreateFlowPipeline(const std::string& mode);
+
+#endif
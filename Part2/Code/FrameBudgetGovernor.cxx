@@ -0,0 +1,135 @@
+#include "FrameBudgetGovernor.h"
+
+#include "FlowPipelines.h"
+
+#include "vtkCallbackCommand.h"
+#include "vtkCommand.h"
+#include "vtkRenderWindow.h"
+#include "vtkRenderWindowInteractor.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+
+namespace
+{
+
+const double LevelStep = 0.125;
+
+// Frame time relative to the budget above which detail is reduced and below
+// which it is raised again. The gap keeps the level from oscillating.
+const double OverBudget = 1.1;
+const double UnderBudget = 0.6;
+
+} // namespace
+
+FrameBudgetGovernor::~FrameBudgetGovernor()
+{
+    if (this->Interactor && this->Interactor->GetRenderWindow())
+    {
+        this->Interactor->GetRenderWindow()->RemoveObserver(this->StartTag);
+        this->Interactor->GetRenderWindow()->RemoveObserver(this->EndTag);
+    }
+}
+
+void FrameBudgetGovernor::Attach(vtkRenderWindowInteractor* iren)
+{
+    this->Interactor = iren;
+
+    vtkSmartPointer<vtkCallbackCommand> startCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    startCallback->SetCallback(FrameBudgetGovernor::RenderStart);
+    startCallback->SetClientData(this);
+    this->StartTag = iren->GetRenderWindow()->AddObserver(vtkCommand::StartEvent, startCallback);
+
+    vtkSmartPointer<vtkCallbackCommand> endCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    endCallback->SetCallback(FrameBudgetGovernor::RenderEnd);
+    endCallback->SetClientData(this);
+    this->EndTag = iren->GetRenderWindow()->AddObserver(vtkCommand::EndEvent, endCallback);
+}
+
+double FrameBudgetGovernor::GetTargetFrameRate() const
+{
+    if (this->TargetFrameRate > 0.0 || !this->Interactor)
+    {
+        return this->TargetFrameRate;
+    }
+    return this->Interactor->GetDesiredUpdateRate();
+}
+
+double FrameBudgetGovernor::GetLevel() const
+{
+    std::map<FlowPipeline*, State>::const_iterator it = this->States.find(this->Pipeline);
+    return it != this->States.end() ? it->second.Level : 0.0;
+}
+
+void FrameBudgetGovernor::ApplyLevel(State& state, double level)
+{
+    if (level == state.Level)
+    {
+        return;
+    }
+    double start = vtkTimerLog::GetUniversalTime();
+    state.Level = level;
+    state.AverageFrameTime = 0.0;
+    this->Pipeline->SetDetailLevel(level);
+    this->Pipeline->AddUpdateTime((vtkTimerLog::GetUniversalTime() - start) * 1000.0);
+}
+
+void FrameBudgetGovernor::RenderStart(vtkObject* caller, unsigned long, void* clientData, void*)
+{
+    FrameBudgetGovernor* self = static_cast<FrameBudgetGovernor*>(clientData);
+    vtkRenderWindow* window = static_cast<vtkRenderWindow*>(caller);
+    if (!self->Pipeline)
+    {
+        return;
+    }
+
+    State& state = self->States[self->Pipeline];
+    bool interacting = window->GetDesiredUpdateRate() > self->Interactor->GetStillUpdateRate();
+    if (interacting && !self->Interacting)
+    {
+        self->ApplyLevel(state, state.InteractiveLevel);
+    }
+    else if (!interacting && self->Interacting)
+    {
+        // Restore full quality for this very frame.
+        state.InteractiveLevel = state.Level;
+        self->ApplyLevel(state, 0.0);
+    }
+    else if (interacting && state.PendingLevel >= 0.0)
+    {
+        self->ApplyLevel(state, state.PendingLevel);
+    }
+    state.PendingLevel = -1.0;
+    self->Interacting = interacting;
+
+    // Slider work done since the last frame and the level changes above,
+    // e.g. a streamline re-trace, are part of this frame.
+    self->UpdateTime = self->Pipeline->TakeUpdateTime();
+    self->RenderStartTime = vtkTimerLog::GetUniversalTime();
+}
+
+void FrameBudgetGovernor::RenderEnd(vtkObject*, unsigned long, void* clientData, void*)
+{
+    FrameBudgetGovernor* self = static_cast<FrameBudgetGovernor*>(clientData);
+    double fps = self->GetTargetFrameRate();
+    if (!self->Pipeline || !self->Interacting || fps <= 0.0)
+    {
+        return;
+    }
+
+    State& state = self->States[self->Pipeline];
+    double frameTime = (vtkTimerLog::GetUniversalTime() - self->RenderStartTime) * 1000.0 + self->UpdateTime;
+    state.AverageFrameTime =
+        (state.AverageFrameTime > 0.0) ? 0.7 * state.AverageFrameTime + 0.3 * frameTime : frameTime;
+
+    // Applied by the next RenderStart, so that its frame is charged for it.
+    double ratio = state.AverageFrameTime * fps / 1000.0;
+    if (ratio > OverBudget)
+    {
+        state.PendingLevel = std::min(state.Level + LevelStep, 1.0);
+    }
+    else if (ratio < UnderBudget)
+    {
+        state.PendingLevel = std::max(state.Level - LevelStep, 0.0);
+    }
+}
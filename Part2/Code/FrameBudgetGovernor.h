@@ -0,0 +1,72 @@
+#ifndef FrameBudgetGovernor_h
+#define FrameBudgetGovernor_h
+
+#include "vtkSmartPointer.h"
+
+#include <map>
+
+class FlowPipeline;
+class vtkObject;
+class vtkRenderWindowInteractor;
+
+// Holds interactive renders of the current pipeline near a target frame rate.
+//
+// Renders count as interactive while the render window's desired update rate
+// is above the interactor's still update rate, which is how VTK's interactor
+// styles and widgets announce a drag. For those frames the governor times the
+// render plus the pipeline's callback work (FlowPipeline::TakeUpdateTime()),
+// smooths it and moves the pipeline's detail level one step of 1/8 up when
+// the frames are over budget and down when they are well under it. A step is
+// decided when a frame ends and applied when the next one starts, so the work
+// it causes (a streamline re-trace, say) counts toward that frame. The first
+// still render after an interaction runs at level 0, i.e. full quality, and
+// the next interaction resumes from the level the previous one ended at.
+// Levels are kept per pipeline, since their costs differ a lot.
+class FrameBudgetGovernor
+{
+public:
+    FrameBudgetGovernor() = default;
+    ~FrameBudgetGovernor();
+
+    // Observes the render window of `iren`.
+    void Attach(vtkRenderWindowInteractor* iren);
+
+    void SetPipeline(FlowPipeline* pipeline) { this->Pipeline = pipeline; }
+
+    // Interactive frames per second to aim for; 0 uses the interactor's
+    // desired update rate.
+    void SetTargetFrameRate(double fps) { this->TargetFrameRate = fps; }
+    double GetTargetFrameRate() const;
+
+    // Detail level the current pipeline renders at.
+    double GetLevel() const;
+
+private:
+    struct State
+    {
+        double Level = 0.0;
+        double InteractiveLevel = 0.0;
+        double AverageFrameTime = 0.0;
+        // Level to apply at the next interactive frame, or -1.
+        double PendingLevel = -1.0;
+    };
+
+    static void RenderStart(vtkObject*, unsigned long, void* clientData, void*);
+    static void RenderEnd(vtkObject*, unsigned long, void* clientData, void*);
+
+    // Sets the level on the pipeline and books the time it took as update time.
+    void ApplyLevel(State& state, double level);
+
+    vtkSmartPointer<vtkRenderWindowInteractor> Interactor;
+    unsigned long StartTag = 0;
+    unsigned long EndTag = 0;
+
+    FlowPipeline* Pipeline = nullptr;
+    std::map<FlowPipeline*, State> States;
+    double TargetFrameRate = 0.0;
+    double RenderStartTime = 0.0;
+    double UpdateTime = 0.0;
+    bool Interacting = false;
+};
+
+#endif
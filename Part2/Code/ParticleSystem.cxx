@@ -0,0 +1,417 @@
+#include "ParticleSystem.h"
+
+#include "vtkCellArray.h"
+#include "vtkFloatArray.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkTypeInt64Array.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+
+const int L = ParticleSystem::Lanes;
+
+// Slots per compaction task.
+const vtkIdType ChunkSize = 16384;
+
+// Trilinear samples of a batch of positions. Lanes outside the grid have
+// inside[l] cleared and v left at zero. The index arithmetic is written over
+// all lanes at once; the corner fetches go through Storage per lane.
+template <typename Storage>
+void SampleLanes(const FlowField<Storage>& field, const float (&x)[3][L], float (&v)[3][L], bool (&inside)[L])
+{
+    const int* dims = field.GetDimensions();
+    const double* origin = field.GetOrigin();
+    const double* spacing = field.GetSpacing();
+
+    int i0[3][L];
+    int step[3];
+    float f[3][L];
+    for (int c = 0; c < 3; ++c)
+    {
+        if (dims[c] < 2)
+        {
+            // Flat axis: not interpolated, any coordinate is inside.
+            step[c] = 0;
+            for (int l = 0; l < L; ++l)
+            {
+                i0[c][l] = 0;
+                f[c][l] = 0.0f;
+            }
+            continue;
+        }
+        step[c] = 1;
+        const float o = static_cast<float>(origin[c]);
+        const float scale = static_cast<float>(1.0 / spacing[c]);
+        const float last = static_cast<float>(dims[c] - 1);
+        for (int l = 0; l < L; ++l)
+        {
+            float t = (x[c][l] - o) * scale;
+            inside[l] = inside[l] && t >= 0.0f && t <= last;
+            t = std::min(std::max(t, 0.0f), last);
+            i0[c][l] = std::min(static_cast<int>(t), dims[c] - 2);
+            f[c][l] = t - static_cast<float>(i0[c][l]);
+        }
+    }
+
+    const Storage& data = field.GetStorage();
+    for (int l = 0; l < L; ++l)
+    {
+        v[0][l] = v[1][l] = v[2][l] = 0.0f;
+        if (!inside[l])
+        {
+            continue;
+        }
+        float corner[3];
+        for (int n = 0; n < 8; ++n)
+        {
+            const float w = ((n & 1) ? f[0][l] : 1.0f - f[0][l]) * ((n & 2) ? f[1][l] : 1.0f - f[1][l]) *
+                ((n & 4) ? f[2][l] : 1.0f - f[2][l]);
+            if (w == 0.0f)
+            {
+                continue;
+            }
+            data.Fetch(i0[0][l] + ((n & 1) ? step[0] : 0), i0[1][l] + ((n & 2) ? step[1] : 0),
+                i0[2][l] + ((n & 4) ? step[2] : 0), corner);
+            for (int c = 0; c < 3; ++c)
+            {
+                v[c][l] += w * corner[c];
+            }
+        }
+    }
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem()
+{
+    this->PointArray = vtkSmartPointer<vtkFloatArray>::New();
+    this->PointArray->SetNumberOfComponents(3);
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(this->PointArray);
+
+    this->SpeedArray = vtkSmartPointer<vtkFloatArray>::New();
+    this->SpeedArray->SetName("Speed");
+
+    // 64-bit arrays are adopted by vtkCellArray as they are, so the verts
+    // keep pointing at OutOffsets and OutConnectivity.
+    this->OffsetArray = vtkSmartPointer<vtkTypeInt64Array>::New();
+    this->ConnectivityArray = vtkSmartPointer<vtkTypeInt64Array>::New();
+    vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+    verts->SetData(this->OffsetArray, this->ConnectivityArray);
+
+    this->Output = vtkSmartPointer<vtkPolyData>::New();
+    this->Output->SetPoints(points);
+    this->Output->SetVerts(verts);
+    this->Output->GetPointData()->SetScalars(this->SpeedArray);
+
+    this->SetCapacity(0);
+}
+
+void ParticleSystem::SetCapacity(vtkIdType capacity)
+{
+    capacity = std::max<vtkIdType>(capacity, 0);
+    this->X.assign(capacity, 0.0f);
+    this->Y.assign(capacity, 0.0f);
+    this->Z.assign(capacity, 0.0f);
+    this->Age.assign(capacity, 0.0f);
+    this->Speed.assign(capacity, 0.0f);
+    this->Alive.assign(capacity, 0);
+    this->FreeList.resize(capacity);
+    this->ChunkCounts.resize((capacity + ChunkSize - 1) / ChunkSize);
+
+    this->OutPoints.resize(3 * capacity);
+    this->OutSpeed.resize(capacity);
+    // Vertex i is point i, so offsets and connectivity never change.
+    this->OutOffsets.resize(capacity + 1);
+    this->OutConnectivity.resize(capacity);
+    std::iota(this->OutOffsets.begin(), this->OutOffsets.end(), vtkTypeInt64(0));
+    std::iota(this->OutConnectivity.begin(), this->OutConnectivity.end(), vtkTypeInt64(0));
+
+    this->Reset();
+}
+
+bool ParticleSystem::SetField(vtkImageData* image)
+{
+    // Only the field of the current precision and layout holds data.
+    this->Field = FlowField<>();
+    this->BrickedField = FlowField<BrickedFloatStorage<>>();
+    this->HalfField = FlowField<HalfFloatStorage>();
+    this->Int16Field = FlowField<BlockQuantizedStorage<std::int16_t>>();
+    this->Int8Field = FlowField<BlockQuantizedStorage<std::int8_t>>();
+    bool assigned = false;
+    this->WithField([&](auto& field) { assigned = field.Assign(image); });
+    return assigned;
+}
+
+std::size_t ParticleSystem::GetFieldMemorySize()
+{
+    std::size_t size = 0;
+    this->WithField([&](const auto& field) { size = field.GetStorage().GetMemorySize(); });
+    return size;
+}
+
+void ParticleSystem::AddSeedRegion(const double bounds[6])
+{
+    this->SeedRegions.emplace_back(bounds, bounds + 6);
+}
+
+void ParticleSystem::Reset()
+{
+    std::fill(this->Alive.begin(), this->Alive.end(), 0);
+    std::iota(this->FreeList.begin(), this->FreeList.end(), vtkIdType(0));
+    this->NumberOfFree = this->GetCapacity();
+    this->NumberOfParticles = 0;
+    this->UpdateOutput();
+}
+
+void ParticleSystem::Step()
+{
+    this->Inject();
+    this->Advect();
+    this->Compact();
+    this->UpdateOutput();
+}
+
+double ParticleSystem::Random()
+{
+    // xorshift64*
+    std::uint64_t& s = this->RandomState;
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    return static_cast<double>((s * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void ParticleSystem::Inject()
+{
+    if (this->SeedRegions.empty())
+    {
+        return;
+    }
+    int dims[3];
+    double origin[3];
+    this->WithField([&](const auto& field) {
+        std::copy(field.GetDimensions(), field.GetDimensions() + 3, dims);
+        std::copy(field.GetOrigin(), field.GetOrigin() + 3, origin);
+    });
+    const vtkIdType count = std::min(this->EmissionRate, this->NumberOfFree);
+    const std::size_t numRegions = this->SeedRegions.size();
+    float* coordinates[3] = { this->X.data(), this->Y.data(), this->Z.data() };
+    for (vtkIdType n = 0; n < count; ++n)
+    {
+        const std::vector<double>& bounds = this->SeedRegions[n % numRegions];
+        const vtkIdType slot = this->FreeList[--this->NumberOfFree];
+        for (int c = 0; c < 3; ++c)
+        {
+            double x = origin[c];
+            if (dims[c] > 1)
+            {
+                x = bounds[2 * c] + this->Random() * (bounds[2 * c + 1] - bounds[2 * c]);
+            }
+            coordinates[c][slot] = static_cast<float>(x);
+        }
+        this->Age[slot] = 0.0f;
+        this->Alive[slot] = 1;
+    }
+}
+
+void ParticleSystem::Advect()
+{
+    this->WithField([this](const auto& field) { this->Advect(field); });
+}
+
+template <typename Storage>
+void ParticleSystem::Advect(const FlowField<Storage>& field)
+{
+    const vtkIdType capacity = this->GetCapacity();
+    const vtkIdType numBatches = (capacity + L - 1) / L;
+    const float h = static_cast<float>(this->TimeStep);
+    const float maxAge = static_cast<float>(this->MaxAge);
+    const float minSpeed = static_cast<float>(this->MinimumSpeed);
+    const int* dims = field.GetDimensions();
+    const double* origin = field.GetOrigin();
+    const double* spacing = field.GetSpacing();
+
+    vtkSMPTools::For(0, numBatches, [&](vtkIdType begin, vtkIdType end) {
+        float p[3][L];
+        float y[3][L];
+        float v[3][L];
+        float sum[3][L];
+        float speed[L];
+        bool ok[L];
+        for (vtkIdType batch = begin; batch < end; ++batch)
+        {
+            const vtkIdType first = batch * L;
+            const int count = static_cast<int>(std::min<vtkIdType>(L, capacity - first));
+            bool any = false;
+            for (int l = 0; l < L; ++l)
+            {
+                ok[l] = l < count && this->Alive[first + l] != 0;
+                any = any || ok[l];
+            }
+            if (!any)
+            {
+                continue;
+            }
+            for (int l = 0; l < count; ++l)
+            {
+                p[0][l] = this->X[first + l];
+                p[1][l] = this->Y[first + l];
+                p[2][l] = this->Z[first + l];
+            }
+            for (int l = count; l < L; ++l)
+            {
+                p[0][l] = p[1][l] = p[2][l] = 0.0f;
+            }
+
+            // RK4: k1 + 2 k2 + 2 k3 + k4 is accumulated in sum.
+            SampleLanes(field, p, v, ok);
+            for (int l = 0; l < L; ++l)
+            {
+                speed[l] = std::sqrt(v[0][l] * v[0][l] + v[1][l] * v[1][l] + v[2][l] * v[2][l]);
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int l = 0; l < L; ++l)
+                {
+                    sum[c][l] = v[c][l];
+                    y[c][l] = p[c][l] + 0.5f * h * v[c][l];
+                }
+            }
+            SampleLanes(field, y, v, ok);
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int l = 0; l < L; ++l)
+                {
+                    sum[c][l] += 2.0f * v[c][l];
+                    y[c][l] = p[c][l] + 0.5f * h * v[c][l];
+                }
+            }
+            SampleLanes(field, y, v, ok);
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int l = 0; l < L; ++l)
+                {
+                    sum[c][l] += 2.0f * v[c][l];
+                    y[c][l] = p[c][l] + h * v[c][l];
+                }
+            }
+            SampleLanes(field, y, v, ok);
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int l = 0; l < L; ++l)
+                {
+                    y[c][l] = p[c][l] + h / 6.0f * (sum[c][l] + v[c][l]);
+                }
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                if (dims[c] < 2)
+                {
+                    continue;
+                }
+                const float lo = static_cast<float>(std::min(origin[c], origin[c] + (dims[c] - 1) * spacing[c]));
+                const float hi = static_cast<float>(std::max(origin[c], origin[c] + (dims[c] - 1) * spacing[c]));
+                for (int l = 0; l < L; ++l)
+                {
+                    ok[l] = ok[l] && y[c][l] >= lo && y[c][l] <= hi;
+                }
+            }
+
+            for (int l = 0; l < count; ++l)
+            {
+                const vtkIdType id = first + l;
+                if (!this->Alive[id])
+                {
+                    continue;
+                }
+                const float age = this->Age[id] + h;
+                if (!ok[l] || age > maxAge || speed[l] < minSpeed)
+                {
+                    this->Alive[id] = 0;
+                    continue;
+                }
+                this->X[id] = y[0][l];
+                this->Y[id] = y[1][l];
+                this->Z[id] = y[2][l];
+                this->Age[id] = age;
+                this->Speed[id] = speed[l];
+            }
+        }
+    });
+}
+
+void ParticleSystem::Compact()
+{
+    const vtkIdType capacity = this->GetCapacity();
+    const vtkIdType numChunks = static_cast<vtkIdType>(this->ChunkCounts.size());
+
+    vtkSMPTools::For(0, numChunks, 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType chunk = begin; chunk < end; ++chunk)
+        {
+            const vtkIdType last = std::min(capacity, (chunk + 1) * ChunkSize);
+            vtkIdType alive = 0;
+            for (vtkIdType id = chunk * ChunkSize; id < last; ++id)
+            {
+                alive += this->Alive[id];
+            }
+            this->ChunkCounts[chunk] = alive;
+        }
+    });
+
+    vtkIdType total = 0;
+    for (vtkIdType& count : this->ChunkCounts)
+    {
+        vtkIdType alive = count;
+        count = total;
+        total += alive;
+    }
+
+    // Live slots are packed in slot order, dead slots become the free list.
+    vtkSMPTools::For(0, numChunks, 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType chunk = begin; chunk < end; ++chunk)
+        {
+            const vtkIdType first = chunk * ChunkSize;
+            const vtkIdType last = std::min(capacity, first + ChunkSize);
+            vtkIdType out = this->ChunkCounts[chunk];
+            vtkIdType dead = first - out;
+            for (vtkIdType id = first; id < last; ++id)
+            {
+                if (!this->Alive[id])
+                {
+                    this->FreeList[dead++] = id;
+                    continue;
+                }
+                this->OutPoints[3 * out] = this->X[id];
+                this->OutPoints[3 * out + 1] = this->Y[id];
+                this->OutPoints[3 * out + 2] = this->Z[id];
+                this->OutSpeed[out] = this->Speed[id];
+                ++out;
+            }
+        }
+    });
+
+    this->NumberOfParticles = total;
+    this->NumberOfFree = capacity - total;
+}
+
+void ParticleSystem::UpdateOutput()
+{
+    // The arrays wrap the first NumberOfParticles entries of the buffers
+    // without taking ownership.
+    const vtkIdType n = this->NumberOfParticles;
+    this->PointArray->SetArray(this->OutPoints.data(), 3 * n, 1);
+    this->SpeedArray->SetArray(this->OutSpeed.data(), n, 1);
+    this->OffsetArray->SetArray(this->OutOffsets.data(), n + 1, 1);
+    this->ConnectivityArray->SetArray(this->OutConnectivity.data(), n, 1);
+    this->Output->GetPoints()->Modified();
+    this->Output->GetVerts()->Modified();
+    this->Output->Modified();
+}
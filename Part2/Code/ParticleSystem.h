@@ -0,0 +1,171 @@
+#ifndef ParticleSystem_h
+#define ParticleSystem_h
+
+#include "FlowField.h"
+
+#include "vtkSmartPointer.h"
+
+#include <cstdint>
+#include <vector>
+
+class vtkFloatArray;
+class vtkPolyData;
+class vtkTypeInt64Array;
+
+// Particles injected continuously into a steady vector field and advected
+// with RK4, for animation.
+//
+// Particle state is kept as structure of arrays (X, Y, Z, Age, Speed, Alive)
+// sized once by SetCapacity(). Step() runs in three phases:
+//  - Inject: up to EmissionRate particles are placed at random in the seed
+//    regions, taking slots from a free list;
+//  - Advect: the particles are processed in parallel in batches of Lanes, one
+//    RK4 step of TimeStep each. The arithmetic runs lane by lane over small
+//    fixed-size arrays so the compiler can vectorize it; only the corner
+//    fetches of the trilinear interpolation are per particle. Particles that
+//    leave the grid, stall below MinimumSpeed or exceed MaxAge are retired;
+//  - Compact: in parallel over fixed chunks, the live particles are packed
+//    into the output buffers and the free list is rebuilt from the dead
+//    slots.
+// No phase allocates. The output polydata wraps the packed buffers directly
+// (points, "Speed" scalars and one vertex per particle), so a frame only
+// changes array lengths and modification times.
+class ParticleSystem
+{
+public:
+    static const int Lanes = 8;
+
+    ParticleSystem();
+
+    // Allocates every buffer and retires all particles.
+    void SetCapacity(vtkIdType capacity);
+    vtkIdType GetCapacity() const { return static_cast<vtkIdType>(this->Alive.size()); }
+
+    // Copies the geometry and active vectors of `image` at the current
+    // precision; false without vectors.
+    bool SetField(vtkImageData* image);
+    const FlowField<>& GetField() const { return this->Field; }
+
+    // Precision of the copy SetField() makes. Reduced precision cuts the
+    // memory traffic of Advect(), which is bound by the corner fetches on
+    // large grids. Takes effect at the next SetField().
+    void SetPrecision(VectorPrecision precision) { this->Precision = precision; }
+    VectorPrecision GetPrecision() const { return this->Precision; }
+
+    // Layout of a float32 copy: the bricked one keeps the corners of a cell
+    // close in memory when particles move along y or z. Other precisions are
+    // always linear. Takes effect at the next SetField().
+    void SetLayout(FieldLayout layout) { this->Layout = layout; }
+    FieldLayout GetLayout() const { return this->Layout; }
+
+    std::size_t GetFieldMemorySize();
+
+    // Particles are seeded uniformly in axis-aligned boxes. Flat axes of the
+    // field are seeded on the grid plane.
+    void ClearSeedRegions() { this->SeedRegions.clear(); }
+    void AddSeedRegion(const double bounds[6]);
+
+    void SetEmissionRate(vtkIdType particlesPerStep) { this->EmissionRate = particlesPerStep; }
+    vtkIdType GetEmissionRate() const { return this->EmissionRate; }
+
+    void SetTimeStep(double timeStep) { this->TimeStep = timeStep; }
+    double GetTimeStep() const { return this->TimeStep; }
+
+    void SetMaxAge(double maxAge) { this->MaxAge = maxAge; }
+    double GetMaxAge() const { return this->MaxAge; }
+
+    void SetMinimumSpeed(double speed) { this->MinimumSpeed = speed; }
+
+    // Retires every particle.
+    void Reset();
+
+    // One frame: inject, advect, retire, and refresh the output.
+    void Step();
+
+    vtkIdType GetNumberOfParticles() const { return this->NumberOfParticles; }
+
+    vtkPolyData* GetOutput() const { return this->Output; }
+
+private:
+    // Calls f with the field of the current precision.
+    template <typename F>
+    void WithField(F&& f)
+    {
+        switch (this->Precision)
+        {
+            case VectorPrecision::Float16:
+                f(this->HalfField);
+                break;
+            case VectorPrecision::Int16:
+                f(this->Int16Field);
+                break;
+            case VectorPrecision::Int8:
+                f(this->Int8Field);
+                break;
+            default:
+                if (this->Layout == FieldLayout::Bricked)
+                {
+                    f(this->BrickedField);
+                }
+                else
+                {
+                    f(this->Field);
+                }
+                break;
+        }
+    }
+
+    void Inject();
+    void Advect();
+    template <typename Storage>
+    void Advect(const FlowField<Storage>& field);
+    void Compact();
+    void UpdateOutput();
+
+    // Uniform in [0, 1).
+    double Random();
+
+    VectorPrecision Precision = VectorPrecision::Float32;
+    FieldLayout Layout = FieldLayout::Linear;
+    FlowField<> Field;
+    FlowField<BrickedFloatStorage<>> BrickedField;
+    FlowField<HalfFloatStorage> HalfField;
+    FlowField<BlockQuantizedStorage<std::int16_t>> Int16Field;
+    FlowField<BlockQuantizedStorage<std::int8_t>> Int8Field;
+    std::vector<std::vector<double>> SeedRegions;
+    vtkIdType EmissionRate = 10000;
+    double TimeStep = 0.1;
+    double MaxAge = 50.0;
+    double MinimumSpeed = 1e-6;
+    std::uint64_t RandomState = 0x9E3779B97F4A7C15ull;
+
+    // Particle state, one entry per slot.
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<float> Z;
+    std::vector<float> Age;
+    std::vector<float> Speed;
+    std::vector<unsigned char> Alive;
+
+    // FreeList[0 .. NumberOfFree) are dead slots.
+    std::vector<vtkIdType> FreeList;
+    vtkIdType NumberOfFree = 0;
+
+    // Live particles per compaction chunk, then their first output index.
+    std::vector<vtkIdType> ChunkCounts;
+
+    // Packed output, wrapped by the arrays of Output.
+    std::vector<float> OutPoints;
+    std::vector<float> OutSpeed;
+    std::vector<vtkTypeInt64> OutOffsets;
+    std::vector<vtkTypeInt64> OutConnectivity;
+    vtkIdType NumberOfParticles = 0;
+
+    vtkSmartPointer<vtkPolyData> Output;
+    vtkSmartPointer<vtkFloatArray> PointArray;
+    vtkSmartPointer<vtkFloatArray> SpeedArray;
+    vtkSmartPointer<vtkTypeInt64Array> OffsetArray;
+    vtkSmartPointer<vtkTypeInt64Array> ConnectivityArray;
+};
+
+#endif
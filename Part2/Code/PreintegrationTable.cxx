@@ -0,0 +1,120 @@
+#include "PreintegrationTable.h"
+
+#include "vtkColorTransferFunction.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+vtkIdType PreintegrationTable::Update(vtkColorTransferFunction* color, vtkPiecewiseFunction* opacity,
+    const double range[2], double segmentLength, double unitDistance, int numberOfBins)
+{
+    numberOfBins = std::max(numberOfBins, 2);
+    double width = (range[1] > range[0]) ? (range[1] - range[0]) / numberOfBins : 1.0;
+
+    // Classify the bin centers.
+    std::vector<float> colors(3 * numberOfBins);
+    std::vector<float> alphas(numberOfBins);
+    color->GetTable(range[0] + width / 2, range[0] + width * (numberOfBins - 0.5), numberOfBins, colors.data());
+    opacity->GetTable(range[0] + width / 2, range[0] + width * (numberOfBins - 0.5), numberOfBins, alphas.data());
+
+    std::vector<float> extinction(numberOfBins);
+    for (int i = 0; i < numberOfBins; ++i)
+    {
+        double alpha = std::min(std::max(static_cast<double>(alphas[i]), 0.0), 0.9999);
+        extinction[i] = static_cast<float>(-std::log(1.0 - alpha) / unitDistance);
+    }
+
+    // Anything that changes every entry forces a full rebuild; otherwise only
+    // the bins whose classification changed are dirty.
+    int firstDirty = 0;
+    int lastDirty = numberOfBins - 1;
+    if (numberOfBins == this->NumberOfBins && range[0] == this->Range[0] && range[1] == this->Range[1] &&
+        segmentLength == this->SegmentLength && unitDistance == this->UnitDistance)
+    {
+        firstDirty = numberOfBins;
+        lastDirty = -1;
+        for (int i = 0; i < numberOfBins; ++i)
+        {
+            if (extinction[i] != this->BinExtinction[i] || colors[3 * i] != this->BinColors[3 * i] ||
+                colors[3 * i + 1] != this->BinColors[3 * i + 1] || colors[3 * i + 2] != this->BinColors[3 * i + 2])
+            {
+                firstDirty = std::min(firstDirty, i);
+                lastDirty = i;
+            }
+        }
+        if (lastDirty < 0)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        this->NumberOfBins = numberOfBins;
+        this->Range[0] = range[0];
+        this->Range[1] = range[1];
+        this->BinScale = 1.0 / width;
+        this->SegmentLength = segmentLength;
+        this->UnitDistance = unitDistance;
+        this->Table.assign(4 * static_cast<std::size_t>(numberOfBins) * numberOfBins, 0.0f);
+    }
+    this->BinColors = std::move(colors);
+    this->BinExtinction = std::move(extinction);
+
+    // Entry (f, b) integrates over bins min(f, b) .. max(f, b).
+    std::vector<vtkIdType> rowCounts(numberOfBins, 0);
+    vtkSMPTools::For(0, numberOfBins, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType front = begin; front < end; ++front)
+        {
+            for (int back = 0; back < numberOfBins; ++back)
+            {
+                if (std::min<int>(front, back) <= lastDirty && std::max<int>(front, back) >= firstDirty)
+                {
+                    this->IntegrateSegment(static_cast<int>(front), back,
+                        &this->Table[4 * (static_cast<std::size_t>(front) * numberOfBins + back)]);
+                    ++rowCounts[front];
+                }
+            }
+        }
+    });
+
+    vtkIdType count = 0;
+    for (vtkIdType rowCount : rowCounts)
+    {
+        count += rowCount;
+    }
+    return count;
+}
+
+void PreintegrationTable::IntegrateSegment(int front, int back, float rgba[4]) const
+{
+    const int numSteps = std::abs(back - front) + 1;
+    const double length = this->SegmentLength / numSteps;
+
+    double color[3] = { 0.0, 0.0, 0.0 };
+    double alpha = 0.0;
+    for (int k = 0; k < numSteps && alpha < 0.999; ++k)
+    {
+        // Bin position of the sub-step midpoint, interpolated between bins.
+        double s = front + (back - front) * (k + 0.5) / numSteps;
+        int i0 = static_cast<int>(s);
+        int i1 = std::min(i0 + 1, this->NumberOfBins - 1);
+        double w = s - i0;
+
+        double tau = (1.0 - w) * this->BinExtinction[i0] + w * this->BinExtinction[i1];
+        double a = 1.0 - std::exp(-tau * length);
+        double weight = (1.0 - alpha) * a;
+        for (int c = 0; c < 3; ++c)
+        {
+            color[c] += weight * ((1.0 - w) * this->BinColors[3 * i0 + c] + w * this->BinColors[3 * i1 + c]);
+        }
+        alpha += weight;
+    }
+
+    rgba[0] = static_cast<float>(color[0]);
+    rgba[1] = static_cast<float>(color[1]);
+    rgba[2] = static_cast<float>(color[2]);
+    rgba[3] = static_cast<float>(alpha);
+}
@@ -0,0 +1,62 @@
+#ifndef PreintegrationTable_h
+#define PreintegrationTable_h
+
+#include "vtkType.h"
+
+#include <vector>
+
+class vtkColorTransferFunction;
+class vtkPiecewiseFunction;
+
+// Preintegrated transfer function for emission-absorption ray casting.
+//
+// Entry (f, b) is the premultiplied RGBA of one ray segment of length
+// SegmentLength along which the scalar goes linearly from bin f (front
+// sample) to bin b (back sample). The segment is integrated in sub-steps that
+// cross at most one bin each, so thin features of the transfer function
+// between two samples are not skipped. The diagonal (f, f) is ordinary
+// post-classification with opacity correction for the segment length.
+//
+// Update() rebuilds the rows in parallel. When only some bins changed since
+// the last call (e.g. one opacity point moved), only entries whose scalar
+// interval covers a changed bin are recomputed.
+class PreintegrationTable
+{
+public:
+    // Samples the functions at the centers of `numberOfBins` bins over
+    // `range`. Opacities are per `unitDistance` world units, as in
+    // vtkVolumeProperty. Returns the number of recomputed entries.
+    vtkIdType Update(vtkColorTransferFunction* color, vtkPiecewiseFunction* opacity, const double range[2],
+        double segmentLength, double unitDistance = 1.0, int numberOfBins = 256);
+
+    int GetNumberOfBins() const { return this->NumberOfBins; }
+    double GetSegmentLength() const { return this->SegmentLength; }
+
+    // Bin of scalar s, clamped to the table.
+    int GetBin(double s) const
+    {
+        int bin = static_cast<int>((s - this->Range[0]) * this->BinScale);
+        return bin < 0 ? 0 : (bin >= this->NumberOfBins ? this->NumberOfBins - 1 : bin);
+    }
+
+    const float* GetEntry(int front, int back) const
+    {
+        return &this->Table[4 * (static_cast<std::size_t>(front) * this->NumberOfBins + back)];
+    }
+
+private:
+    void IntegrateSegment(int front, int back, float rgba[4]) const;
+
+    int NumberOfBins = 0;
+    double Range[2] = { 0.0, 1.0 };
+    double BinScale = 0.0;
+    double SegmentLength = 0.0;
+    double UnitDistance = 0.0;
+
+    // Per bin: color and extinction coefficient (per world unit).
+    std::vector<float> BinColors;
+    std::vector<float> BinExtinction;
+    std::vector<float> Table;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef ReplicatedPointData_h
+#define ReplicatedPointData_h
+
+#include "vtkAbstractArray.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+
+#include <utility>
+#include <vector>
+
+// Output point data for generators that emit a fixed number of output points
+// per input point (glyphs, hedgehog lines). The output arrays are allocated
+// once with their final size, after which Copy() may be called concurrently
+// for disjoint output ranges: it only writes tuples and never resizes.
+class ReplicatedPointData
+{
+public:
+    // Creates one output array per input array except `skip`, sized for
+    // numberOfOutputPoints tuples, and carries over the active attributes.
+    void Allocate(vtkPointData* input, vtkPointData* output, vtkIdType numberOfOutputPoints,
+        vtkAbstractArray* skip = nullptr)
+    {
+        this->Arrays.clear();
+        for (int i = 0; i < input->GetNumberOfArrays(); ++i)
+        {
+            vtkAbstractArray* inArray = input->GetAbstractArray(i);
+            if (!inArray || inArray == skip)
+            {
+                continue;
+            }
+
+            vtkSmartPointer<vtkAbstractArray> outArray;
+            outArray.TakeReference(inArray->NewInstance());
+            outArray->SetName(inArray->GetName());
+            outArray->SetNumberOfComponents(inArray->GetNumberOfComponents());
+            outArray->SetNumberOfTuples(numberOfOutputPoints);
+
+            int attribute = input->IsArrayAnAttribute(i);
+            if (attribute >= 0)
+            {
+                output->SetAttribute(outArray, attribute);
+            }
+            else
+            {
+                output->AddArray(outArray);
+            }
+            this->Arrays.emplace_back(inArray, outArray.GetPointer());
+        }
+    }
+
+    // Copies input tuple inputId to output tuples [outputBegin, outputBegin + count).
+    void Copy(vtkIdType inputId, vtkIdType outputBegin, vtkIdType count) const
+    {
+        for (const auto& arrays : this->Arrays)
+        {
+            for (vtkIdType j = 0; j < count; ++j)
+            {
+                arrays.second->SetTuple(outputBegin + j, inputId, arrays.first);
+            }
+        }
+    }
+
+private:
+    std::vector<std::pair<vtkAbstractArray*, vtkAbstractArray*>> Arrays;
+};
+
+#endif
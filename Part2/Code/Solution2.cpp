@@ -184,17 +184,6 @@ int main(int argc, char** argv) {
         renWin->SetWindowName("Glyph-Based Volume Renderer with Sliders");
         renWin->Render();
         iren->Start();
-
-        // Clean up
-        reader->Delete();
-        coneSource->Delete();
-        glyph->Delete();
-        lut->Delete();
-        mapper->Delete();
-        actor->Delete();
-        iren->Delete();
-        renWin->Delete();
-        aRenderer->Delete();
     }
 
     return 0;
@@ -89,7 +89,7 @@ int main(int argc, char** argv) {
     const char* datasetNames[] = {
         "testData2",
     };
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < 1; ++i) {
         vtkSmartPointer<vtkRenderer> aRenderer = vtkSmartPointer<vtkRenderer>::New();
         vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
         renWin->AddRenderer(aRenderer);
@@ -156,16 +156,6 @@ int main(int argc, char** argv) {
         renWin->SetWindowName("Streamline and Glyph Visualization with Sliders");
         renWin->Render();
         iren->Start();
-
-        // Clean up
-        reader->Delete();
-        pointSet->Delete();
-        streamTracer->Delete();
-        streamMapper->Delete();
-        streamActor->Delete();
-        iren->Delete();
-        renWin->Delete();
-        aRenderer->Delete();
     }
 
     return 0;
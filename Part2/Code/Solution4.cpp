@@ -153,7 +153,8 @@ int main(int argc, char** argv) {
         pointSet->Delete();
         streamTracer->Delete();
         glyph->Delete();
-        arrowSource->Delete();
+        streamMapper->Delete();
+        streamActor->Delete();
         glyphMapper->Delete();
         glyphActor->Delete();
         iren->Delete();
@@ -0,0 +1,321 @@
+#include "VolumeHistogram.h"
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Geometry and binning shared by both passes. Tasks are point rows along x.
+template <typename T>
+struct VolumeAccess
+{
+    const T* Data;
+    int Components;
+    int Dims[3];
+    double InverseSpacing[3];
+    double ValueLow;
+    double ValueScale;
+    int ValueBins;
+
+    double Get(vtkIdType id) const { return static_cast<double>(this->Data[id * this->Components]); }
+
+    int GetValueBin(double value) const
+    {
+        int bin = static_cast<int>((value - this->ValueLow) * this->ValueScale);
+        return std::min(std::max(bin, 0), this->ValueBins - 1);
+    }
+
+    // Derivative along an axis at index i of a row through `id` with point
+    // stride `step`: central inside, one-sided at the ends, 0 on flat axes.
+    double Derivative(vtkIdType id, int i, int axis, vtkIdType step) const
+    {
+        const int n = this->Dims[axis];
+        if (n < 2)
+        {
+            return 0.0;
+        }
+        if (i == 0)
+        {
+            return (this->Get(id + step) - this->Get(id)) * this->InverseSpacing[axis];
+        }
+        if (i == n - 1)
+        {
+            return (this->Get(id) - this->Get(id - step)) * this->InverseSpacing[axis];
+        }
+        return (this->Get(id + step) - this->Get(id - step)) * 0.5 * this->InverseSpacing[axis];
+    }
+};
+
+// Pass 1: value histogram and gradient magnitudes.
+template <typename T>
+struct GradientPass
+{
+    VolumeAccess<T> Volume;
+    float* Gradient;
+    vtkSMPThreadLocal<std::vector<vtkIdType>> LocalBins;
+    vtkSMPThreadLocal<double> LocalMax;
+
+    std::vector<vtkIdType> Histogram;
+    double MaxGradient = 0.0;
+
+    void Initialize()
+    {
+        this->LocalBins.Local().assign(this->Volume.ValueBins, 0);
+        this->LocalMax.Local() = 0.0;
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        const VolumeAccess<T>& v = this->Volume;
+        const vtkIdType sy = v.Dims[0];
+        const vtkIdType sz = static_cast<vtkIdType>(v.Dims[0]) * v.Dims[1];
+        std::vector<vtkIdType>& bins = this->LocalBins.Local();
+        double& maxGradient = this->LocalMax.Local();
+        for (vtkIdType row = begin; row < end; ++row)
+        {
+            const int j = static_cast<int>(row % v.Dims[1]);
+            const int k = static_cast<int>(row / v.Dims[1]);
+            const vtkIdType first = row * sy;
+            for (int i = 0; i < v.Dims[0]; ++i)
+            {
+                const vtkIdType id = first + i;
+                ++bins[v.GetValueBin(v.Get(id))];
+                const double gx = v.Derivative(id, i, 0, 1);
+                const double gy = v.Derivative(id, j, 1, sy);
+                const double gz = v.Derivative(id, k, 2, sz);
+                const double magnitude = std::sqrt(gx * gx + gy * gy + gz * gz);
+                this->Gradient[id] = static_cast<float>(magnitude);
+                maxGradient = std::max(maxGradient, magnitude);
+            }
+        }
+    }
+
+    void Reduce()
+    {
+        this->Histogram.assign(this->Volume.ValueBins, 0);
+        for (const std::vector<vtkIdType>& bins : this->LocalBins)
+        {
+            for (int b = 0; b < this->Volume.ValueBins; ++b)
+            {
+                this->Histogram[b] += bins[b];
+            }
+        }
+        for (double maxGradient : this->LocalMax)
+        {
+            this->MaxGradient = std::max(this->MaxGradient, maxGradient);
+        }
+    }
+};
+
+// Pass 2: joint value x gradient magnitude histogram.
+template <typename T>
+struct JointPass
+{
+    VolumeAccess<T> Volume;
+    const float* Gradient;
+    double GradientScale;
+    int GradientBins;
+    vtkSMPThreadLocal<std::vector<vtkIdType>> LocalBins;
+
+    std::vector<vtkIdType> Histogram;
+
+    void Initialize()
+    {
+        this->LocalBins.Local().assign(static_cast<std::size_t>(this->Volume.ValueBins) * this->GradientBins, 0);
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        const VolumeAccess<T>& v = this->Volume;
+        std::vector<vtkIdType>& bins = this->LocalBins.Local();
+        for (vtkIdType id = begin; id < end; ++id)
+        {
+            int g = static_cast<int>(this->Gradient[id] * this->GradientScale);
+            g = std::min(g, this->GradientBins - 1);
+            ++bins[v.GetValueBin(v.Get(id)) + static_cast<std::size_t>(g) * v.ValueBins];
+        }
+    }
+
+    void Reduce()
+    {
+        this->Histogram.assign(static_cast<std::size_t>(this->Volume.ValueBins) * this->GradientBins, 0);
+        for (const std::vector<vtkIdType>& bins : this->LocalBins)
+        {
+            for (std::size_t b = 0; b < bins.size(); ++b)
+            {
+                this->Histogram[b] += bins[b];
+            }
+        }
+    }
+};
+
+template <typename T>
+void ComputeHistograms(const T* data, int components, vtkImageData* image, const double range[2], int valueBins,
+    int gradientBins, std::vector<vtkIdType>& valueHistogram, std::vector<vtkIdType>& jointHistogram,
+    std::vector<float>& gradient, double& maxGradient)
+{
+    VolumeAccess<T> volume;
+    volume.Data = data;
+    volume.Components = components;
+    image->GetDimensions(volume.Dims);
+    const double* spacing = image->GetSpacing();
+    for (int c = 0; c < 3; ++c)
+    {
+        volume.InverseSpacing[c] = 1.0 / spacing[c];
+    }
+    volume.ValueLow = range[0];
+    volume.ValueScale = (range[1] > range[0]) ? valueBins / (range[1] - range[0]) : 0.0;
+    volume.ValueBins = valueBins;
+
+    const vtkIdType numRows = static_cast<vtkIdType>(volume.Dims[1]) * volume.Dims[2];
+    const vtkIdType numPoints = numRows * volume.Dims[0];
+    gradient.resize(numPoints);
+
+    GradientPass<T> gradientPass;
+    gradientPass.Volume = volume;
+    gradientPass.Gradient = gradient.data();
+    vtkSMPTools::For(0, numRows, gradientPass);
+    valueHistogram.swap(gradientPass.Histogram);
+    maxGradient = gradientPass.MaxGradient;
+
+    JointPass<T> jointPass;
+    jointPass.Volume = volume;
+    jointPass.Gradient = gradient.data();
+    jointPass.GradientScale = (maxGradient > 0.0) ? gradientBins / maxGradient : 0.0;
+    jointPass.GradientBins = gradientBins;
+    vtkSMPTools::For(0, numPoints, jointPass);
+    jointHistogram.swap(jointPass.Histogram);
+}
+
+} // namespace
+
+bool VolumeHistogram::Compute(vtkImageData* image, int valueBins, int gradientBins)
+{
+    double start = vtkTimerLog::GetUniversalTime();
+    vtkDataArray* scalars = image ? image->GetPointData()->GetScalars() : nullptr;
+    if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+        return false;
+    }
+
+    this->ValueBins = std::max(valueBins, 1);
+    this->GradientBins = std::max(gradientBins, 1);
+    scalars->GetRange(this->ValueRange, 0);
+
+    switch (scalars->GetDataType())
+    {
+        vtkTemplateMacro(ComputeHistograms(static_cast<const VTK_TT*>(scalars->GetVoidPointer(0)),
+            scalars->GetNumberOfComponents(), image, this->ValueRange, this->ValueBins, this->GradientBins,
+            this->ValueHistogram, this->JointHistogram, this->GradientMagnitude, this->MaxGradient));
+        default:
+            return false;
+    }
+    this->ComputeTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+    return true;
+}
+
+double VolumeHistogram::GetValue(int bin) const
+{
+    return this->ValueRange[0] + (bin + 0.5) * (this->ValueRange[1] - this->ValueRange[0]) / this->ValueBins;
+}
+
+double VolumeHistogram::GetGradient(int bin) const
+{
+    return (bin + 0.5) * this->MaxGradient / this->GradientBins;
+}
+
+std::vector<double> VolumeHistogram::SuggestBoundaries(int maxCount) const
+{
+    const int n = this->ValueBins;
+    if (n < 3 || this->JointHistogram.empty())
+    {
+        return {};
+    }
+
+    // Gradient sums per value bin, then the mean over a window of +-2 bins,
+    // weighted by count, so sparse bins do not make spikes.
+    std::vector<double> sums(n, 0.0);
+    for (int g = 0; g < this->GradientBins; ++g)
+    {
+        const double gradient = this->GetGradient(g);
+        for (int v = 0; v < n; ++v)
+        {
+            sums[v] += gradient * this->JointHistogram[v + static_cast<std::size_t>(g) * n];
+        }
+    }
+    vtkIdType total = 0;
+    for (vtkIdType count : this->ValueHistogram)
+    {
+        total += count;
+    }
+    const vtkIdType minCount = std::max<vtkIdType>(1, total / 10000);
+    const int window = 2;
+    std::vector<double> mean(n, 0.0);
+    for (int v = 0; v < n; ++v)
+    {
+        double sum = 0.0;
+        vtkIdType count = 0;
+        for (int w = std::max(v - window, 0); w <= std::min(v + window, n - 1); ++w)
+        {
+            sum += sums[w];
+            count += this->ValueHistogram[w];
+        }
+        mean[v] = (count >= minCount) ? sum / count : 0.0;
+    }
+
+    // Local maxima within +-3 bins, strongest first, at least 5% of the range
+    // apart.
+    std::vector<int> peaks;
+    for (int v = 1; v < n - 1; ++v)
+    {
+        bool peak = mean[v] > 0.0;
+        for (int w = std::max(v - 3, 0); w <= std::min(v + 3, n - 1) && peak; ++w)
+        {
+            peak = mean[w] < mean[v] || (mean[w] == mean[v] && w >= v);
+        }
+        if (peak)
+        {
+            peaks.push_back(v);
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [&](int a, int b) { return mean[a] > mean[b]; });
+
+    std::vector<int> kept;
+    for (int v : peaks)
+    {
+        bool separate = true;
+        for (int k : kept)
+        {
+            separate = separate && std::abs(k - v) >= n / 20;
+        }
+        if (separate)
+        {
+            kept.push_back(v);
+        }
+        if (static_cast<int>(kept.size()) == maxCount)
+        {
+            break;
+        }
+    }
+
+    std::vector<double> values;
+    for (int v : kept)
+    {
+        values.push_back(this->GetValue(v));
+    }
+    return values;
+}
+
+std::size_t VolumeHistogram::GetMemorySize() const
+{
+    return (this->ValueHistogram.size() + this->JointHistogram.size()) * sizeof(vtkIdType) +
+        this->GradientMagnitude.size() * sizeof(float);
+}
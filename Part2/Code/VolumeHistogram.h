@@ -0,0 +1,70 @@
+#ifndef VolumeHistogram_h
+#define VolumeHistogram_h
+
+#include "vtkType.h"
+
+#include <cstddef>
+#include <vector>
+
+class vtkImageData;
+
+// Histograms of a scalar volume for transfer function design.
+//
+// Compute() makes one parallel pass over the volume that fills the value
+// histogram and stores the gradient magnitude of every point (central
+// differences in world units, one-sided at the borders). A second parallel
+// pass over the values and the stored gradients bins the joint value x
+// gradient magnitude histogram, whose gradient axis needs the largest
+// gradient from the first pass. Both passes count into per-thread bins that
+// are summed at the end, so the counts do not depend on the number of
+// threads.
+//
+// Material boundaries show up in the joint histogram as arcs over the value
+// interval between two materials, highest at the value halfway across the
+// boundary. SuggestBoundaries() returns those values: the local maxima over
+// value of the mean gradient magnitude.
+class VolumeHistogram
+{
+public:
+    // Histograms of the first component of the active scalars over their
+    // range. Returns false if there are none.
+    bool Compute(vtkImageData* image, int valueBins = 256, int gradientBins = 128);
+
+    int GetNumberOfValueBins() const { return this->ValueBins; }
+    int GetNumberOfGradientBins() const { return this->GradientBins; }
+    const double* GetValueRange() const { return this->ValueRange; }
+    double GetMaxGradient() const { return this->MaxGradient; }
+
+    // Center of a bin.
+    double GetValue(int bin) const;
+    double GetGradient(int bin) const;
+
+    // Points per value bin.
+    const std::vector<vtkIdType>& GetValueHistogram() const { return this->ValueHistogram; }
+
+    // Points per value bin v and gradient bin g, at v + g * value bins.
+    const std::vector<vtkIdType>& GetJointHistogram() const { return this->JointHistogram; }
+
+    // Per point, in VTK point order.
+    const std::vector<float>& GetGradientMagnitude() const { return this->GradientMagnitude; }
+
+    // Values at the middle of material boundaries, strongest boundary first.
+    std::vector<double> SuggestBoundaries(int maxCount = 4) const;
+
+    // Milliseconds spent in the last Compute().
+    double GetComputeTime() const { return this->ComputeTime; }
+
+    std::size_t GetMemorySize() const;
+
+private:
+    int ValueBins = 0;
+    int GradientBins = 0;
+    double ValueRange[2] = { 0.0, 1.0 };
+    double MaxGradient = 0.0;
+    std::vector<vtkIdType> ValueHistogram;
+    std::vector<vtkIdType> JointHistogram;
+    std::vector<float> GradientMagnitude;
+    double ComputeTime = 0.0;
+};
+
+#endif
@@ -0,0 +1,392 @@
+#include "DistributedTracer.h"
+#include "FlowBenchmarks.h"
+#include "FlowDatasetPool.h"
+#include "FlowPipelines.h"
+#include "FrameBudgetGovernor.h"
+
+#include "vtkParallelPolyDataWriter.h"
+
+#include "vtkAutoInit.h"
+#include "vtkCallbackCommand.h"
+#include "vtkCommand.h"
+#include "vtkPolyData.h"
+#include "vtkRenderWindow.h"
+#include "vtkRenderWindowInteractor.h"
+#include "vtkRenderer.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+VTK_MODULE_INIT(vtkRenderingOpenGL2)
+VTK_MODULE_INIT(vtkInteractionStyle);
+
+// One render window, renderer and interactor for the whole session. Modes
+// and datasets are switched by swapping props and reconnecting pipeline
+// inputs; readers live in the pool and are reused.
+class FlowVisApp
+{
+public:
+    FlowVisApp()
+    {
+        this->Renderer = vtkSmartPointer<vtkRenderer>::New();
+        this->Renderer->SetBackground(0, 0, 0);
+        this->RenderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+        this->RenderWindow->AddRenderer(this->Renderer);
+        this->RenderWindow->SetSize(800, 600);
+        this->Interactor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
+        this->Interactor->SetRenderWindow(this->RenderWindow);
+        this->Governor.Attach(this->Interactor);
+    }
+
+    FlowDatasetPool& GetPool() { return this->Pool; }
+
+    bool SwitchMode(const std::string& mode)
+    {
+        std::unique_ptr<FlowPipeline>& pipeline = this->Pipelines[mode];
+        if (!pipeline)
+        {
+            pipeline = CreateFlowPipeline(mode);
+            if (!pipeline)
+            {
+                this->Pipelines.erase(mode);
+                return false;
+            }
+            pipeline->Build(this->Interactor);
+        }
+
+        if (this->Current)
+        {
+            this->Current->Hide(this->Renderer);
+        }
+        this->Current = pipeline.get();
+        this->Governor.SetPipeline(this->Current);
+        this->Attach();
+        return true;
+    }
+
+    bool SwitchDataset(int index)
+    {
+        int count = this->Pool.GetNumberOfDatasets();
+        if (count == 0)
+        {
+            return false;
+        }
+        index = ((index % count) + count) % count;
+        if (!this->Pool.Get(index))
+        {
+            return false;
+        }
+
+        this->DatasetIndex = index;
+        if (this->Current)
+        {
+            this->Current->Hide(this->Renderer);
+            this->Attach();
+        }
+        return true;
+    }
+
+    int GetDatasetIndex() const { return this->DatasetIndex; }
+
+    // Writes the geometry of the current mode to binary .vtp files named
+    // <mode>-<dataset>-<part>.vtp in the working directory.
+    void Export()
+    {
+        if (!this->Current || !this->Current->GetDataset())
+        {
+            return;
+        }
+        std::vector<std::pair<std::string, vtkSmartPointer<vtkPolyData>>> geometry;
+        this->Current->GetGeometry(geometry);
+        if (geometry.empty())
+        {
+            std::cout << this->Current->GetName() << " mode has no geometry to export" << std::endl;
+            return;
+        }
+
+        vtkSmartPointer<vtkParallelPolyDataWriter> writer = vtkSmartPointer<vtkParallelPolyDataWriter>::New();
+        for (const auto& part : geometry)
+        {
+            std::string fileName = std::string(this->Current->GetName()) + "-" + this->Current->GetDataset()->Name +
+                "-" + part.first + ".vtp";
+            writer->SetFileName(fileName.c_str());
+            writer->SetInputData(part.second);
+            double start = vtkTimerLog::GetUniversalTime();
+            if (!writer->Write())
+            {
+                std::cerr << "export: could not write " << fileName << std::endl;
+                continue;
+            }
+            std::cout << fileName << ": " << (writer->GetFileSize() + 1023) / 1024 << " KiB in "
+                      << (vtkTimerLog::GetUniversalTime() - start) * 1000.0 << " ms" << std::endl;
+        }
+    }
+
+    void Start()
+    {
+        vtkSmartPointer<vtkCallbackCommand> keyCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+        keyCallback->SetCallback(FlowVisApp::KeyPress);
+        keyCallback->SetClientData(this);
+        this->Interactor->AddObserver(vtkCommand::KeyPressEvent, keyCallback);
+
+        const std::vector<std::string>& modes = GetFlowPipelineNames();
+        for (size_t i = 0; i < modes.size(); ++i)
+        {
+            std::cout << "F" << i + 1 << ": " << modes[i] << std::endl;
+        }
+        std::cout << "Page Down / Page Up: next / previous dataset" << std::endl;
+        std::cout << "x: export the geometry of the current mode" << std::endl;
+
+        this->Interactor->Initialize();
+        this->RenderWindow->Render();
+        this->Interactor->Start();
+    }
+
+private:
+    // Connects the current pipeline to the current dataset and shows it.
+    void Attach()
+    {
+        FlowDataset* dataset = this->Pool.Get(this->DatasetIndex);
+        if (!dataset)
+        {
+            return;
+        }
+        if (this->Current->GetDataset() != dataset)
+        {
+            this->Current->SetDataset(dataset);
+        }
+        this->Current->Show(this->Renderer);
+        this->Current->SetupCamera(this->Renderer);
+
+        std::string title = std::string("flowVis - ") + this->Current->GetName() + " - " + dataset->Name;
+        this->RenderWindow->SetWindowName(title.c_str());
+        this->RenderWindow->Render();
+    }
+
+    static void KeyPress(vtkObject* caller, unsigned long, void* clientData, void*)
+    {
+        FlowVisApp* app = static_cast<FlowVisApp*>(clientData);
+        vtkRenderWindowInteractor* iren = static_cast<vtkRenderWindowInteractor*>(caller);
+        std::string key = iren->GetKeySym() ? iren->GetKeySym() : "";
+
+        const std::vector<std::string>& modes = GetFlowPipelineNames();
+        for (size_t i = 0; i < modes.size(); ++i)
+        {
+            if (key == "F" + std::to_string(i + 1))
+            {
+                app->SwitchMode(modes[i]);
+                return;
+            }
+        }
+        if (key == "Next")
+        {
+            app->SwitchDataset(app->DatasetIndex + 1);
+        }
+        else if (key == "Prior")
+        {
+            app->SwitchDataset(app->DatasetIndex - 1);
+        }
+        else if (key == "x")
+        {
+            app->Export();
+        }
+        else if (app->Current && app->Current->KeyPressed(key))
+        {
+            app->RenderWindow->Render();
+        }
+    }
+
+    FlowDatasetPool Pool;
+    std::map<std::string, std::unique_ptr<FlowPipeline>> Pipelines;
+    FlowPipeline* Current = nullptr;
+    int DatasetIndex = 0;
+    FrameBudgetGovernor Governor;
+
+    vtkSmartPointer<vtkRenderer> Renderer;
+    vtkSmartPointer<vtkRenderWindow> RenderWindow;
+    vtkSmartPointer<vtkRenderWindowInteractor> Interactor;
+};
+
+// Streamlines of a seed grid traced by worker processes, written to
+// distributed.vtp. With a port the workers are not spawned but awaited there,
+// e.g. from other hosts.
+static int RunDistributedTrace(
+    const char* program, const std::string& fileName, int workers, int spacing, int port, FieldLayout layout)
+{
+    DistributedTracer tracer;
+    tracer.SetFileName(fileName);
+    tracer.SetLayout(layout);
+    tracer.SetExecutable(program);
+    tracer.SetNumberOfWorkers(workers);
+    tracer.SetSpawnWorkers(port == 0);
+    tracer.SetPort(port);
+    if (!tracer.SetSeedGrid(spacing) || !tracer.Run())
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << tracer.GetOutput()->GetNumberOfLines() << " lines from " << tracer.GetBlocks().GetNumberOfBlocks()
+              << " workers in " << tracer.GetTraceTime() << " ms, " << tracer.GetNumberOfRounds() << " rounds, "
+              << tracer.GetNumberOfHandoffs() << " handoffs, " << GetFieldLayoutName(layout) << " blocks" << std::endl;
+
+    vtkSmartPointer<vtkParallelPolyDataWriter> writer = vtkSmartPointer<vtkParallelPolyDataWriter>::New();
+    writer->SetFileName("distributed.vtp");
+    writer->SetInputData(tracer.GetOutput());
+    return writer->Write() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static FieldLayout ParseFieldLayout(int argc, char** argv, int index)
+{
+    return argc > index && std::string(argv[index]) == "bricked" ? FieldLayout::Bricked : FieldLayout::Linear;
+}
+
+static void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <mode> [file.vtk ...]" << std::endl;
+    std::cerr << "  modes:";
+    for (const std::string& mode : GetFlowPipelineNames())
+    {
+        std::cerr << " " << mode;
+    }
+    std::cerr << std::endl;
+    std::cerr << "  Without files the datasets in ../data are used (../../Part1/FullHead.mhd for volume)."
+              << std::endl;
+    std::cerr << "       " << program << " bench-glyph [file.vtk] [repeats]" << std::endl;
+    std::cerr << "       " << program << " bench-streamlines [file.vtk] [spacing] [repeats]" << std::endl;
+    std::cerr << "       " << program << " bench-volume [file.mhd] [image size]" << std::endl;
+    std::cerr << "       " << program << " bench-iso [file.mhd] [repeats]" << std::endl;
+    std::cerr << "       " << program << " bench-particles [file.vtk] [particles] [frames]" << std::endl;
+    std::cerr << "       " << program << " bench-precision [file.vtk] [particles] [frames]" << std::endl;
+    std::cerr << "       " << program << " bench-layout [size] [samples] [steps]" << std::endl;
+    std::cerr << "       " << program << " bench-export [file.vtk] [repeats]" << std::endl;
+    std::cerr << "       " << program << " bench-histogram [file.mhd] [repeats]" << std::endl;
+    std::cerr << "       " << program << " bench-distributed [file.vtk] [max workers] [spacing] [linear|bricked]"
+              << std::endl;
+    std::cerr << "       " << program << " trace-distributed [file.vtk] [workers] [spacing] [port] [linear|bricked]"
+              << std::endl;
+    std::cerr << "       " << program << " trace-worker <host> <port> <index>" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "bench-glyph")
+    {
+        return RunGlyphBenchmark(argc > 2 ? argv[2] : "../data/testData2.vtk", argc > 3 ? atoi(argv[3]) : 5);
+    }
+    if (mode == "bench-volume")
+    {
+        return RunVolumeBenchmark(argc > 2 ? argv[2] : "../../Part1/FullHead.mhd", argc > 3 ? atoi(argv[3]) : 256);
+    }
+    if (mode == "bench-iso")
+    {
+        return RunIsoSurfaceBenchmark(argc > 2 ? argv[2] : "../../Part1/FullHead.mhd", argc > 3 ? atoi(argv[3]) : 5);
+    }
+    if (mode == "bench-particles")
+    {
+        return RunParticleBenchmark(argc > 2 ? argv[2] : "../data/testData2.vtk", argc > 3 ? atoi(argv[3]) : 1000000,
+            argc > 4 ? atoi(argv[4]) : 20);
+    }
+    if (mode == "bench-precision")
+    {
+        return RunPrecisionBenchmark(argc > 2 ? argv[2] : "../data/carotid.vtk", argc > 3 ? atoi(argv[3]) : 1000000,
+            argc > 4 ? atoi(argv[4]) : 20);
+    }
+    if (mode == "bench-layout")
+    {
+        return RunLayoutBenchmark(argc > 2 ? atoi(argv[2]) : 256, argc > 3 ? atoi(argv[3]) : 4000000,
+            argc > 4 ? atoi(argv[4]) : 100);
+    }
+    if (mode == "bench-export")
+    {
+        return RunExportBenchmark(argc > 2 ? argv[2] : "../data/testData2.vtk", argc > 3 ? atoi(argv[3]) : 5);
+    }
+    if (mode == "bench-histogram")
+    {
+        return RunHistogramBenchmark(argc > 2 ? argv[2] : "../../Part1/FullHead.mhd", argc > 3 ? atoi(argv[3]) : 5);
+    }
+    if (mode == "bench-distributed")
+    {
+        return RunDistributedBenchmark(argv[0], argc > 2 ? argv[2] : "../data/carotid.vtk",
+            argc > 3 ? atoi(argv[3]) : 4, argc > 4 ? atoi(argv[4]) : 2, ParseFieldLayout(argc, argv, 5));
+    }
+    if (mode == "trace-distributed")
+    {
+        return RunDistributedTrace(argv[0], argc > 2 ? argv[2] : "../data/carotid.vtk", argc > 3 ? atoi(argv[3]) : 4,
+            argc > 4 ? atoi(argv[4]) : 2, argc > 5 ? atoi(argv[5]) : 0, ParseFieldLayout(argc, argv, 6));
+    }
+    if (mode == "trace-worker")
+    {
+        if (argc < 5)
+        {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return RunTraceWorker(argv[2], atoi(argv[3]), atoi(argv[4]));
+    }
+    if (mode == "bench-streamlines")
+    {
+        return RunStreamlineBenchmark(argc > 2 ? argv[2] : "../data/testData2.vtk", argc > 3 ? atoi(argv[3]) : 1,
+            argc > 4 ? atoi(argv[4]) : 5);
+    }
+
+    FlowVisApp app;
+
+    if (argc > 2)
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            app.GetPool().Add(argv[i]);
+        }
+    }
+    else if (mode == "volume")
+    {
+        app.GetPool().Add("../../Part1/FullHead.mhd");
+    }
+    else
+    {
+        app.GetPool().Add("../data/testData1.vtk");
+        app.GetPool().Add("../data/testData2.vtk");
+        app.GetPool().Add("../data/carotid.vtk");
+    }
+
+    // The carotid mode was written for carotid.vtk, so start there if it is
+    // one of the inputs. Otherwise start with the first readable file.
+    int startIndex = 0;
+    if (mode == "carotid")
+    {
+        startIndex = std::max(app.GetPool().FindDataset("carotid"), 0);
+    }
+
+    bool loaded = false;
+    for (int i = 0; i < app.GetPool().GetNumberOfDatasets() && !loaded; ++i)
+    {
+        loaded = app.SwitchDataset(startIndex + i);
+    }
+    if (!loaded)
+    {
+        std::cerr << "flowVis: no readable dataset" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!app.SwitchMode(mode))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    app.Start();
+    return EXIT_SUCCESS;
+}
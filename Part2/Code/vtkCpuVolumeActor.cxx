@@ -0,0 +1,287 @@
+#include "vtkCpuVolumeActor.h"
+
+#include "vtkCamera.h"
+#include "vtkColorTransferFunction.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkImageMapper.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkPointData.h"
+#include "vtkRenderer.h"
+#include "vtkSMPTools.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+vtkStandardNewMacro(vtkCpuVolumeActor);
+
+namespace
+{
+
+// Trilinear sample at world position x, clamped to the grid.
+float SampleVolume(const float* data, const int dims[3], const double origin[3], const double spacing[3],
+    const double x[3])
+{
+    int i[3];
+    double f[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        double t = std::min(std::max((x[c] - origin[c]) / spacing[c], 0.0), dims[c] - 1.0);
+        i[c] = std::min(static_cast<int>(t), dims[c] - 2);
+        f[c] = t - i[c];
+    }
+
+    const vtkIdType sx = 1;
+    const vtkIdType sy = dims[0];
+    const vtkIdType sz = static_cast<vtkIdType>(dims[0]) * dims[1];
+    const float* p = data + i[0] + sy * i[1] + sz * i[2];
+    double c00 = p[0] + f[0] * (p[sx] - p[0]);
+    double c10 = p[sy] + f[0] * (p[sy + sx] - p[sy]);
+    double c01 = p[sz] + f[0] * (p[sz + sx] - p[sz]);
+    double c11 = p[sz + sy] + f[0] * (p[sz + sy + sx] - p[sz + sy]);
+    double c0 = c00 + f[1] * (c10 - c00);
+    double c1 = c01 + f[1] * (c11 - c01);
+    return static_cast<float>(c0 + f[2] * (c1 - c0));
+}
+
+// Clips the ray o + t d, t in [tNear, tFar], to the box [lo, hi].
+bool ClipRay(const double o[3], const double d[3], const double lo[3], const double hi[3], double& tNear,
+    double& tFar)
+{
+    for (int c = 0; c < 3; ++c)
+    {
+        if (std::abs(d[c]) < 1e-12)
+        {
+            if (o[c] < lo[c] || o[c] > hi[c])
+            {
+                return false;
+            }
+            continue;
+        }
+        double t1 = (lo[c] - o[c]) / d[c];
+        double t2 = (hi[c] - o[c]) / d[c];
+        tNear = std::max(tNear, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+    }
+    return tNear <= tFar;
+}
+
+void Unproject(const double m[16], double x, double y, double z, double world[3])
+{
+    double p[4];
+    for (int r = 0; r < 4; ++r)
+    {
+        p[r] = m[4 * r] * x + m[4 * r + 1] * y + m[4 * r + 2] * z + m[4 * r + 3];
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        world[c] = p[c] / p[3];
+    }
+}
+
+} // namespace
+
+vtkCpuVolumeActor::vtkCpuVolumeActor()
+{
+    this->Image = vtkSmartPointer<vtkImageData>::New();
+
+    vtkSmartPointer<vtkImageMapper> mapper = vtkSmartPointer<vtkImageMapper>::New();
+    mapper->SetInputData(this->Image);
+    mapper->SetColorWindow(255.0);
+    mapper->SetColorLevel(127.5);
+    this->SetMapper(mapper);
+}
+
+void vtkCpuVolumeActor::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "SampleDistance: " << this->SampleDistance << "\n";
+    os << indent << "ScalarOpacityUnitDistance: " << this->ScalarOpacityUnitDistance << "\n";
+    os << indent << "Preintegrated: " << this->Preintegrated << "\n";
+    os << indent << "Dimensions: (" << this->Dimensions[0] << ", " << this->Dimensions[1] << ", "
+       << this->Dimensions[2] << ")\n";
+}
+
+void vtkCpuVolumeActor::SetInputData(vtkImageData* volume)
+{
+    this->Scalars.clear();
+    std::fill(this->Dimensions, this->Dimensions + 3, 0);
+
+    vtkDataArray* scalars = volume ? volume->GetPointData()->GetScalars() : nullptr;
+    int dims[3] = { 0, 0, 0 };
+    if (volume)
+    {
+        volume->GetDimensions(dims);
+    }
+    // Rays need a cell in every direction.
+    if (scalars && dims[0] > 1 && dims[1] > 1 && dims[2] > 1)
+    {
+        std::copy(dims, dims + 3, this->Dimensions);
+        volume->GetPoint(0, this->Origin);
+        volume->GetSpacing(this->Spacing);
+        scalars->GetRange(this->ScalarRange, 0);
+
+        this->Scalars.resize(scalars->GetNumberOfTuples());
+        vtkSMPTools::For(0, scalars->GetNumberOfTuples(), [&](vtkIdType begin, vtkIdType end) {
+            for (vtkIdType id = begin; id < end; ++id)
+            {
+                this->Scalars[id] = static_cast<float>(scalars->GetComponent(id, 0));
+            }
+        });
+    }
+    this->Modified();
+}
+
+void vtkCpuVolumeActor::SetColor(vtkColorTransferFunction* color)
+{
+    this->Color = color;
+    this->Modified();
+}
+
+void vtkCpuVolumeActor::SetScalarOpacity(vtkPiecewiseFunction* opacity)
+{
+    this->ScalarOpacity = opacity;
+    this->Modified();
+}
+
+void vtkCpuVolumeActor::UpdateTable()
+{
+    this->LastTableEntries = 0;
+    this->LastTableTime = 0.0;
+    if (!this->Color || !this->ScalarOpacity)
+    {
+        return;
+    }
+    double start = vtkTimerLog::GetUniversalTime();
+    this->LastTableEntries = this->Table.Update(
+        this->Color, this->ScalarOpacity, this->ScalarRange, this->SampleDistance, this->ScalarOpacityUnitDistance);
+    this->LastTableTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+}
+
+void vtkCpuVolumeActor::RenderImage(vtkCamera* camera, int width, int height, vtkImageData* image)
+{
+    this->UpdateTable();
+    double start = vtkTimerLog::GetUniversalTime();
+
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    std::memset(pixels, 0, 4 * static_cast<std::size_t>(width) * height);
+    this->LastNumberOfSamples = 0;
+    if (this->Scalars.empty() || this->Table.GetNumberOfBins() == 0)
+    {
+        this->LastRenderTime = 0.0;
+        return;
+    }
+
+    // Pixels are unprojected with the inverse of the camera's view and
+    // projection, so rays need no access to the renderer.
+    vtkSmartPointer<vtkMatrix4x4> inverse = vtkSmartPointer<vtkMatrix4x4>::New();
+    inverse->DeepCopy(camera->GetCompositeProjectionTransformMatrix(static_cast<double>(width) / height, -1, 1));
+    inverse->Invert();
+    double m[16];
+    vtkMatrix4x4::DeepCopy(m, inverse);
+
+    double lo[3];
+    double hi[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        lo[c] = this->Origin[c];
+        hi[c] = this->Origin[c] + (this->Dimensions[c] - 1) * this->Spacing[c];
+        if (hi[c] < lo[c])
+        {
+            std::swap(lo[c], hi[c]);
+        }
+    }
+
+    const float* data = this->Scalars.data();
+    const PreintegrationTable& table = this->Table;
+    const double step = this->SampleDistance;
+    const bool preintegrated = this->Preintegrated;
+    std::vector<vtkIdType> rowSamples(height, 0);
+
+    vtkSMPTools::For(0, height, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType y = begin; y < end; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                double ndcX = 2.0 * (x + 0.5) / width - 1.0;
+                double ndcY = 2.0 * (y + 0.5) / height - 1.0;
+                double rayStart[3];
+                double rayEnd[3];
+                Unproject(m, ndcX, ndcY, -1.0, rayStart);
+                Unproject(m, ndcX, ndcY, 1.0, rayEnd);
+                double d[3] = { rayEnd[0] - rayStart[0], rayEnd[1] - rayStart[1], rayEnd[2] - rayStart[2] };
+                double length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                for (int c = 0; c < 3; ++c)
+                {
+                    d[c] /= length;
+                }
+
+                double tNear = 0.0;
+                double tFar = length;
+                if (!ClipRay(rayStart, d, lo, hi, tNear, tFar))
+                {
+                    continue;
+                }
+
+                double p[3] = { rayStart[0] + tNear * d[0], rayStart[1] + tNear * d[1], rayStart[2] + tNear * d[2] };
+                int front = table.GetBin(SampleVolume(data, this->Dimensions, this->Origin, this->Spacing, p));
+                double color[3] = { 0.0, 0.0, 0.0 };
+                double alpha = 0.0;
+                vtkIdType samples = 1;
+                for (double t = tNear + step; t <= tFar && alpha < 0.99; t += step, ++samples)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        p[c] = rayStart[c] + t * d[c];
+                    }
+                    int back = table.GetBin(SampleVolume(data, this->Dimensions, this->Origin, this->Spacing, p));
+                    const float* entry = preintegrated ? table.GetEntry(front, back) : table.GetEntry(back, back);
+                    double weight = 1.0 - alpha;
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        color[c] += weight * entry[c];
+                    }
+                    alpha += weight * entry[3];
+                    front = back;
+                }
+                rowSamples[y] += samples;
+
+                // vtkImageMapper blends with straight alpha.
+                unsigned char* pixel = pixels + 4 * (y * width + x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    double value = (alpha > 0.0) ? color[c] / alpha : 0.0;
+                    pixel[c] = static_cast<unsigned char>(std::min(std::max(value, 0.0), 1.0) * 255.0 + 0.5);
+                }
+                pixel[3] = static_cast<unsigned char>(std::min(std::max(alpha, 0.0), 1.0) * 255.0 + 0.5);
+            }
+        }
+    });
+
+    for (vtkIdType samples : rowSamples)
+    {
+        this->LastNumberOfSamples += samples;
+    }
+    image->Modified();
+    this->LastRenderTime = (vtkTimerLog::GetUniversalTime() - start) * 1000.0;
+}
+
+int vtkCpuVolumeActor::RenderOverlay(vtkViewport* viewport)
+{
+    vtkRenderer* renderer = vtkRenderer::SafeDownCast(viewport);
+    if (!renderer || !this->GetVisibility())
+    {
+        return 0;
+    }
+    const int* size = renderer->GetSize();
+    this->RenderImage(renderer->GetActiveCamera(), size[0], size[1], this->Image);
+    return this->Superclass::RenderOverlay(viewport);
+}
@@ -0,0 +1,105 @@
+// vtkCpuVolumeActor - multithreaded CPU ray caster drawn as a 2D overlay
+//
+// Casts one ray per viewport pixel through the bounds of a scalar volume,
+// compositing front to back with a PreintegrationTable built from the color
+// and scalar opacity functions, and shows the result through a vtkImageMapper.
+// Rays run in vtkSMPTools workers, one image row per task.
+//
+// With Preintegrated on, each pair of consecutive samples is looked up as one
+// segment, so sharp transfer functions stay smooth with a few times larger
+// SampleDistance. With it off, the diagonal of the same table gives ordinary
+// post-classification, which is what the table is compared against.
+//
+// The image is drawn over the 3D props; there is no depth compositing and no
+// shading.
+
+#ifndef vtkCpuVolumeActor_h
+#define vtkCpuVolumeActor_h
+
+#include "vtkActor2D.h"
+
+#include "PreintegrationTable.h"
+
+#include "vtkSmartPointer.h"
+
+#include <vector>
+
+class vtkCamera;
+class vtkColorTransferFunction;
+class vtkImageData;
+class vtkPiecewiseFunction;
+
+class vtkCpuVolumeActor : public vtkActor2D
+{
+public:
+    static vtkCpuVolumeActor* New();
+    vtkTypeMacro(vtkCpuVolumeActor, vtkActor2D);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    // The active scalars are copied to floats, so call again after the data
+    // changes.
+    void SetInputData(vtkImageData* volume);
+
+    void SetColor(vtkColorTransferFunction* color);
+    void SetScalarOpacity(vtkPiecewiseFunction* opacity);
+
+    // World distance between samples along a ray.
+    vtkSetClampMacro(SampleDistance, double, 1e-3, VTK_DOUBLE_MAX);
+    vtkGetMacro(SampleDistance, double);
+
+    // Distance the scalar opacity values are defined for.
+    vtkSetMacro(ScalarOpacityUnitDistance, double);
+    vtkGetMacro(ScalarOpacityUnitDistance, double);
+
+    vtkSetMacro(Preintegrated, bool);
+    vtkGetMacro(Preintegrated, bool);
+    vtkBooleanMacro(Preintegrated, bool);
+
+    // Brings the table up to date with the functions and SampleDistance and
+    // renders the volume as seen by `camera` into `image` (RGBA, unsigned
+    // char). Used by RenderOverlay() and by the benchmark without a window.
+    void RenderImage(vtkCamera* camera, int width, int height, vtkImageData* image);
+
+    const PreintegrationTable& GetTable() const { return this->Table; }
+
+    // Statistics of the last RenderImage() call.
+    double GetLastRenderTime() const { return this->LastRenderTime; }
+    double GetLastTableTime() const { return this->LastTableTime; }
+    vtkIdType GetLastTableEntries() const { return this->LastTableEntries; }
+    vtkIdType GetLastNumberOfSamples() const { return this->LastNumberOfSamples; }
+
+    int RenderOverlay(vtkViewport* viewport) override;
+
+protected:
+    vtkCpuVolumeActor();
+    ~vtkCpuVolumeActor() override = default;
+
+    void UpdateTable();
+
+    vtkSmartPointer<vtkColorTransferFunction> Color;
+    vtkSmartPointer<vtkPiecewiseFunction> ScalarOpacity;
+    double SampleDistance = 0.5;
+    double ScalarOpacityUnitDistance = 1.0;
+    bool Preintegrated = true;
+
+    // Volume as floats in VTK point order.
+    std::vector<float> Scalars;
+    int Dimensions[3] = { 0, 0, 0 };
+    double Origin[3] = { 0.0, 0.0, 0.0 };
+    double Spacing[3] = { 1.0, 1.0, 1.0 };
+    double ScalarRange[2] = { 0.0, 1.0 };
+
+    PreintegrationTable Table;
+    vtkSmartPointer<vtkImageData> Image;
+
+    double LastRenderTime = 0.0;
+    double LastTableTime = 0.0;
+    vtkIdType LastTableEntries = 0;
+    vtkIdType LastNumberOfSamples = 0;
+
+private:
+    vtkCpuVolumeActor(const vtkCpuVolumeActor&) = delete;
+    void operator=(const vtkCpuVolumeActor&) = delete;
+};
+
+#endif
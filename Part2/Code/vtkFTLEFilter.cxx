@@ -0,0 +1,294 @@
+#include "vtkFTLEFilter.h"
+
+#include "vtkFloatArray.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+vtkStandardNewMacro(vtkFTLEFilter);
+
+namespace
+{
+
+typedef FlowField<LinearFloatStorage> FlowMap;
+
+vtkIdType GetNumberOfGridPoints(const int dims[3])
+{
+    return static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+}
+
+void GetGridPoint(const FlowMap& grid, vtkIdType id, double x[3])
+{
+    const int* dims = grid.GetDimensions();
+    const vtkIdType ij[3] = { id % dims[0], (id / dims[0]) % dims[1], id / (static_cast<vtkIdType>(dims[0]) * dims[1]) };
+    for (int c = 0; c < 3; ++c)
+    {
+        x[c] = grid.GetOrigin()[c] + ij[c] * grid.GetSpacing()[c];
+    }
+}
+
+// positions[i] <- map(positions[i]). Points the map does not cover (they left
+// the domain earlier) stay where they are.
+void ApplyFlowMap(const FlowMap& map, std::vector<float>& positions)
+{
+    vtkSMPTools::For(0, static_cast<vtkIdType>(positions.size() / 3), [&](vtkIdType begin, vtkIdType end) {
+        double x[3];
+        double y[3];
+        for (vtkIdType id = begin; id < end; ++id)
+        {
+            float* p = &positions[3 * id];
+            std::copy(p, p + 3, x);
+            if (map.Sample(x, y))
+            {
+                std::copy(y, y + 3, p);
+            }
+        }
+    });
+}
+
+} // namespace
+
+vtkFTLEFilter::vtkFTLEFilter() = default;
+
+void vtkFTLEFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "SampleDimensions: (" << this->SampleDimensions[0] << ", " << this->SampleDimensions[1] << ", "
+       << this->SampleDimensions[2] << ")\n";
+    os << indent << "IntegrationTime: " << this->IntegrationTime << "\n";
+    os << indent << "StepSize: " << this->StepSize << "\n";
+    os << indent << "FlowMapInterval: " << this->FlowMapInterval << "\n";
+    os << indent << "Cached flow maps: " << this->FlowMaps.size() << "\n";
+}
+
+void vtkFTLEFilter::GetSampleGrid(vtkInformation* inInfo, int dims[3], double origin[3], double spacing[3])
+{
+    int extent[6];
+    double inOrigin[3];
+    double inSpacing[3];
+    inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+    inInfo->Get(vtkDataObject::ORIGIN(), inOrigin);
+    inInfo->Get(vtkDataObject::SPACING(), inSpacing);
+
+    for (int c = 0; c < 3; ++c)
+    {
+        int inDim = extent[2 * c + 1] - extent[2 * c] + 1;
+        double length = (inDim - 1) * inSpacing[c];
+        dims[c] = (inDim > 1 && this->SampleDimensions[c] > 1) ? this->SampleDimensions[c] : inDim;
+        origin[c] = inOrigin[c] + extent[2 * c] * inSpacing[c];
+        spacing[c] = (dims[c] > 1) ? length / (dims[c] - 1) : inSpacing[c];
+    }
+}
+
+int vtkFTLEFilter::RequestInformation(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+    vtkInformation* outInfo = outputVector->GetInformationObject(0);
+
+    int dims[3];
+    double origin[3];
+    double spacing[3];
+    this->GetSampleGrid(inInfo, dims, origin, spacing);
+
+    int extent[6] = { 0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1 };
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+    outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
+    outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+    return 1;
+}
+
+// Particles can travel anywhere, so the whole input is always needed.
+int vtkFTLEFilter::RequestUpdateExtent(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector*)
+{
+    vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+        inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+    return 1;
+}
+
+void vtkFTLEFilter::UpdateCache(vtkImageData* input, const int dims[3])
+{
+    const double direction = (this->IntegrationTime < 0.0) ? -1.0 : 1.0;
+    if (input == this->CacheInput && input->GetMTime() < this->CacheTime &&
+        std::equal(dims, dims + 3, this->CacheDimensions) && this->StepSize == this->CacheStepSize &&
+        this->FlowMapInterval == this->CacheInterval && direction == this->CacheDirection)
+    {
+        return;
+    }
+
+    this->Field.Assign(input);
+    this->FlowMaps.clear();
+    this->FlowMaps.shrink_to_fit();
+    std::copy(dims, dims + 3, this->CacheDimensions);
+    this->CacheInput = input;
+    this->CacheStepSize = this->StepSize;
+    this->CacheInterval = this->FlowMapInterval;
+    this->CacheDirection = direction;
+    this->CacheTime.Modified();
+}
+
+int vtkFTLEFilter::RequestData(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+    vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+    vtkImageData* output = vtkImageData::GetData(outputVector);
+
+    int dims[3];
+    double origin[3];
+    double spacing[3];
+    this->GetSampleGrid(inInfo, dims, origin, spacing);
+    output->SetExtent(0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1);
+    output->SetOrigin(origin);
+    output->SetSpacing(spacing);
+
+    const vtkIdType numPts = GetNumberOfGridPoints(dims);
+    vtkSmartPointer<vtkFloatArray> ftle = vtkSmartPointer<vtkFloatArray>::New();
+    ftle->SetName("FTLE");
+    ftle->SetNumberOfValues(numPts);
+    ftle->FillValue(0.0f);
+    output->GetPointData()->SetScalars(ftle);
+
+    if (!input || !input->GetPointData()->GetVectors())
+    {
+        vtkWarningMacro("Input has no vectors");
+        return 1;
+    }
+    const double duration = std::abs(this->IntegrationTime);
+    if (duration == 0.0 || numPts == 0)
+    {
+        return 1;
+    }
+
+    this->UpdateCache(input, dims);
+    const FlowMap& field = this->Field;
+    const double direction = this->CacheDirection;
+    const double stepSize = this->StepSize;
+
+    // Identity map on the sample grid; also used for the grid geometry.
+    FlowMap grid;
+    grid.SetGeometry(dims, origin, spacing);
+    std::vector<float> positions(3 * numPts);
+    vtkSMPTools::For(0, numPts, [&](vtkIdType begin, vtkIdType end) {
+        double x[3];
+        for (vtkIdType id = begin; id < end; ++id)
+        {
+            GetGridPoint(grid, id, x);
+            std::copy(x, x + 3, &positions[3 * id]);
+        }
+    });
+
+    // Whole intervals from the cached maps, one binary digit at a time.
+    double remainder = duration;
+    if (this->FlowMapInterval > 0.0)
+    {
+        const double interval = this->FlowMapInterval;
+        unsigned long intervals = static_cast<unsigned long>(std::floor(duration / interval + 1e-9));
+        remainder = std::max(0.0, duration - intervals * interval);
+
+        for (std::size_t k = 0; (intervals >> k) != 0; ++k)
+        {
+            if (k == this->FlowMaps.size())
+            {
+                std::vector<float> values;
+                if (k == 0)
+                {
+                    values.resize(3 * numPts);
+                    vtkSMPTools::For(0, numPts, [&](vtkIdType begin, vtkIdType end) {
+                        double x[3];
+                        for (vtkIdType id = begin; id < end; ++id)
+                        {
+                            GetGridPoint(grid, id, x);
+                            field.Advect(x, direction * interval, stepSize);
+                            std::copy(x, x + 3, &values[3 * id]);
+                        }
+                    });
+                }
+                else
+                {
+                    // map(2^k) = map(2^(k-1)) applied twice; the first
+                    // application at the grid points is the stored map.
+                    values = this->FlowMaps[k - 1].GetStorage().GetValues();
+                    ApplyFlowMap(this->FlowMaps[k - 1], values);
+                }
+                this->FlowMaps.emplace_back();
+                this->FlowMaps.back().SetGeometry(dims, origin, spacing);
+                this->FlowMaps.back().GetStorage().Assign(std::move(values), dims);
+            }
+            if ((intervals >> k) & 1)
+            {
+                ApplyFlowMap(this->FlowMaps[k], positions);
+            }
+        }
+    }
+
+    // The part of T not covered by whole intervals is advected directly.
+    if (remainder > 1e-9)
+    {
+        vtkSMPTools::For(0, numPts, [&](vtkIdType begin, vtkIdType end) {
+            double x[3];
+            for (vtkIdType id = begin; id < end; ++id)
+            {
+                float* p = &positions[3 * id];
+                std::copy(p, p + 3, x);
+                field.Advect(x, direction * remainder, stepSize);
+                std::copy(x, x + 3, p);
+            }
+        });
+    }
+
+    // Flow map gradient by central differences (one-sided on the border),
+    // then the largest eigenvalue of the right Cauchy-Green tensor. Axes with
+    // a single sample contribute a zero column and so a zero eigenvalue.
+    float* out = ftle->GetPointer(0);
+    vtkSMPTools::For(0, numPts, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType id = begin; id < end; ++id)
+        {
+            const vtkIdType ij[3] = { id % dims[0], (id / dims[0]) % dims[1],
+                id / (static_cast<vtkIdType>(dims[0]) * dims[1]) };
+            const vtkIdType stride[3] = { 1, dims[0], static_cast<vtkIdType>(dims[0]) * dims[1] };
+
+            double F[3][3] = { { 0.0 } };
+            for (int a = 0; a < 3; ++a)
+            {
+                if (dims[a] < 2)
+                {
+                    continue;
+                }
+                vtkIdType lo = (ij[a] > 0) ? id - stride[a] : id;
+                vtkIdType hi = (ij[a] < dims[a] - 1) ? id + stride[a] : id;
+                double h = ((hi - lo) / stride[a]) * spacing[a];
+                for (int c = 0; c < 3; ++c)
+                {
+                    F[c][a] = (positions[3 * hi + c] - positions[3 * lo + c]) / h;
+                }
+            }
+
+            double C[3][3];
+            for (int r = 0; r < 3; ++r)
+            {
+                for (int s = 0; s < 3; ++s)
+                {
+                    C[r][s] = F[0][r] * F[0][s] + F[1][r] * F[1][s] + F[2][r] * F[2][s];
+                }
+            }
+            double w[3];
+            double V[3][3];
+            vtkMath::Diagonalize3x3(C, w, V);
+            double lambda = std::max(w[0], std::max(w[1], w[2]));
+            out[id] = (lambda > 0.0) ? static_cast<float>(0.5 * std::log(lambda) / duration) : 0.0f;
+        }
+    });
+    return 1;
+}
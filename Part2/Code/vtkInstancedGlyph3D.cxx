@@ -0,0 +1,302 @@
+#include "vtkInstancedGlyph3D.h"
+
+#include "FlowField.h"
+#include "vtkParallelGlyph3D.h"
+
+#include "vtkDataSet.h"
+#include "vtkFloatArray.h"
+#include "vtkGlyph3DMapper.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkLookupTable.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSignedCharArray.h"
+#include "vtkUnsignedCharArray.h"
+
+#include <algorithm>
+#include <cmath>
+
+vtkStandardNewMacro(vtkInstancedGlyph3D);
+
+namespace
+{
+
+const int ColorTableSize = 256;
+
+struct InstanceWorker
+{
+    vtkDataSet* Input;
+    vtkDataArray* InScalars;
+    vtkDataArray* InVectors;
+    const FlowVectorSource* VectorSource; // replaces InVectors if set
+    vtkIdType Stride;
+    double ScaleFactor;
+    int ColorMode;
+    double ScalarRange[2];
+    const unsigned char* ColorTable; // ColorTableSize RGBA entries over ScalarRange
+
+    float* Positions;
+    signed char* Orientations;
+    float* Scales;
+    unsigned char* Colors;
+
+    // False if there are no vectors.
+    bool GetVector(vtkIdType ptId, double v[3]) const
+    {
+        if (this->VectorSource)
+        {
+            this->VectorSource->GetVector(ptId, v);
+            return true;
+        }
+        if (this->InVectors)
+        {
+            this->InVectors->GetTuple(ptId, v);
+            return true;
+        }
+        return false;
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end) const
+    {
+        const double range = this->ScalarRange[1] - this->ScalarRange[0];
+        for (vtkIdType instance = begin; instance < end; ++instance)
+        {
+            const vtkIdType ptId = instance * this->Stride;
+            double x[3];
+            this->Input->GetPoint(ptId, x);
+            for (int i = 0; i < 3; ++i)
+            {
+                this->Positions[3 * instance + i] = static_cast<float>(x[i]);
+            }
+
+            double v[3] = { 0.0, 0.0, 0.0 };
+            double vMag = 0.0;
+            const bool hasVector = this->GetVector(ptId, v);
+            if (hasVector)
+            {
+                vMag = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            }
+
+            // Unit direction quantized to signed 8 bit (about 0.5 degree).
+            for (int i = 0; i < 3; ++i)
+            {
+                double q = (vMag > 0.0) ? std::round(127.0 * v[i] / vMag) : 0.0;
+                this->Orientations[3 * instance + i] =
+                    static_cast<signed char>(std::max(-127.0, std::min(127.0, q)));
+            }
+
+            this->Scales[instance] = static_cast<float>((hasVector ? vMag : 1.0) * this->ScaleFactor);
+
+            double value = vMag;
+            if (this->ColorMode == VTK_INSTANCED_GLYPH_COLOR_BY_SCALAR)
+            {
+                value = this->InScalars ? this->InScalars->GetComponent(ptId, 0) : 0.0;
+            }
+            double t = (range > 0.0) ? (value - this->ScalarRange[0]) / range : 0.0;
+            int index = static_cast<int>(std::round(std::max(0.0, std::min(1.0, t)) * (ColorTableSize - 1)));
+            std::copy(this->ColorTable + 4 * index, this->ColorTable + 4 * index + 4, this->Colors + 4 * instance);
+        }
+    }
+};
+
+} // namespace
+
+vtkInstancedGlyph3D::vtkInstancedGlyph3D()
+{
+    this->SetNumberOfInputPorts(2);
+    this->SetNumberOfOutputPorts(2);
+    this->SetInputArrayToProcess(
+        0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS);
+    this->SetInputArrayToProcess(
+        1, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::VECTORS);
+
+    vtkSmartPointer<vtkLookupTable> lut = vtkSmartPointer<vtkLookupTable>::New();
+    lut->SetHueRange(0.667, 0.0);
+    lut->Build();
+    this->LookupTable = lut;
+}
+
+void vtkInstancedGlyph3D::SetSourceConnection(vtkAlgorithmOutput* algOutput)
+{
+    this->SetInputConnection(1, algOutput);
+}
+
+void vtkInstancedGlyph3D::SetLookupTable(vtkScalarsToColors* lut)
+{
+    if (this->LookupTable != lut)
+    {
+        this->LookupTable = lut;
+        this->Modified();
+    }
+}
+
+void vtkInstancedGlyph3D::SetVectorSource(std::shared_ptr<const FlowVectorSource> source)
+{
+    if (this->VectorSource != source)
+    {
+        this->VectorSource = source;
+        this->Modified();
+    }
+}
+
+vtkMTimeType vtkInstancedGlyph3D::GetMTime()
+{
+    vtkMTimeType mTime = this->Superclass::GetMTime();
+    if (this->LookupTable)
+    {
+        mTime = std::max(mTime, this->LookupTable->GetMTime());
+    }
+    return mTime;
+}
+
+int vtkInstancedGlyph3D::FillInputPortInformation(int port, vtkInformation* info)
+{
+    if (port == 0)
+    {
+        info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkDataSet");
+        return 1;
+    }
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+}
+
+int vtkInstancedGlyph3D::RequestData(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkDataSet* input = vtkDataSet::GetData(inputVector[0]);
+    vtkPolyData* mesh = vtkPolyData::GetData(inputVector[1]);
+    vtkPolyData* table = vtkPolyData::GetData(outputVector, 0);
+    vtkPolyData* meshOut = vtkPolyData::GetData(outputVector, 1);
+
+    if (mesh)
+    {
+        meshOut->ShallowCopy(mesh);
+    }
+    if (!input)
+    {
+        return 1;
+    }
+
+    // A new mesh alone does not touch the table.
+    if (this->Instances && input->GetMTime() <= this->InstancesTime && this->GetMTime() <= this->InstancesTime)
+    {
+        table->ShallowCopy(this->Instances);
+        return 1;
+    }
+
+    const vtkIdType stride = this->Stride;
+    const vtkIdType numInstances = (input->GetNumberOfPoints() + stride - 1) / stride;
+
+    vtkSmartPointer<vtkPoints> positions = vtkSmartPointer<vtkPoints>::New();
+    positions->SetDataTypeToFloat();
+    positions->SetNumberOfPoints(numInstances);
+
+    vtkSmartPointer<vtkSignedCharArray> orientations = vtkSmartPointer<vtkSignedCharArray>::New();
+    orientations->SetName("GlyphOrientation");
+    orientations->SetNumberOfComponents(3);
+    orientations->SetNumberOfTuples(numInstances);
+
+    vtkSmartPointer<vtkFloatArray> scales = vtkSmartPointer<vtkFloatArray>::New();
+    scales->SetName("GlyphScale");
+    scales->SetNumberOfTuples(numInstances);
+
+    vtkSmartPointer<vtkUnsignedCharArray> colors = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    colors->SetName("GlyphColor");
+    colors->SetNumberOfComponents(4);
+    colors->SetNumberOfTuples(numInstances);
+
+    // Sample the lookup table once so workers never call into it.
+    unsigned char colorTable[4 * ColorTableSize];
+    for (int i = 0; i < ColorTableSize; ++i)
+    {
+        double value = this->ScalarRange[0] + (this->ScalarRange[1] - this->ScalarRange[0]) * i / (ColorTableSize - 1);
+        const unsigned char* rgba = this->LookupTable->MapValue(value);
+        std::copy(rgba, rgba + 4, colorTable + 4 * i);
+    }
+
+    if (numInstances > 0)
+    {
+        // Make the first GetPoint() call from this thread, as vtkDataSet
+        // requires before it is called concurrently.
+        double x0[3];
+        input->GetPoint(0, x0);
+
+        InstanceWorker worker;
+        worker.Input = input;
+        worker.InScalars = this->GetInputArrayToProcess(0, inputVector);
+        worker.InVectors = this->GetInputArrayToProcess(1, inputVector);
+        worker.VectorSource = nullptr;
+        if (this->VectorSource && this->VectorSource->GetNumberOfPoints() == input->GetNumberOfPoints())
+        {
+            worker.VectorSource = this->VectorSource.get();
+        }
+        worker.Stride = stride;
+        worker.ScaleFactor = this->ScaleFactor;
+        worker.ColorMode = this->ColorMode;
+        worker.ScalarRange[0] = this->ScalarRange[0];
+        worker.ScalarRange[1] = this->ScalarRange[1];
+        worker.ColorTable = colorTable;
+        worker.Positions = vtkFloatArray::SafeDownCast(positions->GetData())->GetPointer(0);
+        worker.Orientations = orientations->GetPointer(0);
+        worker.Scales = scales->GetPointer(0);
+        worker.Colors = colors->GetPointer(0);
+
+        vtkSMPTools::For(0, numInstances, worker);
+    }
+
+    this->Instances = vtkSmartPointer<vtkPolyData>::New();
+    this->Instances->SetPoints(positions);
+    this->Instances->GetPointData()->AddArray(orientations);
+    this->Instances->GetPointData()->AddArray(scales);
+    this->Instances->GetPointData()->SetScalars(colors);
+    this->InstancesTime.Modified();
+
+    table->ShallowCopy(this->Instances);
+    return 1;
+}
+
+void vtkInstancedGlyph3D::ConfigureMapper(vtkGlyph3DMapper* mapper)
+{
+    mapper->SetInputConnection(this->GetOutputPort(0));
+    mapper->SetSourceConnection(this->GetOutputPort(1));
+    mapper->OrientOn();
+    mapper->SetOrientationModeToDirection();
+    mapper->SetOrientationArray("GlyphOrientation");
+    mapper->ScalingOn();
+    mapper->SetScaleModeToScaleByMagnitude();
+    mapper->SetScaleArray("GlyphScale");
+    mapper->SetScaleFactor(1.0);
+    mapper->ScalarVisibilityOn();
+    mapper->SetScalarModeToUsePointData();
+    mapper->SetColorModeToDirectScalars();
+}
+
+void vtkInstancedGlyph3D::ExpandInstances(vtkPolyData* instances, vtkPolyData* mesh, vtkPolyData* output)
+{
+    vtkSmartPointer<vtkParallelGlyph3D> glyph = vtkSmartPointer<vtkParallelGlyph3D>::New();
+    glyph->SetInputData(instances);
+    glyph->SetSourceData(mesh);
+    glyph->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, "GlyphScale");
+    glyph->SetInputArrayToProcess(1, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, "GlyphOrientation");
+    glyph->SetScaleModeToScaleByScalar();
+    glyph->SetScaleFactor(1.0);
+    glyph->OrientOn();
+    glyph->SetColorModeToColorOff();
+    glyph->Update();
+    output->ShallowCopy(glyph->GetOutput());
+}
+
+void vtkInstancedGlyph3D::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "ScaleFactor: " << this->ScaleFactor << "\n";
+    os << indent << "Stride: " << this->Stride << "\n";
+    os << indent << "ColorMode: " << this->ColorMode << "\n";
+    os << indent << "ScalarRange: " << this->ScalarRange[0] << ", " << this->ScalarRange[1] << "\n";
+    os << indent << "LookupTable: " << this->LookupTable.GetPointer() << "\n";
+    os << indent << "VectorSource: " << this->VectorSource.get() << "\n";
+}
@@ -0,0 +1,112 @@
+// vtkInstancedGlyph3D - glyphs as one source mesh plus a per-instance table
+//
+// Instead of copying the source mesh to every input point like vtkGlyph3D,
+// this filter produces
+//   port 0: the instance table, a vtkPolyData with one float point (the
+//           position) per glyph and the point data arrays
+//             "GlyphOrientation"  3 x signed char, unit direction * 127
+//             "GlyphScale"        1 x float, final scale incl. ScaleFactor
+//             "GlyphColor"        4 x unsigned char RGBA (active scalars)
+//           i.e. 23 bytes per glyph, independent of the source mesh;
+//   port 1: the source mesh, passed through once.
+//
+// The table is only rebuilt when the input points or the filter settings
+// change. Editing the source (e.g. a cone radius slider) only regenerates
+// the mesh on port 1.
+//
+// Rendering does not expand the geometry: ConfigureMapper() sets up a
+// vtkGlyph3DMapper to draw the mesh once per table row. ExpandInstances()
+// builds the equivalent explicit polydata on the CPU for export or picking;
+// expanded point p belongs to instance p / (number of mesh points).
+//
+// A FlowVectorSource set with SetVectorSource() replaces the input's vectors,
+// e.g. a float16 or block-quantized copy that the workers decode point by
+// point.
+
+#ifndef vtkInstancedGlyph3D_h
+#define vtkInstancedGlyph3D_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+#include "vtkSmartPointer.h"
+
+#include <memory>
+
+#define VTK_INSTANCED_GLYPH_COLOR_BY_SCALE 0
+#define VTK_INSTANCED_GLYPH_COLOR_BY_SCALAR 1
+#define VTK_INSTANCED_GLYPH_COLOR_BY_VECTOR 2
+
+class FlowVectorSource;
+class vtkGlyph3DMapper;
+class vtkScalarsToColors;
+
+class vtkInstancedGlyph3D : public vtkPolyDataAlgorithm
+{
+public:
+    static vtkInstancedGlyph3D* New();
+    vtkTypeMacro(vtkInstancedGlyph3D, vtkPolyDataAlgorithm);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    void SetSourceConnection(vtkAlgorithmOutput* algOutput);
+
+    // Glyph scale is |vector| * ScaleFactor, as vtkGlyph3D's ScaleByVector.
+    vtkSetMacro(ScaleFactor, double);
+    vtkGetMacro(ScaleFactor, double);
+
+    // Only every Stride-th input point gets a glyph; used to thin glyphs out
+    // while interacting.
+    vtkSetClampMacro(Stride, int, 1, VTK_INT_MAX);
+    vtkGetMacro(Stride, int);
+
+    vtkSetClampMacro(ColorMode, int, VTK_INSTANCED_GLYPH_COLOR_BY_SCALE, VTK_INSTANCED_GLYPH_COLOR_BY_VECTOR);
+    vtkGetMacro(ColorMode, int);
+    void SetColorModeToColorByScale() { this->SetColorMode(VTK_INSTANCED_GLYPH_COLOR_BY_SCALE); }
+    void SetColorModeToColorByScalar() { this->SetColorMode(VTK_INSTANCED_GLYPH_COLOR_BY_SCALAR); }
+    void SetColorModeToColorByVector() { this->SetColorMode(VTK_INSTANCED_GLYPH_COLOR_BY_VECTOR); }
+
+    // Colors are baked into the table through this lookup table over
+    // ScalarRange. Defaults to blue-to-red over [0, 1].
+    void SetLookupTable(vtkScalarsToColors* lut);
+    vtkScalarsToColors* GetLookupTable() { return this->LookupTable; }
+    vtkSetVector2Macro(ScalarRange, double);
+    vtkGetVector2Macro(ScalarRange, double);
+
+    // Optional; ignored unless it has one vector per input point.
+    void SetVectorSource(std::shared_ptr<const FlowVectorSource> source);
+    std::shared_ptr<const FlowVectorSource> GetVectorSource() const { return this->VectorSource; }
+
+    vtkMTimeType GetMTime() override;
+
+    // Bytes used by one row of the instance table.
+    static int GetBytesPerInstance() { return static_cast<int>(3 * sizeof(float) + 3 + sizeof(float) + 4); }
+
+    // Points a vtkGlyph3DMapper at the two outputs of this filter.
+    void ConfigureMapper(vtkGlyph3DMapper* mapper);
+
+    // CPU expansion of an instance table and mesh into explicit geometry.
+    static void ExpandInstances(vtkPolyData* instances, vtkPolyData* mesh, vtkPolyData* output);
+
+protected:
+    vtkInstancedGlyph3D();
+    ~vtkInstancedGlyph3D() override = default;
+
+    int FillInputPortInformation(int port, vtkInformation* info) override;
+    int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+    double ScaleFactor = 1.0;
+    int Stride = 1;
+    int ColorMode = VTK_INSTANCED_GLYPH_COLOR_BY_SCALE;
+    double ScalarRange[2] = { 0.0, 1.0 };
+    vtkSmartPointer<vtkScalarsToColors> LookupTable;
+    std::shared_ptr<const FlowVectorSource> VectorSource;
+
+    // Last built table, reused while only the source mesh changes.
+    vtkSmartPointer<vtkPolyData> Instances;
+    vtkTimeStamp InstancesTime;
+
+private:
+    vtkInstancedGlyph3D(const vtkInstancedGlyph3D&) = delete;
+    void operator=(const vtkInstancedGlyph3D&) = delete;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "vtkLoopbackServerSocket.h"
+
+#include "vtkObjectFactory.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <cstring>
+
+vtkStandardNewMacro(vtkLoopbackServerSocket);
+
+int vtkLoopbackServerSocket::CreateLoopbackServer(int port)
+{
+    if (this->SocketDescriptor != -1)
+    {
+        vtkWarningMacro("Server socket already exists, closing the old one.");
+        this->CloseSocket(this->SocketDescriptor);
+        this->SocketDescriptor = -1;
+    }
+
+    this->SocketDescriptor = this->CreateSocket();
+    if (this->SocketDescriptor == -1)
+    {
+        return -1;
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    if (bind(this->SocketDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        this->Listen(this->SocketDescriptor) != 0)
+    {
+        vtkErrorMacro("Unable to listen on 127.0.0.1:" << port);
+        this->CloseSocket(this->SocketDescriptor);
+        this->SocketDescriptor = -1;
+        return -1;
+    }
+    return 0;
+}
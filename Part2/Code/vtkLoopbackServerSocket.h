@@ -0,0 +1,33 @@
+// vtkLoopbackServerSocket - vtkServerSocket that only listens on 127.0.0.1
+//
+// vtkServerSocket::CreateServer() binds to every interface, so any host
+// that can reach the port could connect. CreateLoopbackServer() binds to
+// the IPv4 loopback address instead, for servers whose clients are
+// processes of this machine. Connections are then accepted with the usual
+// vtkServerSocket / vtkSocketCommunicator calls.
+
+#ifndef vtkLoopbackServerSocket_h
+#define vtkLoopbackServerSocket_h
+
+#include "vtkServerSocket.h"
+
+class vtkLoopbackServerSocket : public vtkServerSocket
+{
+public:
+    static vtkLoopbackServerSocket* New();
+    vtkTypeMacro(vtkLoopbackServerSocket, vtkServerSocket);
+
+    // Like CreateServer(): port 0 picks a free port (see GetServerPort()),
+    // returns 0 on success and -1 on error.
+    int CreateLoopbackServer(int port);
+
+protected:
+    vtkLoopbackServerSocket() = default;
+    ~vtkLoopbackServerSocket() override = default;
+
+private:
+    vtkLoopbackServerSocket(const vtkLoopbackServerSocket&) = delete;
+    void operator=(const vtkLoopbackServerSocket&) = delete;
+};
+
+#endif
@@ -0,0 +1,919 @@
+#include "vtkMultiIsoSurface.h"
+
+#include "ActiveBlockIndex.h"
+#include "FlowField.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkDataSetAttributes.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMarchingCubesTriangleCases.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+vtkStandardNewMacro(vtkMultiIsoSurface);
+
+namespace
+{
+
+// Cube corners in vtkMarchingCubes order: (0,0,0) (1,0,0) (1,1,0) (0,1,0),
+// then the same at z + 1. For each of its 12 edges: the point row the edge
+// starts in (0: (j, k), 1: (j+1, k), 2: (j, k+1), 3: (j+1, k+1)), the x
+// offset of the start point and the axis of the edge.
+const int CubeEdges[12][3] = { { 0, 0, 0 }, { 0, 1, 1 }, { 1, 0, 0 }, { 0, 0, 1 }, { 2, 0, 0 }, { 2, 1, 1 },
+    { 3, 0, 0 }, { 2, 0, 1 }, { 0, 0, 2 }, { 0, 1, 2 }, { 1, 0, 2 }, { 1, 1, 2 } };
+
+// Number of set bits of a point's 3-bit crossing mask.
+const int BitCount[8] = { 0, 1, 1, 2, 1, 2, 2, 3 };
+
+// The triangles of one marching cubes case as triangle strips of cube edges.
+struct CaseStrips
+{
+    int NumberOfStrips = 0;
+    int Length = 0;
+    int Sizes[5];
+    int Edges[15];
+};
+
+// Extends the strip `strip` of `size` points with unused triangles for as
+// long as one fits and returns the new size. Strip triangle n is
+// (v[n], v[n+1], v[n+2]) for even n and (v[n+1], v[n], v[n+2]) for odd n, so
+// a triangle fits only if it has the strip's last edge in that orientation.
+int GrowStrip(const std::vector<std::array<int, 3>>& triangles, std::vector<bool>& used, int* strip, int size)
+{
+    bool extended = true;
+    while (extended)
+    {
+        extended = false;
+        const int a = strip[size - 2];
+        const int b = strip[size - 1];
+        const bool odd = (size % 2) == 1;
+        for (size_t u = 0; u < triangles.size() && !extended; ++u)
+        {
+            for (int r = 0; r < 3 && !used[u]; ++r)
+            {
+                int p = triangles[u][r];
+                int q = triangles[u][(r + 1) % 3];
+                if (odd ? (p == b && q == a) : (p == a && q == b))
+                {
+                    strip[size++] = triangles[u][(r + 2) % 3];
+                    used[u] = true;
+                    extended = true;
+                }
+            }
+        }
+    }
+    return size;
+}
+
+// Chains the triangles of each case greedily, starting each strip with the
+// rotation of its first triangle that gives the longest strip.
+std::vector<CaseStrips> BuildCaseStrips()
+{
+    std::vector<CaseStrips> table(256);
+    vtkMarchingCubesTriangleCases* cases = vtkMarchingCubesTriangleCases::GetCases();
+    for (int c = 0; c < 256; ++c)
+    {
+        std::vector<std::array<int, 3>> triangles;
+        for (const int* edge = cases[c].edges; edge[0] > -1; edge += 3)
+        {
+            triangles.push_back({ { edge[0], edge[1], edge[2] } });
+        }
+
+        CaseStrips& strips = table[c];
+        std::vector<bool> used(triangles.size(), false);
+        for (size_t t = 0; t < triangles.size(); ++t)
+        {
+            if (used[t])
+            {
+                continue;
+            }
+            int best[15];
+            int bestSize = 0;
+            std::vector<bool> bestUsed;
+            for (int r = 0; r < 3; ++r)
+            {
+                int strip[15] = { triangles[t][r], triangles[t][(r + 1) % 3], triangles[t][(r + 2) % 3] };
+                std::vector<bool> stripUsed = used;
+                stripUsed[t] = true;
+                int size = GrowStrip(triangles, stripUsed, strip, 3);
+                if (size > bestSize)
+                {
+                    std::copy(strip, strip + size, best);
+                    bestSize = size;
+                    bestUsed = stripUsed;
+                }
+            }
+            used = bestUsed;
+            std::copy(best, best + bestSize, strips.Edges + strips.Length);
+            strips.Sizes[strips.NumberOfStrips++] = bestSize;
+            strips.Length += bestSize;
+        }
+    }
+    return table;
+}
+
+const CaseStrips* GetCaseStrips()
+{
+    static const std::vector<CaseStrips> table = BuildCaseStrips();
+    return table.data();
+}
+
+// Output arrays of one surface.
+struct SurfaceArrays
+{
+    float* Points = nullptr;
+    float* Normals = nullptr;
+    vtkIdType* Offsets = nullptr;
+    vtkIdType* Connectivity = nullptr;
+};
+
+// Scalar access of the extractor, by point id p = (i, j, k); each reads the
+// index it needs. Component 0 of a VTK array:
+template <typename ValueType>
+struct ArrayScalars
+{
+    ArrayScalars(const ValueType* values, int numberOfComponents)
+        : Values(values)
+        , NumberOfComponents(numberOfComponents)
+    {
+    }
+
+    const ValueType* Values;
+    int NumberOfComponents;
+
+    double Get(vtkIdType p, int, int, int) const
+    {
+        return static_cast<double>(this->Values[p * this->NumberOfComponents]);
+    }
+};
+
+// and a bricked copy.
+struct BrickedScalars
+{
+    const BrickedFloatStorage<1>* Storage;
+
+    double Get(vtkIdType, int i, int j, int k) const
+    {
+        return static_cast<double>(this->Storage->GetValues()[this->Storage->GetOffset(i, j, k)]);
+    }
+};
+
+template <typename ScalarAccess>
+class IsoSurfaceExtractor
+{
+public:
+    IsoSurfaceExtractor(const ScalarAccess& scalars, vtkImageData* image, const std::vector<double>& values,
+        const ActiveBlockIndex* blocks)
+        : Scalars(scalars)
+        , Blocks(blocks)
+    {
+        image->GetDimensions(this->Dimensions);
+        image->GetPoint(0, this->Origin);
+        image->GetSpacing(this->Spacing);
+        this->Strides[0] = 1;
+        this->Strides[1] = this->Dimensions[0];
+        this->Strides[2] = static_cast<vtkIdType>(this->Dimensions[0]) * this->Dimensions[1];
+        this->NumberOfPoints = this->Strides[2] * this->Dimensions[2];
+        this->NumberOfRows = static_cast<vtkIdType>(this->Dimensions[1]) * this->Dimensions[2];
+        this->NumberOfCellRows = static_cast<vtkIdType>(this->Dimensions[1] - 1) * (this->Dimensions[2] - 1);
+        this->Strips = GetCaseStrips();
+
+        // Values in ascending order; Order[m] is the output of sorted value m.
+        const int numValues = static_cast<int>(values.size());
+        this->Order.resize(numValues);
+        for (int n = 0; n < numValues; ++n)
+        {
+            this->Order[n] = n;
+        }
+        std::stable_sort(
+            this->Order.begin(), this->Order.end(), [&](int a, int b) { return values[a] < values[b]; });
+        this->Rank.resize(numValues);
+        for (int m = 0; m < numValues; ++m)
+        {
+            this->Sorted.push_back(values[this->Order[m]]);
+            this->Rank[this->Order[m]] = m;
+        }
+    }
+
+    // Pass 1: point levels and per row counts.
+    void Classify()
+    {
+        const size_t numValues = this->Sorted.size();
+        this->Levels.assign(this->NumberOfPoints, 0);
+        this->RowVertices.assign(numValues * (this->NumberOfRows + 1), 0);
+        this->RowStrips.assign(numValues * (this->NumberOfCellRows + 1), 0);
+        this->RowConnectivity.assign(numValues * (this->NumberOfCellRows + 1), 0);
+
+        vtkSMPTools::For(0, this->NumberOfRows, [&](vtkIdType begin, vtkIdType end) {
+            std::vector<char> nearActive;
+            for (vtkIdType row = begin; row < end; ++row)
+            {
+                this->ComputeLevels(row, nearActive);
+            }
+        });
+        vtkSMPTools::For(0, this->NumberOfRows, [&](vtkIdType begin, vtkIdType end) {
+            std::vector<vtkIdType> counts(3 * numValues);
+            for (vtkIdType row = begin; row < end; ++row)
+            {
+                this->CountRow(row, counts);
+            }
+        });
+
+        // Pass 2: counts to first indices.
+        for (size_t m = 0; m < numValues; ++m)
+        {
+            ExclusiveScan(&this->RowVertices[m * (this->NumberOfRows + 1)], this->NumberOfRows);
+            ExclusiveScan(&this->RowStrips[m * (this->NumberOfCellRows + 1)], this->NumberOfCellRows);
+            ExclusiveScan(&this->RowConnectivity[m * (this->NumberOfCellRows + 1)], this->NumberOfCellRows);
+        }
+    }
+
+    // Totals of the surface on output port n.
+    vtkIdType GetNumberOfVertices(size_t n) const
+    {
+        return this->RowVertices[this->Rank[n] * (this->NumberOfRows + 1) + this->NumberOfRows];
+    }
+    vtkIdType GetNumberOfStrips(size_t n) const
+    {
+        return this->RowStrips[this->Rank[n] * (this->NumberOfCellRows + 1) + this->NumberOfCellRows];
+    }
+    vtkIdType GetConnectivitySize(size_t n) const
+    {
+        return this->RowConnectivity[this->Rank[n] * (this->NumberOfCellRows + 1) + this->NumberOfCellRows];
+    }
+
+    // Pass 3: points, normals and strips into preallocated arrays, indexed
+    // by output port.
+    void Generate(const std::vector<SurfaceArrays>& surfaces)
+    {
+        vtkSMPTools::For(0, this->NumberOfRows, [&](vtkIdType begin, vtkIdType end) {
+            std::vector<vtkIdType> cursors(6 * this->Sorted.size());
+            for (vtkIdType row = begin; row < end; ++row)
+            {
+                this->GenerateVertices(row, surfaces, cursors);
+                this->GenerateStrips(row, surfaces, cursors);
+            }
+        });
+    }
+
+private:
+    static void ExclusiveScan(vtkIdType* counts, vtkIdType size)
+    {
+        vtkIdType total = 0;
+        for (vtkIdType i = 0; i < size; ++i)
+        {
+            vtkIdType count = counts[i];
+            counts[i] = total;
+            total += count;
+        }
+        counts[size] = total;
+    }
+
+    double GetScalar(vtkIdType p, const int ijk[3]) const { return this->Scalars.Get(p, ijk[0], ijk[1], ijk[2]); }
+
+    // Scalar of the point `delta` steps from p along axis a.
+    double GetScalar(vtkIdType p, const int ijk[3], int a, int delta) const
+    {
+        int n[3] = { ijk[0], ijk[1], ijk[2] };
+        n[a] += delta;
+        return this->Scalars.Get(p + delta * this->Strides[a], n[0], n[1], n[2]);
+    }
+
+    // Marching cubes case of the cell at point p for sorted value m.
+    int GetCase(vtkIdType p, int m) const
+    {
+        const vtkIdType dx = this->Strides[1];
+        const vtkIdType dz = this->Strides[2];
+        const vtkIdType corners[8] = { p, p + 1, p + 1 + dx, p + dx, p + dz, p + 1 + dz, p + 1 + dx + dz, p + dx + dz };
+        int index = 0;
+        for (int c = 0; c < 8; ++c)
+        {
+            if (this->Levels[corners[c]] > m)
+            {
+                index |= 1 << c;
+            }
+        }
+        return index;
+    }
+
+    // The sorted values [first, last) that some corner of the cell at point
+    // p is below and another is not; the cell is empty for all others.
+    void GetCellRange(vtkIdType p, int& first, int& last) const
+    {
+        const vtkIdType dx = this->Strides[1];
+        const vtkIdType dz = this->Strides[2];
+        const vtkIdType corners[8] = { p, p + 1, p + 1 + dx, p + dx, p + dz, p + 1 + dz, p + 1 + dx + dz, p + dx + dz };
+        first = last = this->Levels[p];
+        for (int c = 1; c < 8; ++c)
+        {
+            first = std::min(first, static_cast<int>(this->Levels[corners[c]]));
+            last = std::max(last, static_cast<int>(this->Levels[corners[c]]));
+        }
+    }
+
+    bool IsCellActive(int i, int j, int k) const { return !this->Blocks || this->Blocks->IsCellActive(i, j, k); }
+
+    // Some active cell uses the edge from point ijk along axis a.
+    bool IsEdgeUsed(const int ijk[3], int a) const
+    {
+        if (!this->Blocks)
+        {
+            return true;
+        }
+        const int b = (a + 1) % 3;
+        const int c = (a + 2) % 3;
+        for (int db = 0; db < 2; ++db)
+        {
+            for (int dc = 0; dc < 2; ++dc)
+            {
+                int cell[3] = { ijk[0], ijk[1], ijk[2] };
+                cell[b] -= db;
+                cell[c] -= dc;
+                if (cell[b] >= 0 && cell[c] >= 0 && cell[b] < this->Dimensions[b] - 1 &&
+                    cell[c] < this->Dimensions[c] - 1 && this->Blocks->IsCellActive(cell[0], cell[1], cell[2]))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Bit a: the edge from point ijk along axis a lies in the grid and is
+    // used by an active cell.
+    int GetEdges(const int ijk[3]) const
+    {
+        int edges = 0;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (ijk[a] < this->Dimensions[a] - 1 && this->IsEdgeUsed(ijk, a))
+            {
+                edges |= 1 << a;
+            }
+        }
+        return edges;
+    }
+
+    // Number of the `edges` from point p that cross sorted value m.
+    int CountCrossings(vtkIdType p, int edges, int m) const
+    {
+        const bool inside = this->Levels[p] > m;
+        int count = 0;
+        for (int a = 0; a < 3; ++a)
+        {
+            if ((edges & (1 << a)) && (this->Levels[p + this->Strides[a]] > m) != inside)
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    // With a block index, nearActive[b] tells whether x block b has an
+    // active cell next to point row (j, k).
+    void FindNearActive(int j, int k, std::vector<char>& nearActive) const
+    {
+        const int* dims = this->Dimensions;
+        const int blockSize = this->Blocks->GetBlockSize();
+        nearActive.assign(this->Blocks->GetBlockDimensions()[0], 0);
+        for (size_t b = 0; b < nearActive.size(); ++b)
+        {
+            for (int cj = std::max(j - 1, 0); cj <= std::min(j, dims[1] - 2); ++cj)
+            {
+                for (int ck = std::max(k - 1, 0); ck <= std::min(k, dims[2] - 2); ++ck)
+                {
+                    nearActive[b] =
+                        nearActive[b] || this->Blocks->IsCellActive(static_cast<int>(b) * blockSize, cj, ck);
+                }
+            }
+        }
+    }
+
+    // Levels[p] is the number of values at or below the scalar of p, so p is
+    // inside sorted value m exactly when Levels[p] > m. Each scalar is read
+    // once here whatever the number of values. With a block index, points
+    // away from active cells are not read and keep level 0; no used edge
+    // or active cell touches them. `nearActive` is scratch space, reused
+    // across the rows of a task.
+    void ComputeLevels(vtkIdType row, std::vector<char>& nearActive)
+    {
+        const int* dims = this->Dimensions;
+        const int j = static_cast<int>(row % dims[1]);
+        const int k = static_cast<int>(row / dims[1]);
+        const vtkIdType start = row * this->Strides[1];
+        const int numValues = static_cast<int>(this->Sorted.size());
+        int blockSize = 1;
+        if (this->Blocks)
+        {
+            blockSize = this->Blocks->GetBlockSize();
+            this->FindNearActive(j, k, nearActive);
+        }
+        for (int i = 0; i < dims[0]; ++i)
+        {
+            if (this->Blocks && !nearActive[std::min(i, dims[0] - 2) / blockSize] &&
+                !(i > 0 && nearActive[(i - 1) / blockSize]))
+            {
+                continue;
+            }
+            const double s = this->Scalars.Get(start + i, i, j, k);
+            int level = 0;
+            while (level < numValues && s >= this->Sorted[level])
+            {
+                ++level;
+            }
+            this->Levels[start + i] = static_cast<unsigned char>(level);
+        }
+    }
+
+    // Crossings of the point row and strips of the cell row per value. An
+    // edge or cell only visits the values it crosses, so the work follows
+    // the size of the surfaces rather than their number. `counts` is
+    // scratch space for 3 entries per value.
+    void CountRow(vtkIdType row, std::vector<vtkIdType>& counts)
+    {
+        const int* dims = this->Dimensions;
+        const int j = static_cast<int>(row % dims[1]);
+        const int k = static_cast<int>(row / dims[1]);
+        const vtkIdType start = row * this->Strides[1];
+        const size_t numValues = this->Sorted.size();
+        vtkIdType* vertices = counts.data();
+        vtkIdType* strips = vertices + numValues;
+        vtkIdType* connectivity = strips + numValues;
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for (int i = 0; i < dims[0]; ++i)
+        {
+            const vtkIdType p = start + i;
+            const int ijk[3] = { i, j, k };
+            const int edges = this->GetEdges(ijk);
+            for (int a = 0; a < 3; ++a)
+            {
+                if (edges & (1 << a))
+                {
+                    const int l0 = this->Levels[p];
+                    const int l1 = this->Levels[p + this->Strides[a]];
+                    for (int m = std::min(l0, l1); m < std::max(l0, l1); ++m)
+                    {
+                        ++vertices[m];
+                    }
+                }
+            }
+        }
+        for (size_t m = 0; m < numValues; ++m)
+        {
+            this->RowVertices[m * (this->NumberOfRows + 1) + row] = vertices[m];
+        }
+
+        if (j >= dims[1] - 1 || k >= dims[2] - 1)
+        {
+            return;
+        }
+        for (int i = 0; i < dims[0] - 1; ++i)
+        {
+            if (!this->IsCellActive(i, j, k))
+            {
+                continue;
+            }
+            int first;
+            int last;
+            this->GetCellRange(start + i, first, last);
+            for (int m = first; m < last; ++m)
+            {
+                const CaseStrips& cell = this->Strips[this->GetCase(start + i, m)];
+                strips[m] += cell.NumberOfStrips;
+                connectivity[m] += cell.Length;
+            }
+        }
+        const vtkIdType cellRow = j + static_cast<vtkIdType>(k) * (dims[1] - 1);
+        for (size_t m = 0; m < numValues; ++m)
+        {
+            this->RowStrips[m * (this->NumberOfCellRows + 1) + cellRow] = strips[m];
+            this->RowConnectivity[m * (this->NumberOfCellRows + 1) + cellRow] = connectivity[m];
+        }
+    }
+
+    // Central differences inside the volume, one sided on its faces.
+    void GetGradient(vtkIdType p, const int ijk[3], double g[3]) const
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            if (this->Dimensions[a] < 2)
+            {
+                g[a] = 0.0;
+            }
+            else if (ijk[a] == 0)
+            {
+                g[a] = (this->GetScalar(p, ijk, a, 1) - this->GetScalar(p, ijk)) / this->Spacing[a];
+            }
+            else if (ijk[a] == this->Dimensions[a] - 1)
+            {
+                g[a] = (this->GetScalar(p, ijk) - this->GetScalar(p, ijk, a, -1)) / this->Spacing[a];
+            }
+            else
+            {
+                g[a] = (this->GetScalar(p, ijk, a, 1) - this->GetScalar(p, ijk, a, -1)) / (2.0 * this->Spacing[a]);
+            }
+        }
+    }
+
+    // The crossings of the point row for all values, in x then axis order
+    // within each value. `ids` holds the next vertex id per value.
+    void GenerateVertices(vtkIdType row, const std::vector<SurfaceArrays>& surfaces, std::vector<vtkIdType>& ids) const
+    {
+        const int* dims = this->Dimensions;
+        const int j = static_cast<int>(row % dims[1]);
+        const int k = static_cast<int>(row / dims[1]);
+        const vtkIdType start = row * this->Strides[1];
+        for (size_t m = 0; m < this->Sorted.size(); ++m)
+        {
+            ids[m] = this->RowVertices[m * (this->NumberOfRows + 1) + row];
+        }
+        const bool normals = std::any_of(
+            surfaces.begin(), surfaces.end(), [](const SurfaceArrays& out) { return out.Normals != nullptr; });
+
+        for (int i = 0; i < dims[0]; ++i)
+        {
+            const vtkIdType p0 = start + i;
+            const int ijk0[3] = { i, j, k };
+            const int edges = this->GetEdges(ijk0);
+            bool crossed = false;
+            for (int a = 0; a < 3 && !crossed; ++a)
+            {
+                crossed = (edges & (1 << a)) && this->Levels[p0] != this->Levels[p0 + this->Strides[a]];
+            }
+            if (!crossed)
+            {
+                continue;
+            }
+            const double s0 = this->GetScalar(p0, ijk0);
+            double g0[3];
+            if (normals)
+            {
+                this->GetGradient(p0, ijk0, g0);
+            }
+
+            for (int a = 0; a < 3; ++a)
+            {
+                const vtkIdType p1 = p0 + this->Strides[a];
+                const int l0 = this->Levels[p0];
+                const int l1 = this->Levels[p1];
+                if (!(edges & (1 << a)) || l0 == l1)
+                {
+                    continue;
+                }
+                int ijk1[3] = { i, j, k };
+                ++ijk1[a];
+                const double s1 = this->GetScalar(p1, ijk1);
+                double g1[3];
+                if (normals)
+                {
+                    this->GetGradient(p1, ijk1, g1);
+                }
+                for (int m = std::min(l0, l1); m < std::max(l0, l1); ++m)
+                {
+                    const SurfaceArrays& out = surfaces[this->Order[m]];
+                    const vtkIdType id = ids[m]++;
+                    const double t = (this->Sorted[m] - s0) / (s1 - s0);
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        double x = ijk0[c] + (c == a ? t : 0.0);
+                        out.Points[3 * id + c] = static_cast<float>(this->Origin[c] + x * this->Spacing[c]);
+                    }
+
+                    if (out.Normals)
+                    {
+                        double normal[3];
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            normal[c] = -(g0[c] + t * (g1[c] - g0[c]));
+                        }
+                        double length =
+                            std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            out.Normals[3 * id + c] = static_cast<float>(length > 0.0 ? normal[c] / length : 0.0);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // The strips of the cell row for all values. `cursors` is scratch space
+    // for 6 entries per value.
+    void GenerateStrips(vtkIdType row, const std::vector<SurfaceArrays>& surfaces, std::vector<vtkIdType>& cursors) const
+    {
+        const int* dims = this->Dimensions;
+        const int j = static_cast<int>(row % dims[1]);
+        const int k = static_cast<int>(row / dims[1]);
+        if (j >= dims[1] - 1 || k >= dims[2] - 1)
+        {
+            return;
+        }
+        const vtkIdType cellRow = j + static_cast<vtkIdType>(k) * (dims[1] - 1);
+        const size_t numValues = this->Sorted.size();
+
+        // The four point rows around the cell row. before[q * numValues + m]
+        // is the id of the first crossing of sorted value m at or after the
+        // current x in row q; edges[q] are the edges of the points of row q
+        // at x and x + 1. strips[m] and entries[m] are the next strip and
+        // connectivity entry of value m.
+        vtkIdType* before = cursors.data();
+        vtkIdType* strips = before + 4 * numValues;
+        vtkIdType* entries = strips + numValues;
+        for (size_t m = 0; m < numValues; ++m)
+        {
+            strips[m] = this->RowStrips[m * (this->NumberOfCellRows + 1) + cellRow];
+            entries[m] = this->RowConnectivity[m * (this->NumberOfCellRows + 1) + cellRow];
+        }
+        const vtkIdType rows[4] = { row, row + 1, row + dims[1], row + dims[1] + 1 };
+        int edges[4][2];
+        for (int q = 0; q < 4; ++q)
+        {
+            for (size_t m = 0; m < numValues; ++m)
+            {
+                before[q * numValues + m] = this->RowVertices[m * (this->NumberOfRows + 1) + rows[q]];
+            }
+            const int ijk[3] = { 0, j + (q & 1), k + (q >> 1) };
+            edges[q][1] = this->GetEdges(ijk);
+        }
+
+        const vtkIdType start = row * this->Strides[1];
+        for (int i = 0; i < dims[0] - 1; ++i)
+        {
+            for (int q = 0; q < 4; ++q)
+            {
+                const int ijk[3] = { i + 1, j + (q & 1), k + (q >> 1) };
+                edges[q][0] = edges[q][1];
+                edges[q][1] = this->GetEdges(ijk);
+            }
+
+            int first = 0;
+            int last = 0;
+            if (this->IsCellActive(i, j, k))
+            {
+                this->GetCellRange(start + i, first, last);
+            }
+            for (int m = first; m < last; ++m)
+            {
+                const SurfaceArrays& out = surfaces[this->Order[m]];
+                vtkIdType& strip = strips[m];
+                vtkIdType& entry = entries[m];
+                const CaseStrips& cell = this->Strips[this->GetCase(start + i, m)];
+                const int* edge = cell.Edges;
+                for (int s = 0; s < cell.NumberOfStrips; ++s)
+                {
+                    out.Offsets[strip++] = entry;
+                    for (int v = 0; v < cell.Sizes[s]; ++v, ++edge)
+                    {
+                        const int q = CubeEdges[*edge][0];
+                        const int x = CubeEdges[*edge][1];
+                        const int a = CubeEdges[*edge][2];
+                        const vtkIdType p = rows[q] * this->Strides[1] + i;
+                        vtkIdType id = before[q * numValues + m] + (x ? this->CountCrossings(p, edges[q][0], m) : 0);
+                        out.Connectivity[entry++] = id + this->CountCrossings(p + x, edges[q][x] & ((1 << a) - 1), m);
+                    }
+                }
+            }
+
+            for (int q = 0; q < 4; ++q)
+            {
+                const vtkIdType p = rows[q] * this->Strides[1] + i;
+                for (int a = 0; a < 3; ++a)
+                {
+                    if (edges[q][0] & (1 << a))
+                    {
+                        const int l0 = this->Levels[p];
+                        const int l1 = this->Levels[p + this->Strides[a]];
+                        for (int m = std::min(l0, l1); m < std::max(l0, l1); ++m)
+                        {
+                            ++before[q * numValues + m];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    ScalarAccess Scalars;
+    const ActiveBlockIndex* Blocks;
+    int Dimensions[3];
+    double Origin[3];
+    double Spacing[3];
+    vtkIdType Strides[3];
+    vtkIdType NumberOfPoints;
+    vtkIdType NumberOfRows;
+    vtkIdType NumberOfCellRows;
+    const CaseStrips* Strips;
+
+    // The values in ascending order, the output port of each and the sorted
+    // index of each port.
+    std::vector<double> Sorted;
+    std::vector<int> Order;
+    std::vector<int> Rank;
+
+    // One byte per point, see ComputeLevels(). The Row* arrays hold, per
+    // sorted value, the first vertex of each point row and the first strip
+    // and connectivity entry of each cell row, with the totals at the end.
+    std::vector<unsigned char> Levels;
+    std::vector<vtkIdType> RowVertices;
+    std::vector<vtkIdType> RowStrips;
+    std::vector<vtkIdType> RowConnectivity;
+};
+
+template <typename ScalarAccess>
+void ExtractSurfaces(const ScalarAccess& scalars, vtkImageData* image, const std::vector<double>& values,
+    const ActiveBlockIndex* blocks, bool computeNormals, const std::vector<vtkPolyData*>& outputs)
+{
+    IsoSurfaceExtractor<ScalarAccess> extractor(scalars, image, values, blocks);
+    extractor.Classify();
+
+    std::vector<SurfaceArrays> surfaces(values.size());
+    std::vector<vtkSmartPointer<vtkIdTypeArray>> offsets(values.size());
+    std::vector<vtkSmartPointer<vtkIdTypeArray>> connectivity(values.size());
+    for (size_t n = 0; n < values.size(); ++n)
+    {
+        const vtkIdType numVertices = extractor.GetNumberOfVertices(n);
+        const vtkIdType numStrips = extractor.GetNumberOfStrips(n);
+
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        points->SetDataTypeToFloat();
+        points->SetNumberOfPoints(numVertices);
+        outputs[n]->SetPoints(points);
+        surfaces[n].Points = vtkFloatArray::SafeDownCast(points->GetData())->GetPointer(0);
+
+        if (computeNormals)
+        {
+            vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+            normals->SetName("Normals");
+            normals->SetNumberOfComponents(3);
+            normals->SetNumberOfTuples(numVertices);
+            outputs[n]->GetPointData()->SetNormals(normals);
+            surfaces[n].Normals = normals->GetPointer(0);
+        }
+
+        offsets[n] = vtkSmartPointer<vtkIdTypeArray>::New();
+        offsets[n]->SetNumberOfValues(numStrips + 1);
+        offsets[n]->SetValue(numStrips, extractor.GetConnectivitySize(n));
+        connectivity[n] = vtkSmartPointer<vtkIdTypeArray>::New();
+        connectivity[n]->SetNumberOfValues(extractor.GetConnectivitySize(n));
+        surfaces[n].Offsets = offsets[n]->GetPointer(0);
+        surfaces[n].Connectivity = connectivity[n]->GetPointer(0);
+    }
+
+    extractor.Generate(surfaces);
+
+    for (size_t n = 0; n < values.size(); ++n)
+    {
+        vtkSmartPointer<vtkCellArray> strips = vtkSmartPointer<vtkCellArray>::New();
+        strips->SetData(offsets[n].GetPointer(), connectivity[n].GetPointer());
+        outputs[n]->SetStrips(strips);
+    }
+}
+
+} // namespace
+
+vtkMultiIsoSurface::vtkMultiIsoSurface()
+{
+    this->SetInputArrayToProcess(
+        0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS);
+}
+
+void vtkMultiIsoSurface::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "Values:";
+    for (double value : this->Values)
+    {
+        os << " " << value;
+    }
+    os << "\n";
+    os << indent << "ComputeNormals: " << this->ComputeNormals << "\n";
+    os << indent << "ActiveBlocks: " << this->ActiveBlocks.get() << "\n";
+    os << indent << "BrickScalars: " << this->BrickScalars << "\n";
+}
+
+void vtkMultiIsoSurface::SetActiveBlocks(std::shared_ptr<const ActiveBlockIndex> blocks)
+{
+    if (this->ActiveBlocks != blocks)
+    {
+        this->ActiveBlocks = blocks;
+        this->Modified();
+    }
+}
+
+void vtkMultiIsoSurface::SetValue(int i, double value)
+{
+    if (i < 0 || i >= MaximumNumberOfContours)
+    {
+        return;
+    }
+    if (i >= this->GetNumberOfContours())
+    {
+        this->SetNumberOfContours(i + 1);
+    }
+    if (this->Values[i] != value)
+    {
+        this->Values[i] = value;
+        this->Modified();
+    }
+}
+
+double vtkMultiIsoSurface::GetValue(int i) const
+{
+    return (i >= 0 && i < this->GetNumberOfContours()) ? this->Values[i] : 0.0;
+}
+
+void vtkMultiIsoSurface::SetNumberOfContours(int number)
+{
+    number = std::min(std::max(number, 0), static_cast<int>(MaximumNumberOfContours));
+    if (number == this->GetNumberOfContours())
+    {
+        return;
+    }
+    this->Values.resize(number, 0.0);
+    this->SetNumberOfOutputPorts(std::max(number, 1));
+    this->Modified();
+}
+
+int vtkMultiIsoSurface::FillInputPortInformation(int, vtkInformation* info)
+{
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+    return 1;
+}
+
+int vtkMultiIsoSurface::RequestData(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkImageData* input = vtkImageData::GetData(inputVector[0]);
+    vtkDataArray* scalars = this->GetInputArrayToProcess(0, inputVector);
+
+    std::vector<vtkPolyData*> outputs;
+    for (int i = 0; i < this->GetNumberOfContours(); ++i)
+    {
+        outputs.push_back(vtkPolyData::GetData(outputVector, i));
+    }
+
+    int dims[3] = { 0, 0, 0 };
+    if (input)
+    {
+        input->GetDimensions(dims);
+    }
+    if (!scalars)
+    {
+        vtkErrorMacro(<< "No input scalars");
+        return 1;
+    }
+    // Flat volumes have no cells.
+    if (outputs.empty() || dims[0] < 2 || dims[1] < 2 || dims[2] < 2)
+    {
+        return 1;
+    }
+
+    const ActiveBlockIndex* blocks = this->ActiveBlocks.get();
+    if (blocks && !std::equal(dims, dims + 3, blocks->GetDimensions()))
+    {
+        vtkWarningMacro(<< "Active block index is for another grid; ignoring it");
+        blocks = nullptr;
+    }
+
+    if (this->BrickScalars)
+    {
+        if (!this->BrickedCopy || scalars != this->BrickedArray || scalars->GetMTime() != this->BrickedMTime)
+        {
+            this->BrickedCopy = std::make_shared<BrickedFloatStorage<1>>();
+            this->BrickedCopy->Assign(scalars, dims);
+            this->BrickedArray = scalars;
+            this->BrickedMTime = scalars->GetMTime();
+        }
+        const BrickedScalars bricked = { this->BrickedCopy.get() };
+        ExtractSurfaces(bricked, input, this->Values, blocks, this->ComputeNormals, outputs);
+        return 1;
+    }
+    this->BrickedCopy.reset();
+    this->BrickedArray = nullptr;
+
+    switch (scalars->GetDataType())
+    {
+        vtkTemplateMacro(ExtractSurfaces(ArrayScalars<VTK_TT>(static_cast<const VTK_TT*>(scalars->GetVoidPointer(0)),
+                                             scalars->GetNumberOfComponents()),
+            input, this->Values, blocks, this->ComputeNormals, outputs));
+        default:
+            vtkErrorMacro(<< "Unsupported scalar type " << scalars->GetDataTypeAsString());
+            break;
+    }
+    return 1;
+}
@@ -0,0 +1,102 @@
+// vtkMultiIsoSurface - several isosurfaces of an image in one traversal
+//
+// Marching cubes for N isovalues at once, with one output port per value.
+// Each scalar is read once and classified against all values into a single
+// byte, so adding a surface costs neither memory per point nor another sweep
+// over the volume:
+//   1. per point row, in parallel: the level of each point, i.e. the number
+//      of values at or below its scalar. An edge crosses exactly the values
+//      between the levels of its ends, and a cell only the values between
+//      the lowest and highest level of its corners. A second parallel pass
+//      over the levels counts per row and value the crossings and strip
+//      entries, visiting only the values each edge and cell crosses;
+//   2. prefix sums over the rows give every row its first output vertex,
+//      strip and connectivity entry for each value;
+//   3. per point row, in parallel: the crossings are interpolated into
+//      points (and gradient normals), and the cells of the row are emitted.
+//      Scalars are only read again at crossings.
+// A crossing on an edge is one output point however many cells share the
+// edge; cells find its id by counting crossings along the neighbouring rows,
+// so the surfaces come out welded without a point locator.
+//
+// The triangles of each cell are chained into triangle strips from a table
+// built once from vtkMarchingCubesTriangleCases, which replaces a separate
+// vtkStripper pass. Strips do not continue across cells.
+//
+// With an ActiveBlockIndex for the input grid, only cells in active blocks
+// are contoured and points away from them are never read, so the work
+// follows the active volume. Use a scalar threshold at or below the lowest
+// value to get the same surfaces as without the index.
+//
+// With BrickScalars on, the extractor reads a float copy of the scalars in
+// BrickedFloatStorage, where the corners of a cell and the neighbours along
+// y and z that the normals need are close in memory instead of a row or a
+// slice apart. The copy is kept until the scalars change.
+//
+// Triangles and normals follow vtkMarchingCubes; the output does not depend
+// on the number of threads.
+
+#ifndef vtkMultiIsoSurface_h
+#define vtkMultiIsoSurface_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+#include <memory>
+#include <vector>
+
+class ActiveBlockIndex;
+class vtkDataArray;
+template <int Components>
+class BrickedFloatStorage;
+
+class vtkMultiIsoSurface : public vtkPolyDataAlgorithm
+{
+public:
+    static vtkMultiIsoSurface* New();
+    vtkTypeMacro(vtkMultiIsoSurface, vtkPolyDataAlgorithm);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    // Surface i goes to output port i. Setting a value past the end adds
+    // ports, up to MaximumNumberOfContours.
+    void SetValue(int i, double value);
+    double GetValue(int i) const;
+
+    static const int MaximumNumberOfContours = 255;
+    void SetNumberOfContours(int number);
+    int GetNumberOfContours() const { return static_cast<int>(this->Values.size()); }
+
+    vtkSetMacro(ComputeNormals, bool);
+    vtkGetMacro(ComputeNormals, bool);
+    vtkBooleanMacro(ComputeNormals, bool);
+
+    // Optional; ignored when built for a grid of other dimensions.
+    void SetActiveBlocks(std::shared_ptr<const ActiveBlockIndex> blocks);
+    std::shared_ptr<const ActiveBlockIndex> GetActiveBlocks() const { return this->ActiveBlocks; }
+
+    vtkSetMacro(BrickScalars, bool);
+    vtkGetMacro(BrickScalars, bool);
+    vtkBooleanMacro(BrickScalars, bool);
+
+protected:
+    vtkMultiIsoSurface();
+    ~vtkMultiIsoSurface() override = default;
+
+    int FillInputPortInformation(int port, vtkInformation* info) override;
+    int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+    std::vector<double> Values;
+    bool ComputeNormals = true;
+    std::shared_ptr<const ActiveBlockIndex> ActiveBlocks;
+    bool BrickScalars = false;
+
+    // Bricked copy of BrickedArray as of its modification time BrickedMTime.
+    std::shared_ptr<BrickedFloatStorage<1>> BrickedCopy;
+    vtkDataArray* BrickedArray = nullptr;
+    vtkMTimeType BrickedMTime = 0;
+
+private:
+    vtkMultiIsoSurface(const vtkMultiIsoSurface&) = delete;
+    void operator=(const vtkMultiIsoSurface&) = delete;
+};
+
+#endif
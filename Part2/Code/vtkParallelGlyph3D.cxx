@@ -0,0 +1,432 @@
+#include "vtkParallelGlyph3D.h"
+
+#include "FlowField.h"
+#include "ReplicatedPointData.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataSet.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+vtkStandardNewMacro(vtkParallelGlyph3D);
+
+namespace
+{
+
+// One cell array of the source flattened into plain offsets/connectivity, and
+// the matching preallocated output arrays.
+struct GlyphCells
+{
+    std::vector<vtkIdType> Offsets; // numberOfCells + 1 entries
+    std::vector<vtkIdType> Connectivity;
+    vtkSmartPointer<vtkIdTypeArray> OutOffsets;
+    vtkSmartPointer<vtkIdTypeArray> OutConnectivity;
+
+    vtkIdType GetNumberOfCells() const { return static_cast<vtkIdType>(this->Offsets.size()) - 1; }
+
+    void Flatten(vtkCellArray* cells)
+    {
+        this->Offsets.assign(1, 0);
+        this->Connectivity.clear();
+        if (!cells)
+        {
+            return;
+        }
+        vtkIdType npts;
+        const vtkIdType* pts;
+        for (cells->InitTraversal(); cells->GetNextCell(npts, pts);)
+        {
+            this->Connectivity.insert(this->Connectivity.end(), pts, pts + npts);
+            this->Offsets.push_back(static_cast<vtkIdType>(this->Connectivity.size()));
+        }
+    }
+
+    void Allocate(vtkIdType numberOfGlyphs)
+    {
+        if (this->GetNumberOfCells() == 0)
+        {
+            return;
+        }
+        this->OutOffsets = vtkSmartPointer<vtkIdTypeArray>::New();
+        this->OutOffsets->SetNumberOfValues(numberOfGlyphs * this->GetNumberOfCells() + 1);
+        this->OutOffsets->SetValue(numberOfGlyphs * this->GetNumberOfCells(),
+            numberOfGlyphs * static_cast<vtkIdType>(this->Connectivity.size()));
+        this->OutConnectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+        this->OutConnectivity->SetNumberOfValues(numberOfGlyphs * static_cast<vtkIdType>(this->Connectivity.size()));
+    }
+
+    // Writes the cells of glyph `glyph`, whose points start at pointOffset.
+    void Write(vtkIdType glyph, vtkIdType pointOffset) const
+    {
+        if (!this->OutOffsets)
+        {
+            return;
+        }
+        const vtkIdType numCells = this->GetNumberOfCells();
+        const vtkIdType connSize = static_cast<vtkIdType>(this->Connectivity.size());
+        vtkIdType* offsets = this->OutOffsets->GetPointer(glyph * numCells);
+        vtkIdType* conn = this->OutConnectivity->GetPointer(glyph * connSize);
+        for (vtkIdType c = 0; c < numCells; ++c)
+        {
+            offsets[c] = glyph * connSize + this->Offsets[c];
+        }
+        for (vtkIdType c = 0; c < connSize; ++c)
+        {
+            conn[c] = pointOffset + this->Connectivity[c];
+        }
+    }
+
+    vtkSmartPointer<vtkCellArray> GetOutput() const
+    {
+        if (!this->OutOffsets)
+        {
+            return vtkSmartPointer<vtkCellArray>();
+        }
+        vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+        cells->SetData(this->OutOffsets.GetPointer(), this->OutConnectivity.GetPointer());
+        return cells;
+    }
+};
+
+// Per thread: the glyph transform and the transformed source, built with
+// the same vtkTransform calls as vtkGlyph3D so that the rounding matches.
+struct GlyphTransform
+{
+    vtkSmartPointer<vtkTransform> Transform;
+    vtkSmartPointer<vtkPoints> Points;
+    vtkSmartPointer<vtkFloatArray> Normals;
+};
+
+struct GlyphWorker
+{
+    vtkDataSet* Input;
+    vtkDataArray* InScalars;
+    vtkDataArray* InVectors;
+    const FlowVectorSource* VectorSource; // replaces InVectors if set
+    const ReplicatedPointData* PointData;
+    const GlyphCells* Cells; // verts, lines, polys, strips
+
+    vtkPoints* SourcePoints;
+    vtkDataArray* SourceNormals; // nullptr if the source has none
+    vtkIdType NumberOfSourcePoints;
+    vtkSMPThreadLocal<GlyphTransform> Local;
+
+    float* OutPoints;
+    float* OutNormals;
+    float* OutScalars;
+
+    double ScaleFactor;
+    int ScaleMode;
+    int ColorMode;
+    bool Orient;
+
+    // False if there are no vectors.
+    bool GetVector(vtkIdType ptId, double v[3]) const
+    {
+        if (this->VectorSource)
+        {
+            this->VectorSource->GetVector(ptId, v);
+            return true;
+        }
+        if (this->InVectors)
+        {
+            this->InVectors->GetTuple(ptId, v);
+            return true;
+        }
+        return false;
+    }
+
+    void Initialize()
+    {
+        GlyphTransform& local = this->Local.Local();
+        local.Transform = vtkSmartPointer<vtkTransform>::New();
+        local.Points = vtkSmartPointer<vtkPoints>::New();
+        local.Points->SetDataTypeToFloat();
+        local.Normals = vtkSmartPointer<vtkFloatArray>::New();
+        local.Normals->SetNumberOfComponents(3);
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        const vtkIdType nsp = this->NumberOfSourcePoints;
+        GlyphTransform& local = this->Local.Local();
+        vtkTransform* trans = local.Transform;
+
+        for (vtkIdType ptId = begin; ptId < end; ++ptId)
+        {
+            double x[3];
+            this->Input->GetPoint(ptId, x);
+
+            // Same scaling rules as vtkGlyph3D.
+            double scale = 1.0;
+            double s = 0.0;
+            if (this->InScalars)
+            {
+                s = this->InScalars->GetComponent(ptId, 0);
+                if (this->ScaleMode == VTK_PARALLEL_GLYPH_SCALE_BY_SCALAR)
+                {
+                    scale = s;
+                }
+            }
+
+            double v[3] = { 0.0, 0.0, 0.0 };
+            double vMag = 0.0;
+            const bool hasVector = this->GetVector(ptId, v);
+            if (hasVector)
+            {
+                vMag = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                if (this->ScaleMode == VTK_PARALLEL_GLYPH_SCALE_BY_VECTOR)
+                {
+                    scale = vMag;
+                }
+            }
+
+            double dataScale = scale;
+            if (this->ScaleMode == VTK_PARALLEL_GLYPH_DATA_SCALING_OFF)
+            {
+                scale = this->ScaleFactor;
+            }
+            else
+            {
+                scale *= this->ScaleFactor;
+            }
+            if (scale == 0.0)
+            {
+                scale = 1.0e-10;
+            }
+
+            // Like vtkGlyph3D: move to x, turn the x axis onto v by a half
+            // turn about their bisector, then scale.
+            trans->Identity();
+            trans->Translate(x[0], x[1], x[2]);
+            if (this->Orient && hasVector && vMag > 0.0)
+            {
+                if (v[1] == 0.0 && v[2] == 0.0)
+                {
+                    if (v[0] < 0.0)
+                    {
+                        trans->RotateWXYZ(180.0, 0.0, 1.0, 0.0);
+                    }
+                }
+                else
+                {
+                    trans->RotateWXYZ(180.0, (v[0] + vMag) / 2.0, v[1] / 2.0, v[2] / 2.0);
+                }
+            }
+            trans->Scale(scale, scale, scale);
+
+            const vtkIdType outBegin = ptId * nsp;
+            local.Points->Reset();
+            trans->TransformPoints(this->SourcePoints, local.Points);
+            const float* points = vtkFloatArray::SafeDownCast(local.Points->GetData())->GetPointer(0);
+            std::copy(points, points + 3 * nsp, this->OutPoints + 3 * outBegin);
+
+            if (this->OutNormals)
+            {
+                local.Normals->Reset();
+                trans->TransformNormals(this->SourceNormals, local.Normals);
+                const float* normals = local.Normals->GetPointer(0);
+                std::copy(normals, normals + 3 * nsp, this->OutNormals + 3 * outBegin);
+            }
+
+            if (this->OutScalars)
+            {
+                float value = static_cast<float>(dataScale);
+                if (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_SCALAR)
+                {
+                    value = static_cast<float>(s);
+                }
+                else if (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_VECTOR)
+                {
+                    value = static_cast<float>(vMag);
+                }
+                std::fill(this->OutScalars + outBegin, this->OutScalars + outBegin + nsp, value);
+            }
+
+            for (int c = 0; c < 4; ++c)
+            {
+                this->Cells[c].Write(ptId, outBegin);
+            }
+            this->PointData->Copy(ptId, outBegin, nsp);
+        }
+    }
+
+    void Reduce() {}
+};
+
+} // namespace
+
+vtkParallelGlyph3D::vtkParallelGlyph3D()
+{
+    this->SetNumberOfInputPorts(2);
+    this->SetInputArrayToProcess(
+        0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS);
+    this->SetInputArrayToProcess(
+        1, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::VECTORS);
+}
+
+void vtkParallelGlyph3D::SetSourceConnection(vtkAlgorithmOutput* algOutput)
+{
+    this->SetInputConnection(1, algOutput);
+}
+
+void vtkParallelGlyph3D::SetSourceData(vtkPolyData* source)
+{
+    this->SetInputData(1, source);
+}
+
+int vtkParallelGlyph3D::FillInputPortInformation(int port, vtkInformation* info)
+{
+    if (port == 0)
+    {
+        info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkDataSet");
+        return 1;
+    }
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+}
+
+int vtkParallelGlyph3D::RequestData(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkDataSet* input = vtkDataSet::GetData(inputVector[0]);
+    vtkPolyData* source = vtkPolyData::GetData(inputVector[1]);
+    vtkPolyData* output = vtkPolyData::GetData(outputVector);
+
+    const vtkIdType numPts = input ? input->GetNumberOfPoints() : 0;
+    if (numPts < 1 || !source || !source->GetPoints())
+    {
+        return 1;
+    }
+
+    vtkDataArray* inScalars = this->GetInputArrayToProcess(0, inputVector);
+    vtkDataArray* inVectors = this->GetInputArrayToProcess(1, inputVector);
+    const FlowVectorSource* vectorSource =
+        (this->VectorSource && this->VectorSource->GetNumberOfPoints() == numPts) ? this->VectorSource.get() : nullptr;
+
+    const vtkIdType nsp = source->GetNumberOfPoints();
+    vtkDataArray* srcNormals = source->GetPointData()->GetNormals();
+
+    GlyphCells cells[4];
+    cells[0].Flatten(source->GetVerts());
+    cells[1].Flatten(source->GetLines());
+    cells[2].Flatten(source->GetPolys());
+    cells[3].Flatten(source->GetStrips());
+    for (GlyphCells& c : cells)
+    {
+        c.Allocate(numPts);
+    }
+
+    // Everything below has its final size before any worker starts.
+    const vtkIdType numOut = numPts * nsp;
+
+    vtkSmartPointer<vtkPoints> newPts = vtkSmartPointer<vtkPoints>::New();
+    newPts->SetDataTypeToFloat();
+    newPts->SetNumberOfPoints(numOut);
+
+    vtkSmartPointer<vtkFloatArray> newNormals;
+    if (srcNormals)
+    {
+        newNormals = vtkSmartPointer<vtkFloatArray>::New();
+        newNormals->SetName("Normals");
+        newNormals->SetNumberOfComponents(3);
+        newNormals->SetNumberOfTuples(numOut);
+    }
+
+    vtkSmartPointer<vtkFloatArray> newScalars;
+    if ((this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_SCALE && inScalars) ||
+        (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_SCALAR && inScalars) ||
+        (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_VECTOR && (inVectors || vectorSource)))
+    {
+        newScalars = vtkSmartPointer<vtkFloatArray>::New();
+        newScalars->SetNumberOfTuples(numOut);
+        if (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_SCALE)
+        {
+            newScalars->SetName("GlyphScale");
+        }
+        else if (this->ColorMode == VTK_PARALLEL_GLYPH_COLOR_BY_SCALAR)
+        {
+            newScalars->SetName("GlyphScalar");
+        }
+        else
+        {
+            newScalars->SetName("GlyphVector");
+        }
+    }
+
+    vtkPointData* outPD = output->GetPointData();
+    ReplicatedPointData pointData;
+    pointData.Allocate(input->GetPointData(), outPD, numOut, newScalars ? inScalars : nullptr);
+
+    // Make the first GetPoint() call from this thread, as vtkDataSet requires
+    // before it is called concurrently.
+    double x0[3];
+    input->GetPoint(0, x0);
+
+    GlyphWorker worker;
+    worker.Input = input;
+    worker.InScalars = inScalars;
+    worker.InVectors = inVectors;
+    worker.VectorSource = vectorSource;
+    worker.PointData = &pointData;
+    worker.Cells = cells;
+    worker.SourcePoints = source->GetPoints();
+    worker.SourceNormals = srcNormals;
+    worker.NumberOfSourcePoints = nsp;
+    worker.OutPoints = vtkFloatArray::SafeDownCast(newPts->GetData())->GetPointer(0);
+    worker.OutNormals = newNormals ? newNormals->GetPointer(0) : nullptr;
+    worker.OutScalars = newScalars ? newScalars->GetPointer(0) : nullptr;
+    worker.ScaleFactor = this->ScaleFactor;
+    worker.ScaleMode = this->ScaleMode;
+    worker.ColorMode = this->ColorMode;
+    worker.Orient = this->Orient;
+
+    vtkSMPTools::For(0, numPts, worker);
+
+    output->SetPoints(newPts);
+    output->SetVerts(cells[0].GetOutput());
+    output->SetLines(cells[1].GetOutput());
+    output->SetPolys(cells[2].GetOutput());
+    output->SetStrips(cells[3].GetOutput());
+    if (newNormals)
+    {
+        outPD->SetNormals(newNormals);
+    }
+    if (newScalars)
+    {
+        outPD->SetScalars(newScalars);
+    }
+    return 1;
+}
+
+void vtkParallelGlyph3D::SetVectorSource(std::shared_ptr<const FlowVectorSource> source)
+{
+    if (this->VectorSource != source)
+    {
+        this->VectorSource = source;
+        this->Modified();
+    }
+}
+
+void vtkParallelGlyph3D::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "ScaleFactor: " << this->ScaleFactor << "\n";
+    os << indent << "ScaleMode: " << this->ScaleMode << "\n";
+    os << indent << "ColorMode: " << this->ColorMode << "\n";
+    os << indent << "Orient: " << (this->Orient ? "On" : "Off") << "\n";
+    os << indent << "VectorSource: " << this->VectorSource.get() << "\n";
+}
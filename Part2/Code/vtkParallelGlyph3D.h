@@ -0,0 +1,90 @@
+// vtkParallelGlyph3D - multithreaded replacement for vtkGlyph3D
+//
+// Copies an oriented, scaled source polydata to every input point like
+// vtkGlyph3D does for the cases flowVis uses (scale by vector or scalar,
+// orient by vector, color by scale, scalar or vector). The output size is
+// known up front (input points x source points), so vtkSMPTools workers write
+// every glyph straight into preallocated arrays at a fixed offset. There is no
+// merge step and every output value depends only on its input point, which
+// makes the output bit-identical for any number of threads. Each thread
+// builds the glyph transform with vtkTransform exactly as vtkGlyph3D does, so
+// points and normals also match vtkGlyph3D bit for bit.
+//
+// A FlowVectorSource set with SetVectorSource() replaces the vectors to
+// process, e.g. a float16 or block-quantized copy that the workers decode
+// point by point.
+
+#ifndef vtkParallelGlyph3D_h
+#define vtkParallelGlyph3D_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+#include <memory>
+
+#define VTK_PARALLEL_GLYPH_SCALE_BY_SCALAR 0
+#define VTK_PARALLEL_GLYPH_SCALE_BY_VECTOR 1
+#define VTK_PARALLEL_GLYPH_DATA_SCALING_OFF 2
+
+#define VTK_PARALLEL_GLYPH_COLOR_BY_SCALE 0
+#define VTK_PARALLEL_GLYPH_COLOR_BY_SCALAR 1
+#define VTK_PARALLEL_GLYPH_COLOR_BY_VECTOR 2
+#define VTK_PARALLEL_GLYPH_COLOR_OFF 3
+
+class FlowVectorSource;
+
+class vtkParallelGlyph3D : public vtkPolyDataAlgorithm
+{
+public:
+    static vtkParallelGlyph3D* New();
+    vtkTypeMacro(vtkParallelGlyph3D, vtkPolyDataAlgorithm);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    // The glyph geometry, e.g. a vtkConeSource or vtkArrowSource.
+    void SetSourceConnection(vtkAlgorithmOutput* algOutput);
+    void SetSourceData(vtkPolyData* source);
+
+    vtkSetMacro(ScaleFactor, double);
+    vtkGetMacro(ScaleFactor, double);
+
+    vtkSetClampMacro(ScaleMode, int, VTK_PARALLEL_GLYPH_SCALE_BY_SCALAR, VTK_PARALLEL_GLYPH_DATA_SCALING_OFF);
+    vtkGetMacro(ScaleMode, int);
+    void SetScaleModeToScaleByScalar() { this->SetScaleMode(VTK_PARALLEL_GLYPH_SCALE_BY_SCALAR); }
+    void SetScaleModeToScaleByVector() { this->SetScaleMode(VTK_PARALLEL_GLYPH_SCALE_BY_VECTOR); }
+    void SetScaleModeToDataScalingOff() { this->SetScaleMode(VTK_PARALLEL_GLYPH_DATA_SCALING_OFF); }
+
+    // ColorOff generates no scalars and copies the input scalars instead.
+    vtkSetClampMacro(ColorMode, int, VTK_PARALLEL_GLYPH_COLOR_BY_SCALE, VTK_PARALLEL_GLYPH_COLOR_OFF);
+    vtkGetMacro(ColorMode, int);
+    void SetColorModeToColorByScale() { this->SetColorMode(VTK_PARALLEL_GLYPH_COLOR_BY_SCALE); }
+    void SetColorModeToColorByScalar() { this->SetColorMode(VTK_PARALLEL_GLYPH_COLOR_BY_SCALAR); }
+    void SetColorModeToColorByVector() { this->SetColorMode(VTK_PARALLEL_GLYPH_COLOR_BY_VECTOR); }
+    void SetColorModeToColorOff() { this->SetColorMode(VTK_PARALLEL_GLYPH_COLOR_OFF); }
+
+    // Rotate each glyph so that its x axis follows the input vector.
+    vtkSetMacro(Orient, bool);
+    vtkGetMacro(Orient, bool);
+    vtkBooleanMacro(Orient, bool);
+
+    // Optional; ignored unless it has one vector per input point.
+    void SetVectorSource(std::shared_ptr<const FlowVectorSource> source);
+    std::shared_ptr<const FlowVectorSource> GetVectorSource() const { return this->VectorSource; }
+
+protected:
+    vtkParallelGlyph3D();
+    ~vtkParallelGlyph3D() override = default;
+
+    int FillInputPortInformation(int port, vtkInformation* info) override;
+    int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+    double ScaleFactor = 1.0;
+    int ScaleMode = VTK_PARALLEL_GLYPH_SCALE_BY_SCALAR;
+    int ColorMode = VTK_PARALLEL_GLYPH_COLOR_BY_SCALE;
+    bool Orient = true;
+    std::shared_ptr<const FlowVectorSource> VectorSource;
+
+private:
+    vtkParallelGlyph3D(const vtkParallelGlyph3D&) = delete;
+    void operator=(const vtkParallelGlyph3D&) = delete;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "vtkParallelHedgeHog.h"
+
+#include "FlowField.h"
+#include "ReplicatedPointData.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataSet.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+
+vtkStandardNewMacro(vtkParallelHedgeHog);
+
+namespace
+{
+
+struct HedgeHogWorker
+{
+    vtkDataSet* Input;
+    vtkDataArray* InVectors;
+    const FlowVectorSource* VectorSource; // replaces InVectors if set
+    const ReplicatedPointData* PointData;
+    double ScaleFactor;
+    vtkIdType NumberOfPoints;
+
+    float* OutPoints;
+    vtkIdType* OutOffsets;
+    vtkIdType* OutConnectivity;
+
+    void operator()(vtkIdType begin, vtkIdType end) const
+    {
+        for (vtkIdType ptId = begin; ptId < end; ++ptId)
+        {
+            double x[3];
+            double v[3];
+            this->Input->GetPoint(ptId, x);
+            if (this->VectorSource)
+            {
+                this->VectorSource->GetVector(ptId, v);
+            }
+            else
+            {
+                this->InVectors->GetTuple(ptId, v);
+            }
+
+            // Same order as vtkHedgeHog: the line ends after all starts.
+            const vtkIdType endId = ptId + this->NumberOfPoints;
+            for (int i = 0; i < 3; ++i)
+            {
+                this->OutPoints[3 * ptId + i] = static_cast<float>(x[i]);
+                this->OutPoints[3 * endId + i] = static_cast<float>(x[i] + this->ScaleFactor * v[i]);
+            }
+
+            this->OutOffsets[ptId] = 2 * ptId;
+            this->OutConnectivity[2 * ptId] = ptId;
+            this->OutConnectivity[2 * ptId + 1] = endId;
+
+            this->PointData->Copy(ptId, ptId, 1);
+            this->PointData->Copy(ptId, endId, 1);
+        }
+    }
+};
+
+} // namespace
+
+int vtkParallelHedgeHog::FillInputPortInformation(int, vtkInformation* info)
+{
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkDataSet");
+    return 1;
+}
+
+int vtkParallelHedgeHog::RequestData(
+    vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+    vtkDataSet* input = vtkDataSet::GetData(inputVector[0]);
+    vtkPolyData* output = vtkPolyData::GetData(outputVector);
+
+    const vtkIdType numPts = input ? input->GetNumberOfPoints() : 0;
+    vtkPointData* pd = input ? input->GetPointData() : nullptr;
+    vtkDataArray* inVectors = nullptr;
+    if (pd)
+    {
+        inVectors = (this->VectorMode == VTK_PARALLEL_HEDGEHOG_USE_VECTOR) ? pd->GetVectors() : pd->GetNormals();
+    }
+    const FlowVectorSource* vectorSource = nullptr;
+    if (this->VectorMode == VTK_PARALLEL_HEDGEHOG_USE_VECTOR && this->VectorSource &&
+        this->VectorSource->GetNumberOfPoints() == numPts)
+    {
+        vectorSource = this->VectorSource.get();
+    }
+    if (numPts < 1 || !(inVectors || vectorSource))
+    {
+        vtkErrorMacro(<< "No input data");
+        return 1;
+    }
+
+    vtkSmartPointer<vtkPoints> newPts = vtkSmartPointer<vtkPoints>::New();
+    newPts->SetDataTypeToFloat();
+    newPts->SetNumberOfPoints(2 * numPts);
+
+    vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(numPts + 1);
+    offsets->SetValue(numPts, 2 * numPts);
+    vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(2 * numPts);
+
+    ReplicatedPointData pointData;
+    pointData.Allocate(pd, output->GetPointData(), 2 * numPts);
+
+    // Make the first GetPoint() call from this thread, as vtkDataSet requires
+    // before it is called concurrently.
+    double x0[3];
+    input->GetPoint(0, x0);
+
+    HedgeHogWorker worker;
+    worker.Input = input;
+    worker.InVectors = inVectors;
+    worker.VectorSource = vectorSource;
+    worker.PointData = &pointData;
+    worker.ScaleFactor = this->ScaleFactor;
+    worker.NumberOfPoints = numPts;
+    worker.OutPoints = vtkFloatArray::SafeDownCast(newPts->GetData())->GetPointer(0);
+    worker.OutOffsets = offsets->GetPointer(0);
+    worker.OutConnectivity = connectivity->GetPointer(0);
+
+    vtkSMPTools::For(0, numPts, worker);
+
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    lines->SetData(offsets.GetPointer(), connectivity.GetPointer());
+
+    output->SetPoints(newPts);
+    output->SetLines(lines);
+    return 1;
+}
+
+void vtkParallelHedgeHog::SetVectorSource(std::shared_ptr<const FlowVectorSource> source)
+{
+    if (this->VectorSource != source)
+    {
+        this->VectorSource = source;
+        this->Modified();
+    }
+}
+
+void vtkParallelHedgeHog::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "ScaleFactor: " << this->ScaleFactor << "\n";
+    os << indent << "VectorMode: " << (this->VectorMode == VTK_PARALLEL_HEDGEHOG_USE_VECTOR ? "Use Vector" : "Use Normal")
+       << "\n";
+    os << indent << "VectorSource: " << this->VectorSource.get() << "\n";
+}
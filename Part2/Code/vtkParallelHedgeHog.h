@@ -0,0 +1,62 @@
+// vtkParallelHedgeHog - multithreaded replacement for vtkHedgeHog
+//
+// Emits one line per input point, from the point to the point displaced by
+// its vector times ScaleFactor, exactly like vtkHedgeHog. Each input point
+// i owns output points i and i + N (N input points) and line i, as in
+// vtkHedgeHog, so vtkSMPTools workers write straight into preallocated
+// arrays and the output is the same as vtkHedgeHog's for any number of
+// threads.
+//
+// A FlowVectorSource set with SetVectorSource() replaces the input's vectors,
+// e.g. a float16 or block-quantized copy that the workers decode point by
+// point.
+
+#ifndef vtkParallelHedgeHog_h
+#define vtkParallelHedgeHog_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+#include <memory>
+
+#define VTK_PARALLEL_HEDGEHOG_USE_VECTOR 0
+#define VTK_PARALLEL_HEDGEHOG_USE_NORMAL 1
+
+class FlowVectorSource;
+
+class vtkParallelHedgeHog : public vtkPolyDataAlgorithm
+{
+public:
+    static vtkParallelHedgeHog* New();
+    vtkTypeMacro(vtkParallelHedgeHog, vtkPolyDataAlgorithm);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    vtkSetMacro(ScaleFactor, double);
+    vtkGetMacro(ScaleFactor, double);
+
+    vtkSetClampMacro(VectorMode, int, VTK_PARALLEL_HEDGEHOG_USE_VECTOR, VTK_PARALLEL_HEDGEHOG_USE_NORMAL);
+    vtkGetMacro(VectorMode, int);
+    void SetVectorModeToUseVector() { this->SetVectorMode(VTK_PARALLEL_HEDGEHOG_USE_VECTOR); }
+    void SetVectorModeToUseNormal() { this->SetVectorMode(VTK_PARALLEL_HEDGEHOG_USE_NORMAL); }
+
+    // Optional, used in vector mode; ignored unless it has one vector per
+    // input point.
+    void SetVectorSource(std::shared_ptr<const FlowVectorSource> source);
+    std::shared_ptr<const FlowVectorSource> GetVectorSource() const { return this->VectorSource; }
+
+protected:
+    vtkParallelHedgeHog() = default;
+    ~vtkParallelHedgeHog() override = default;
+
+    int FillInputPortInformation(int port, vtkInformation* info) override;
+    int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+    double ScaleFactor = 1.0;
+    int VectorMode = VTK_PARALLEL_HEDGEHOG_USE_VECTOR;
+    std::shared_ptr<const FlowVectorSource> VectorSource;
+
+private:
+    vtkParallelHedgeHog(const vtkParallelHedgeHog&) = delete;
+    void operator=(const vtkParallelHedgeHog&) = delete;
+};
+
+#endif
@@ -0,0 +1,354 @@
+#include "vtkParallelPolyDataWriter.h"
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkEndian.h"
+#include "vtkErrorCode.h"
+#include "vtkInformation.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkParallelPolyDataWriter);
+
+namespace
+{
+
+// One array in the appended data: its bytes and where they go, relative to
+// the '_' that starts the appended block. The size word precedes the bytes.
+struct AppendedBlock
+{
+    const char* Data;
+    vtkTypeUInt64 Size;
+    vtkTypeUInt64 Offset;
+};
+
+// A part of a block written by one worker.
+struct WriteTask
+{
+    const char* Data;
+    vtkTypeUInt64 Size;
+    vtkTypeUInt64 FileOffset;
+};
+
+const char* GetXMLTypeName(vtkDataArray* array)
+{
+    const bool wide = array->GetDataTypeSize() == 8;
+    switch (array->GetDataType())
+    {
+        case VTK_FLOAT:
+            return "Float32";
+        case VTK_DOUBLE:
+            return "Float64";
+        case VTK_CHAR:
+        case VTK_SIGNED_CHAR:
+            return "Int8";
+        case VTK_UNSIGNED_CHAR:
+            return "UInt8";
+        case VTK_SHORT:
+            return "Int16";
+        case VTK_UNSIGNED_SHORT:
+            return "UInt16";
+        case VTK_INT:
+            return "Int32";
+        case VTK_UNSIGNED_INT:
+            return "UInt32";
+        case VTK_LONG:
+        case VTK_LONG_LONG:
+        case VTK_ID_TYPE:
+            return wide ? "Int64" : "Int32";
+        case VTK_UNSIGNED_LONG:
+        case VTK_UNSIGNED_LONG_LONG:
+            return wide ? "UInt64" : "UInt32";
+        default:
+            return nullptr;
+    }
+}
+
+std::string EscapeAttribute(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '&':
+                escaped += "&amp;";
+                break;
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            case '"':
+                escaped += "&quot;";
+                break;
+            default:
+                escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Builds the XML header and the list of blocks in file order.
+class HeaderBuilder
+{
+public:
+    // Adds a DataArray element for `count` tuples of `array` starting at
+    // tuple `first`. Returns false for types XML PolyData cannot hold.
+    bool AddArray(const std::string& indent, vtkDataArray* array, const std::string& name, vtkIdType first,
+        vtkIdType count)
+    {
+        const char* type = GetXMLTypeName(array);
+        if (!type)
+        {
+            return false;
+        }
+        if (!array->HasStandardMemoryLayout())
+        {
+            vtkSmartPointer<vtkDataArray> copy = vtkSmartPointer<vtkDataArray>::Take(
+                vtkDataArray::CreateDataArray(array->GetDataType()));
+            copy->DeepCopy(array);
+            this->Copies.push_back(copy);
+            array = copy;
+        }
+
+        const int components = array->GetNumberOfComponents();
+        const vtkTypeUInt64 tupleSize = static_cast<vtkTypeUInt64>(components) * array->GetDataTypeSize();
+        AppendedBlock block;
+        block.Data = static_cast<const char*>(array->GetVoidPointer(0)) + first * tupleSize;
+        block.Size = count * tupleSize;
+        block.Offset = this->AppendedSize;
+        this->Blocks.push_back(block);
+        this->AppendedSize += sizeof(vtkTypeUInt64) + block.Size;
+
+        this->Header << indent << "<DataArray type=\"" << type << "\" Name=\"" << EscapeAttribute(name)
+                     << "\" NumberOfComponents=\"" << components << "\" format=\"appended\" offset=\""
+                     << block.Offset << "\"/>\n";
+        return true;
+    }
+
+    void AddAttributes(const std::string& indent, const char* element, vtkDataSetAttributes* attributes,
+        vtkIdType count)
+    {
+        // Names first, so the element can point at its active arrays.
+        std::vector<std::pair<vtkDataArray*, std::string>> arrays;
+        for (int i = 0; i < attributes->GetNumberOfArrays(); ++i)
+        {
+            vtkDataArray* array = attributes->GetArray(i);
+            if (array && GetXMLTypeName(array) && array->GetNumberOfTuples() >= count)
+            {
+                const char* name = array->GetName();
+                arrays.emplace_back(array, (name && *name) ? name : "Array" + std::to_string(i));
+            }
+        }
+
+        this->Header << indent << "<" << element;
+        const char* roles[] = { "Scalars", "Vectors", "Normals", "TCoords" };
+        vtkDataArray* active[] = { attributes->GetScalars(), attributes->GetVectors(), attributes->GetNormals(),
+            attributes->GetTCoords() };
+        for (int r = 0; r < 4; ++r)
+        {
+            for (const auto& entry : arrays)
+            {
+                if (entry.first == active[r])
+                {
+                    this->Header << " " << roles[r] << "=\"" << EscapeAttribute(entry.second) << "\"";
+                    break;
+                }
+            }
+        }
+        this->Header << ">\n";
+        for (const auto& entry : arrays)
+        {
+            this->AddArray(indent + "  ", entry.first, entry.second, 0, count);
+        }
+        this->Header << indent << "</" << element << ">\n";
+    }
+
+    // XML offsets are the ends of the cells: vtkCellArray's offsets without
+    // the leading 0.
+    void AddCells(const std::string& indent, const char* element, vtkCellArray* cells)
+    {
+        this->Header << indent << "<" << element << ">\n";
+        this->AddArray(indent + "  ", cells->GetConnectivityArray(), "connectivity", 0,
+            cells->GetNumberOfConnectivityIds());
+        this->AddArray(indent + "  ", cells->GetOffsetsArray(), "offsets", 1, cells->GetNumberOfCells());
+        this->Header << indent << "</" << element << ">\n";
+    }
+
+    std::ostringstream Header;
+    std::vector<AppendedBlock> Blocks;
+    std::vector<vtkSmartPointer<vtkDataArray>> Copies;
+    vtkTypeUInt64 AppendedSize = 0;
+};
+
+} // namespace
+
+vtkParallelPolyDataWriter::~vtkParallelPolyDataWriter()
+{
+    this->SetFileName(nullptr);
+}
+
+void vtkParallelPolyDataWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+    this->Superclass::PrintSelf(os, indent);
+    os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << "\n";
+    os << indent << "ChunkSize: " << this->ChunkSize << "\n";
+    os << indent << "FileSize: " << this->FileSize << "\n";
+}
+
+vtkPolyData* vtkParallelPolyDataWriter::GetInput()
+{
+    return vtkPolyData::SafeDownCast(this->Superclass::GetInput());
+}
+
+int vtkParallelPolyDataWriter::FillInputPortInformation(int, vtkInformation* info)
+{
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+}
+
+void vtkParallelPolyDataWriter::WriteData()
+{
+    this->FileSize = 0;
+    vtkPolyData* input = this->GetInput();
+    if (!input || !this->FileName)
+    {
+        vtkErrorMacro("No input or no file name.");
+        this->SetErrorCode(vtkErrorCode::NoFileNameError);
+        return;
+    }
+
+    const vtkIdType numPoints = input->GetNumberOfPoints();
+    vtkCellArray* sections[4] = { input->GetVerts(), input->GetLines(), input->GetStrips(), input->GetPolys() };
+    const char* sectionNames[4] = { "Verts", "Lines", "Strips", "Polys" };
+    vtkSmartPointer<vtkCellArray> empty = vtkSmartPointer<vtkCellArray>::New();
+    for (vtkCellArray*& cells : sections)
+    {
+        cells = cells ? cells : empty.GetPointer();
+    }
+
+#ifdef VTK_WORDS_BIGENDIAN
+    const char* byteOrder = "BigEndian";
+#else
+    const char* byteOrder = "LittleEndian";
+#endif
+
+    HeaderBuilder builder;
+    std::ostringstream& header = builder.Header;
+    header << "<?xml version=\"1.0\"?>\n";
+    header << "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"" << byteOrder
+           << "\" header_type=\"UInt64\">\n";
+    header << "  <PolyData>\n";
+    header << "    <Piece NumberOfPoints=\"" << numPoints << "\" NumberOfVerts=\"" << sections[0]->GetNumberOfCells()
+           << "\" NumberOfLines=\"" << sections[1]->GetNumberOfCells() << "\" NumberOfStrips=\""
+           << sections[2]->GetNumberOfCells() << "\" NumberOfPolys=\"" << sections[3]->GetNumberOfCells()
+           << "\">\n";
+    builder.AddAttributes("      ", "PointData", input->GetPointData(), numPoints);
+    // vtkPolyData numbers polys before strips, the file stores strips first.
+    if (sections[2]->GetNumberOfCells() > 0 && sections[3]->GetNumberOfCells() > 0 &&
+        input->GetCellData()->GetNumberOfArrays() > 0)
+    {
+        vtkWarningMacro("Cell data of polydata with both strips and polys is not written.");
+    }
+    else
+    {
+        builder.AddAttributes("      ", "CellData", input->GetCellData(), input->GetNumberOfCells());
+    }
+    if (input->GetPoints())
+    {
+        header << "      <Points>\n";
+        if (!builder.AddArray("        ", input->GetPoints()->GetData(), "Points", 0, numPoints))
+        {
+            vtkErrorMacro("Unsupported point type.");
+            this->SetErrorCode(vtkErrorCode::UnknownError);
+            return;
+        }
+        header << "      </Points>\n";
+    }
+    for (int s = 0; s < 4; ++s)
+    {
+        builder.AddCells("      ", sectionNames[s], sections[s]);
+    }
+    header << "    </Piece>\n";
+    header << "  </PolyData>\n";
+    header << "  <AppendedData encoding=\"raw\">\n   _";
+    const std::string headerText = header.str();
+    const std::string footer = "\n  </AppendedData>\n</VTKFile>\n";
+    const vtkTypeUInt64 dataStart = headerText.size();
+    const vtkTypeUInt64 fileSize = dataStart + builder.AppendedSize + footer.size();
+
+    // Serial part: the header, the size word of every block and the footer,
+    // which also gives the file its final size.
+    {
+        std::ofstream file(this->FileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            vtkErrorMacro("Cannot open " << this->FileName);
+            this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+            return;
+        }
+        file.write(headerText.data(), headerText.size());
+        for (const AppendedBlock& block : builder.Blocks)
+        {
+            file.seekp(static_cast<std::streamoff>(dataStart + block.Offset));
+            file.write(reinterpret_cast<const char*>(&block.Size), sizeof(block.Size));
+        }
+        file.seekp(static_cast<std::streamoff>(dataStart + builder.AppendedSize));
+        file.write(footer.data(), footer.size());
+        if (!file)
+        {
+            vtkErrorMacro("Error writing " << this->FileName);
+            this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
+            return;
+        }
+    }
+
+    // Parallel part: the array bytes, straight from the arrays.
+    std::vector<WriteTask> tasks;
+    const vtkTypeUInt64 chunkSize = static_cast<vtkTypeUInt64>(this->ChunkSize);
+    for (const AppendedBlock& block : builder.Blocks)
+    {
+        const vtkTypeUInt64 start = dataStart + block.Offset + sizeof(vtkTypeUInt64);
+        for (vtkTypeUInt64 done = 0; done < block.Size; done += chunkSize)
+        {
+            tasks.push_back({ block.Data + done, std::min(chunkSize, block.Size - done), start + done });
+        }
+    }
+
+    std::atomic<bool> failed(false);
+    const std::string fileName = this->FileName;
+    vtkSMPTools::For(0, static_cast<vtkIdType>(tasks.size()), 1, [&](vtkIdType begin, vtkIdType end) {
+        std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+        for (vtkIdType t = begin; t < end && file; ++t)
+        {
+            file.seekp(static_cast<std::streamoff>(tasks[t].FileOffset));
+            file.write(tasks[t].Data, static_cast<std::streamsize>(tasks[t].Size));
+        }
+        file.flush();
+        if (!file)
+        {
+            failed = true;
+        }
+    });
+    if (failed)
+    {
+        vtkErrorMacro("Error writing " << this->FileName);
+        this->SetErrorCode(vtkErrorCode::OutOfDiskSpaceError);
+        return;
+    }
+    this->FileSize = fileSize;
+}
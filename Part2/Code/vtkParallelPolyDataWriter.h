@@ -0,0 +1,62 @@
+// vtkParallelPolyDataWriter - multithreaded writer for binary .vtp files
+//
+// Writes a vtkPolyData as VTK XML PolyData with all arrays in one appended
+// raw block (no base64, no compression), the layout vtkXMLPolyDataWriter
+// produces with SetDataModeToAppended(), EncodeAppendedDataOff() and no
+// compressor, so the files open in ParaView and vtkXMLPolyDataReader.
+//
+// The XML header is small and written first; its offsets fix where every
+// array lands in the file. The array bytes are then copied from the arrays'
+// own memory into their ranges of the file by vtkSMPTools workers, in
+// chunks of ChunkSize bytes, each through its own file handle. Nothing is
+// converted or buffered: the XML offsets arrays of the cells are the
+// vtkCellArray offsets without their leading 0. Arrays without a contiguous
+// buffer (e.g. implicit arrays) are copied once into one.
+//
+// Point and cell data arrays without a name are written as "Array<i>". Cell
+// data is skipped for polydata with both strips and polys, whose cell order
+// differs from the file's.
+
+#ifndef vtkParallelPolyDataWriter_h
+#define vtkParallelPolyDataWriter_h
+
+#include "vtkWriter.h"
+
+class vtkPolyData;
+
+class vtkParallelPolyDataWriter : public vtkWriter
+{
+public:
+    static vtkParallelPolyDataWriter* New();
+    vtkTypeMacro(vtkParallelPolyDataWriter, vtkWriter);
+    void PrintSelf(ostream& os, vtkIndent indent) override;
+
+    vtkSetStringMacro(FileName);
+    vtkGetStringMacro(FileName);
+
+    // Bytes handed to one worker at a time.
+    vtkSetClampMacro(ChunkSize, vtkIdType, 4096, VTK_ID_MAX);
+    vtkGetMacro(ChunkSize, vtkIdType);
+
+    vtkPolyData* GetInput();
+
+    // Size of the last file written, in bytes.
+    vtkGetMacro(FileSize, vtkTypeUInt64);
+
+protected:
+    vtkParallelPolyDataWriter() = default;
+    ~vtkParallelPolyDataWriter() override;
+
+    int FillInputPortInformation(int port, vtkInformation* info) override;
+    void WriteData() override;
+
+    char* FileName = nullptr;
+    vtkIdType ChunkSize = 4 << 20;
+    vtkTypeUInt64 FileSize = 0;
+
+private:
+    vtkParallelPolyDataWriter(const vtkParallelPolyDataWriter&) = delete;
+    void operator=(const vtkParallelPolyDataWriter&) = delete;
+};
+
+#endif